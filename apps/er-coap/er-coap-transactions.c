@@ -40,6 +40,7 @@
 #include "contiki-net.h"
 #include "er-coap-transactions.h"
 #include "er-coap-observe.h"
+#include "lib/dlist.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -55,7 +56,7 @@
 
 /*---------------------------------------------------------------------------*/
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
-LIST(transactions_list);
+DLIST(transactions_list);
 
 static struct process *transaction_handler_process = NULL;
 
@@ -80,7 +81,7 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
-    list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+    dlist_add(transactions_list, t); /* list itself makes sure same element is not added twice */
   }
 
   return t;
@@ -145,7 +146,7 @@ coap_clear_transaction(coap_transaction_t *t)
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
     etimer_stop(&t->retrans_timer);
-    list_remove(transactions_list, t);
+    dlist_remove(transactions_list, t);
     memb_free(&transactions_memb, t);
   }
 }
@@ -154,7 +155,7 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+  for(t = (coap_transaction_t *)dlist_head(transactions_list); t; t = t->next) {
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -167,8 +168,12 @@ void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
+  coap_transaction_t *next;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+  /* coap_send_transaction() may free the transaction and clear its
+     links, so get the next one first. */
+  for(t = (coap_transaction_t *)dlist_head(transactions_list); t; t = next) {
+    next = t->next;
     if(etimer_expired(&t->retrans_timer)) {
       ++(t->retrans_counter);
       PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
@@ -50,7 +50,9 @@
 
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
-  struct coap_transaction *next;        /* for LIST */
+  struct coap_transaction *next;        /* for DLIST */
+  struct coap_transaction *prev;
+  struct dlist *list;
 
   uint16_t mid;
   struct etimer retrans_timer;
@@ -49,6 +49,13 @@ SHELL_COMMAND(ps_command,
 	      "ps",
 	      "ps: list all running processes",
 	      &shell_ps_process);
+#if PROCESS_PROFILE
+PROCESS(shell_pprof_process, "pprof");
+SHELL_COMMAND(pprof_command,
+	      "pprof",
+	      "pprof [reset]: show the CPU time and event wait time of all processes",
+	      &shell_pprof_process);
+#endif /* PROCESS_PROFILE */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_ps_process, ev, data)
 {
@@ -65,9 +72,46 @@ PROCESS_THREAD(shell_ps_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+PROCESS_THREAD(shell_pprof_process, ev, data)
+{
+  struct process *p;
+  char buf[80];
+  int i, len;
+  PROCESS_BEGIN();
+
+  if(data != NULL && strcmp(data, "reset") == 0) {
+    process_profile_reset();
+    PROCESS_EXIT();
+  }
+
+  snprintf(buf, sizeof(buf), "Process profile, %lu ticks/s:",
+           (unsigned long)PROCESS_PROFILE_SECOND);
+  shell_output_str(&pprof_command, buf, "");
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    snprintf(buf, sizeof(buf), "%s: calls %lu time %lu max %lu",
+             PROCESS_NAME_STRING(p), p->profile.calls, p->profile.time,
+             p->profile.max_time);
+    shell_output_str(&pprof_command, buf, "");
+    len = snprintf(buf, sizeof(buf), "  wait max %lu hist",
+                   p->profile.max_wait);
+    for(i = 0; i < PROCESS_PROFILE_HIST_BUCKETS && len < (int)sizeof(buf); i++) {
+      len += snprintf(buf + len, sizeof(buf) - len, " %lu",
+                      p->profile.wait_hist[i]);
+    }
+    shell_output_str(&pprof_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 void
 shell_ps_init(void)
 {
   shell_register_command(&ps_command);
+#if PROCESS_PROFILE
+  shell_register_command(&pprof_command);
+#endif /* PROCESS_PROFILE */
 }
 /*---------------------------------------------------------------------------*/
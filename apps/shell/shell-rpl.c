@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Shell command for the RPL event trace
+ */
+
+#include "contiki.h"
+#include "shell.h"
+#include "shell-rpl.h"
+#include "net/rpl/rpl-trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_rpl_trace_process, "rpl-trace");
+SHELL_COMMAND(rpl_trace_command,
+	      "rpl-trace",
+	      "rpl-trace [reset]: show RPL message counters and events, or clear them",
+	      &shell_rpl_trace_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_rpl_trace_process, ev, data)
+{
+#if RPL_WITH_TRACE
+  char buf[48];
+  const struct rpl_trace_entry *e;
+  uint16_t seqno;
+  int i;
+#endif /* RPL_WITH_TRACE */
+
+  PROCESS_BEGIN();
+
+#if RPL_WITH_TRACE
+  if(data != NULL && strcmp(data, "reset") == 0) {
+    rpl_trace_reset();
+    PROCESS_EXIT();
+  }
+
+  for(i = 0; i < RPL_TRACE_EVENT_NUM; i++) {
+    snprintf(buf, sizeof(buf), "%s %u", rpl_trace_event_name(i),
+             rpl_trace_count(i));
+    shell_output_str(&rpl_trace_command, "count ", buf);
+  }
+
+  for(seqno = rpl_trace_first(); seqno != rpl_trace_next(); seqno++) {
+    e = rpl_trace_get(seqno);
+    if(e == NULL) {
+      continue;
+    }
+    snprintf(buf, sizeof(buf), "%u %lu %s %02x%02x %u %u", e->seqno,
+             (unsigned long)e->time, rpl_trace_event_name(e->event),
+             e->addr[0], e->addr[1], e->rank, e->arg);
+    shell_output_str(&rpl_trace_command, "event ", buf);
+  }
+#else /* RPL_WITH_TRACE */
+  shell_output_str(&rpl_trace_command,
+                   "RPL trace not enabled (RPL_CONF_WITH_TRACE)", "");
+#endif /* RPL_WITH_TRACE */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_rpl_init(void)
+{
+  shell_register_command(&rpl_trace_command);
+}
+/*---------------------------------------------------------------------------*/
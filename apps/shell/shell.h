@@ -398,6 +398,7 @@ struct shell_input {
 #include "shell-rime-sniff.h"
 #include "shell-rime-unicast.h"
 #include "shell-rime.h"
+#include "shell-rpl.h"
 #include "shell-rsh.h"
 #include "shell-run.h"
 #include "shell-sendtest.h"
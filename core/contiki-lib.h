@@ -35,6 +35,7 @@
 #define CONTIKI_LIB_H_
 
 #include "contiki.h"
+#include "lib/heapmem.h"
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "lib/mmem.h"
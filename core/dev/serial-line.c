@@ -32,7 +32,7 @@
 #include "dev/serial-line.h"
 #include <string.h> /* for memcpy() */
 
-#include "lib/ringbuf.h"
+#include "lib/ringbufelem.h"
 
 #ifdef SERIAL_LINE_CONF_BUFSIZE
 #define BUFSIZE SERIAL_LINE_CONF_BUFSIZE
@@ -48,7 +48,7 @@
 #define IGNORE_CHAR(c) (c == 0x0d)
 #define END 0x0a
 
-static struct ringbuf rxbuf;
+static struct ringbufelem rxbuf;
 static uint8_t rxbuf_data[BUFSIZE];
 
 PROCESS(serial_line_process, "Serial driver");
@@ -67,14 +67,14 @@ serial_line_input_byte(unsigned char c)
 
   if(!overflow) {
     /* Add character */
-    if(ringbuf_put(&rxbuf, c) == 0) {
+    if(ringbufelem_put(&rxbuf, &c) == 0) {
       /* Buffer overflow: ignore the rest of the line */
       overflow = 1;
     }
   } else {
     /* Buffer overflowed:
      * Only (try to) add terminator characters, otherwise skip */
-    if(c == END && ringbuf_put(&rxbuf, c) != 0) {
+    if(c == END && ringbufelem_put(&rxbuf, &c) != 0) {
       overflow = 0;
     }
   }
@@ -96,19 +96,30 @@ PROCESS_THREAD(serial_line_process, ev, data)
 
   while(1) {
     /* Fill application buffer until newline or empty */
-    int c = ringbuf_get(&rxbuf);
-    
-    if(c == -1) {
+    uint8_t *c;
+    int n, len, copy;
+
+    c = ringbufelem_peek(&rxbuf, &n);
+    if(c == NULL) {
       /* Buffer empty, wait for poll */
       PROCESS_YIELD();
     } else {
-      if(c != END) {
-        if(ptr < BUFSIZE-1) {
-          buf[ptr++] = (uint8_t)c;
-        } else {
-          /* Ignore character (wait for EOL) */
-        }
+      /* Copy the received characters up to the end of the line, or
+         all that are contiguous in the buffer. */
+      for(len = 0; len < n && c[len] != END; len++);
+      copy = len;
+      if(copy > BUFSIZE - 1 - ptr) {
+        /* Ignore characters that do not fit (wait for EOL) */
+        copy = BUFSIZE - 1 - ptr;
+      }
+      memcpy(&buf[ptr], c, copy);
+      ptr += copy;
+
+      if(len == n) {
+        ringbufelem_consume(&rxbuf, n);
       } else {
+        ringbufelem_consume(&rxbuf, len + 1);
+
         /* Terminate */
         buf[ptr++] = (uint8_t)'\0';
 
@@ -131,7 +142,7 @@ PROCESS_THREAD(serial_line_process, ev, data)
 void
 serial_line_init(void)
 {
-  ringbuf_init(&rxbuf, rxbuf_data, sizeof(rxbuf_data));
+  ringbufelem_init(&rxbuf, rxbuf_data, NULL, 1, sizeof(rxbuf_data));
   process_start(&serial_line_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ * Doubly linked list manipulation routines.
+ */
+
+/**
+ * \addtogroup dlist
+ * @{
+ */
+
+#include "lib/dlist.h"
+
+#include <stddef.h>
+
+struct dlist_item {
+  struct dlist_item *next;
+  struct dlist_item *prev;
+  struct dlist *list;
+};
+
+#define ITEM(i) ((struct dlist_item *)(i))
+/*---------------------------------------------------------------------------*/
+/**
+ * Initialize a doubly linked list. The list will be empty after this
+ * function has been called.
+ * \param list The list to be initialized.
+ */
+void
+dlist_init(dlist_t list)
+{
+  list->head = list->tail = NULL;
+  list->length = 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get a pointer to the first element of a list.
+ * \param list The list.
+ * \return A pointer to the first element on the list, or NULL.
+ */
+void *
+dlist_head(dlist_t list)
+{
+  return list->head;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get a pointer to the last element of a list.
+ * \param list The list.
+ * \return A pointer to the last element on the list, or NULL.
+ */
+void *
+dlist_tail(dlist_t list)
+{
+  return list->tail;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Check if an element is on a list.
+ * \param list The list.
+ * \param item The element.
+ * \return Non-zero if the element is on the list.
+ */
+int
+dlist_contains(dlist_t list, void *item)
+{
+  return item != NULL && ITEM(item)->list == list;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove an element from a list. Nothing is done if the element is
+ * not on the list.
+ * \param list The list.
+ * \param item The element that is to be removed from the list.
+ */
+void
+dlist_remove(dlist_t list, void *item)
+{
+  struct dlist_item *i = item;
+
+  if(!dlist_contains(list, item)) {
+    return;
+  }
+  if(i->prev != NULL) {
+    i->prev->next = i->next;
+  } else {
+    list->head = i->next;
+  }
+  if(i->next != NULL) {
+    i->next->prev = i->prev;
+  } else {
+    list->tail = i->prev;
+  }
+  i->next = i->prev = NULL;
+  i->list = NULL;
+  list->length--;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Insert an element after a specified element on the list
+ * \param list The list
+ * \param previtem The element after which the new element should be
+ *                 inserted, or NULL to insert it first on the list
+ * \param newitem  The new element. If it already is on this or
+ *                 another list, it is moved.
+ */
+void
+dlist_insert(dlist_t list, void *previtem, void *newitem)
+{
+  struct dlist_item *p = previtem;
+  struct dlist_item *n = newitem;
+
+  if(p == n) {
+    return;
+  }
+  if(n->list != NULL) {
+    dlist_remove(n->list, n);
+  }
+
+  n->list = list;
+  n->prev = p;
+  if(p == NULL) {
+    n->next = list->head;
+    list->head = n;
+  } else {
+    n->next = p->next;
+    p->next = n;
+  }
+  if(n->next != NULL) {
+    n->next->prev = n;
+  } else {
+    list->tail = n;
+  }
+  list->length++;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an element at the start of a list. If the element already is
+ * on the list, it is moved.
+ * \param list The list.
+ * \param item The element.
+ */
+void
+dlist_push(dlist_t list, void *item)
+{
+  dlist_insert(list, NULL, item);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an element at the end of a list. If the element already is on
+ * the list, it is moved.
+ * \param list The list.
+ * \param item The element.
+ */
+void
+dlist_add(dlist_t list, void *item)
+{
+  if(list->tail != item) {
+    dlist_remove(list, item);
+    dlist_insert(list, list->tail, item);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the first element of a list.
+ * \param list The list.
+ * \return The removed element, or NULL if the list was empty.
+ */
+void *
+dlist_pop(dlist_t list)
+{
+  void *item = list->head;
+
+  dlist_remove(list, item);
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the last element of a list.
+ * \param list The list.
+ * \return The removed element, or NULL if the list was empty.
+ */
+void *
+dlist_chop(dlist_t list)
+{
+  void *item = list->tail;
+
+  dlist_remove(list, item);
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the number of elements on a list.
+ * \param list The list.
+ * \return The length of the list.
+ */
+int
+dlist_length(dlist_t list)
+{
+  return list->length;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the element following an element.
+ * \param item An element of a list
+ * \return The next element, or NULL at the end of the list.
+ */
+void *
+dlist_item_next(void *item)
+{
+  return item == NULL ? NULL : ITEM(item)->next;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the element preceding an element.
+ * \param item An element of a list
+ * \return The previous element, or NULL at the start of the list.
+ */
+void *
+dlist_item_prev(void *item)
+{
+  return item == NULL ? NULL : ITEM(item)->prev;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
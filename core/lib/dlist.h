@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ * Doubly linked list manipulation routines.
+ */
+
+/** \addtogroup lib
+    @{ */
+/**
+ * \defgroup dlist Doubly linked list library
+ *
+ * The doubly linked list library is a companion to the \ref list
+ * "linked list library" for lists where elements are often removed
+ * from the middle or added at the end. An element of a doubly linked
+ * list \b must be a structure whose first three members are pointers:
+ * the first is the link to the next element, like for an ordinary
+ * list, the second the link to the previous element, and the third
+ * a struct dlist pointer to the list the element is on. The list
+ * itself keeps pointers to its first and last element and the number
+ * of elements, so dlist_add(), dlist_chop(), dlist_remove(),
+ * dlist_insert() and dlist_length() all run in constant time.
+ *
+ * Because the first member of an element is the next pointer,
+ * dlist_item_next() and list_item_next() are interchangeable, and
+ * code that only iterates over a list works with both kinds.
+ *
+ * An element is on a list if its list pointer points to that list,
+ * so removing an element from a list it is not on does nothing, even
+ * when it is on another list. Elements must therefore be zeroed
+ * before they are added for the first time; elements from a MEMB() or
+ * a static variable already are. An element that is removed has all
+ * three pointers cleared. An element can only be on one doubly linked
+ * list at a time.
+ *
+ * @{
+ */
+
+#ifndef DLIST_H_
+#define DLIST_H_
+
+#include "lib/list.h"
+
+/**
+ * The doubly linked list type.
+ */
+struct dlist {
+  void *head;
+  void *tail;
+  unsigned short length;
+};
+
+typedef struct dlist * dlist_t;
+
+/**
+ * Declare a doubly linked list.
+ *
+ * The list variable is declared as static, as with LIST().
+ *
+ * \param name The name of the list.
+ */
+#define DLIST(name) \
+         static struct dlist LIST_CONCAT(name,_dlist); \
+         static dlist_t name = &LIST_CONCAT(name,_dlist)
+
+/**
+ * Declare a doubly linked list inside a structure declaration.
+ *
+ * The list must be initialized with DLIST_STRUCT_INIT() before use.
+ *
+ * \param name The name of the list.
+ */
+#define DLIST_STRUCT(name) \
+         struct dlist LIST_CONCAT(name,_dlist); \
+         dlist_t name
+
+/**
+ * Initialize a doubly linked list that is part of a structure.
+ *
+ * \param struct_ptr A pointer to the struct
+ * \param name The name of the list.
+ */
+#define DLIST_STRUCT_INIT(struct_ptr, name)                             \
+    do {                                                                \
+       (struct_ptr)->name = &((struct_ptr)->LIST_CONCAT(name,_dlist));  \
+       dlist_init((struct_ptr)->name);                                  \
+    } while(0)
+
+void   dlist_init(dlist_t list);
+void * dlist_head(dlist_t list);
+void * dlist_tail(dlist_t list);
+void * dlist_pop(dlist_t list);
+void   dlist_push(dlist_t list, void *item);
+
+void * dlist_chop(dlist_t list);
+
+void   dlist_add(dlist_t list, void *item);
+void   dlist_remove(dlist_t list, void *item);
+int    dlist_contains(dlist_t list, void *item);
+
+int    dlist_length(dlist_t list);
+
+void   dlist_insert(dlist_t list, void *previtem, void *newitem);
+
+void * dlist_item_next(void *item);
+void * dlist_item_prev(void *item);
+
+#endif /* DLIST_H_ */
+
+/** @} */
+/** @} */
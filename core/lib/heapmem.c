@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup heapmem
+ * @{
+ */
+
+/**
+ * \file
+ *         Implementation of the heap memory allocator
+ */
+
+#include "lib/heapmem.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/*
+ * Every block starts with a header that links it to the block before
+ * it in memory. The size of the block that follows it in memory is
+ * implied by the size field. A free block also links to its
+ * neighbours in the free list of its size class; these links overlap
+ * the payload of the block.
+ */
+struct block {
+  struct block *prev_phys;
+  size_t size;
+  struct block *next_free;
+  struct block *prev_free;
+};
+
+#define BLOCK_FREE 1
+
+#define ALIGN           ((size_t)HEAPMEM_ALIGNMENT)
+#define ALIGN_UP(x, a)  (((x) + ((a) - 1)) & ~((a) - 1))
+
+#define HEADER_SIZE ALIGN_UP(offsetof(struct block, next_free), ALIGN)
+#define MIN_SIZE \
+  (ALIGN_UP(sizeof(struct block), ALIGN) > HEADER_SIZE + ALIGN ? \
+   ALIGN_UP(sizeof(struct block), ALIGN) - HEADER_SIZE : ALIGN)
+
+#define SIZE(b)         ((b)->size & ~(size_t)BLOCK_FREE)
+#define IS_FREE(b)      ((b)->size & BLOCK_FREE)
+#define PAYLOAD(b)      ((char *)(b) + HEADER_SIZE)
+#define FROM_PAYLOAD(p) ((struct block *)((char *)(p) - HEADER_SIZE))
+#define NEXT_PHYS(b)    ((struct block *)(PAYLOAD(b) + SIZE(b)))
+
+/* Base-two logarithm of a constant, usable in constant expressions. */
+#define LOG2_2(x)  ((x) >= 2 ? 1 : 0)
+#define LOG2_4(x)  ((x) >= 4 ? 2 + LOG2_2((x) >> 2) : LOG2_2(x))
+#define LOG2_8(x)  ((x) >= 16 ? 4 + LOG2_4((x) >> 4) : LOG2_4(x))
+#define LOG2_16(x) ((x) >= 256 ? 8 + LOG2_8((x) >> 8) : LOG2_8(x))
+#define LOG2(x)    ((x) >= 65536UL ? 16 + LOG2_16((x) >> 16) : LOG2_16(x))
+
+/*
+ * Blocks smaller than SMALL_SIZE are in the first level, split into
+ * SL_COUNT classes of ALIGN bytes each. Larger blocks are classified
+ * by their most significant bit (first level) and the SL_LOG2 bits
+ * below it (second level).
+ */
+#define SL_COUNT    (1 << HEAPMEM_SL_LOG2)
+#define FL_SHIFT    (HEAPMEM_SL_LOG2 + LOG2(ALIGN))
+#define SMALL_SIZE  ((size_t)1 << FL_SHIFT)
+#define FL_INDEX_MAX LOG2((unsigned long)HEAPMEM_ARENA_SIZE)
+#define FL_COUNT \
+  (FL_INDEX_MAX >= FL_SHIFT ? FL_INDEX_MAX - FL_SHIFT + 2 : 1)
+
+static unsigned long fl_bitmap;
+static unsigned long sl_bitmap[FL_COUNT];
+static struct block *free_lists[FL_COUNT][SL_COUNT];
+
+static char arena[HEAPMEM_ARENA_SIZE + HEAPMEM_ALIGNMENT];
+static struct block *first_block;
+static struct block *last_block;
+
+static size_t allocated;
+static size_t max_allocated;
+static unsigned int chunks;
+static unsigned int failed;
+/*---------------------------------------------------------------------------*/
+/* Index of the most significant set bit of a non-zero value. */
+static int
+msb(size_t x)
+{
+#ifdef __GNUC__
+  return (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(x);
+#else
+  int i;
+
+  for(i = 0; x > 1; i++) {
+    x >>= 1;
+  }
+  return i;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+/* Index of the least significant set bit of a non-zero value. */
+static int
+lsb(unsigned long x)
+{
+#ifdef __GNUC__
+  return __builtin_ctzl(x);
+#else
+  int i;
+
+  for(i = 0; !(x & 1); i++) {
+    x >>= 1;
+  }
+  return i;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+mapping(size_t size, int *fl, int *sl)
+{
+  int m;
+
+  if(size < SMALL_SIZE) {
+    *fl = 0;
+    *sl = (int)(size / ALIGN);
+  } else {
+    m = msb(size);
+    *fl = m - FL_SHIFT + 1;
+    *sl = (int)(size >> (m - HEAPMEM_SL_LOG2)) - SL_COUNT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_free(struct block *b)
+{
+  int fl, sl;
+
+  mapping(SIZE(b), &fl, &sl);
+  b->size |= BLOCK_FREE;
+  b->prev_free = NULL;
+  b->next_free = free_lists[fl][sl];
+  if(b->next_free != NULL) {
+    b->next_free->prev_free = b;
+  }
+  free_lists[fl][sl] = b;
+  fl_bitmap |= 1UL << fl;
+  sl_bitmap[fl] |= 1UL << sl;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_free(struct block *b)
+{
+  int fl, sl;
+
+  mapping(SIZE(b), &fl, &sl);
+  b->size &= ~(size_t)BLOCK_FREE;
+  if(b->prev_free != NULL) {
+    b->prev_free->next_free = b->next_free;
+  } else {
+    free_lists[fl][sl] = b->next_free;
+    if(b->next_free == NULL) {
+      sl_bitmap[fl] &= ~(1UL << sl);
+      if(sl_bitmap[fl] == 0) {
+        fl_bitmap &= ~(1UL << fl);
+      }
+    }
+  }
+  if(b->next_free != NULL) {
+    b->next_free->prev_free = b->prev_free;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find a free block of at least the given size. */
+static struct block *
+find_free(size_t size)
+{
+  unsigned long map;
+  int fl, sl;
+
+  /* Round up to the next size class, so that any block in the class
+     that is found is large enough. */
+  if(size >= SMALL_SIZE) {
+    size += ((size_t)1 << (msb(size) - HEAPMEM_SL_LOG2)) - 1;
+  }
+  mapping(size, &fl, &sl);
+
+  map = fl < FL_COUNT ? sl_bitmap[fl] & (~0UL << sl) : 0;
+  if(map == 0) {
+    map = fl + 1 < FL_COUNT ? fl_bitmap & (~0UL << (fl + 1)) : 0;
+    if(map == 0) {
+      return NULL;
+    }
+    fl = lsb(map);
+    map = sl_bitmap[fl];
+  }
+  return free_lists[fl][lsb(map)];
+}
+/*---------------------------------------------------------------------------*/
+/* Mark a block as free, merging it with free neighbours. */
+static void
+release(struct block *b)
+{
+  struct block *n;
+
+  /* Mark the header as free even if it ends up inside a merged block,
+     so that a repeated free of the same pointer is detected. */
+  b->size |= BLOCK_FREE;
+  if(b->prev_phys != NULL && IS_FREE(b->prev_phys)) {
+    n = b;
+    b = b->prev_phys;
+    remove_free(b);
+    b->size = SIZE(b) + HEADER_SIZE + SIZE(n);
+    NEXT_PHYS(b)->prev_phys = b;
+  }
+  n = NEXT_PHYS(b);
+  if(IS_FREE(n)) {
+    remove_free(n);
+    b->size = SIZE(b) + HEADER_SIZE + SIZE(n);
+    NEXT_PHYS(b)->prev_phys = b;
+  }
+  insert_free(b);
+}
+/*---------------------------------------------------------------------------*/
+/* Shrink an allocated block to the given size, if the rest is large
+   enough to form a block of its own. */
+static void
+trim(struct block *b, size_t size)
+{
+  struct block *n;
+
+  if(SIZE(b) < size + HEADER_SIZE + MIN_SIZE) {
+    return;
+  }
+  n = (struct block *)(PAYLOAD(b) + size);
+  n->prev_phys = b;
+  n->size = SIZE(b) - size - HEADER_SIZE;
+  b->size = size;
+  NEXT_PHYS(n)->prev_phys = n;
+  release(n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  uintptr_t start;
+  size_t total;
+
+  start = ALIGN_UP((uintptr_t)arena, (uintptr_t)ALIGN);
+  total = (HEAPMEM_ARENA_SIZE / ALIGN) * ALIGN;
+
+  first_block = (struct block *)start;
+  first_block->prev_phys = NULL;
+  first_block->size = total - 2 * HEADER_SIZE;
+
+  /* A zero-size allocated block at the end stops merging. */
+  last_block = NEXT_PHYS(first_block);
+  last_block->prev_phys = first_block;
+  last_block->size = 0;
+
+  insert_free(first_block);
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+adjust_size(size_t size)
+{
+  if(size > HEAPMEM_ARENA_SIZE) {
+    return 0;
+  }
+  size = ALIGN_UP(size, ALIGN);
+  return size < MIN_SIZE ? MIN_SIZE : size;
+}
+/*---------------------------------------------------------------------------*/
+static void
+account(struct block *b)
+{
+  chunks++;
+  allocated += SIZE(b);
+  if(allocated > max_allocated) {
+    max_allocated = allocated;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Return the block of an allocated pointer, or NULL if the pointer
+   does not point to an allocated block. */
+static struct block *
+lookup(void *ptr)
+{
+  struct block *b;
+
+  if(first_block == NULL ||
+     (char *)ptr < PAYLOAD(first_block) || (char *)ptr >= (char *)last_block ||
+     ((uintptr_t)ptr & (ALIGN - 1)) != 0) {
+    return NULL;
+  }
+  b = FROM_PAYLOAD(ptr);
+  if(IS_FREE(b)) {
+    return NULL;
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+/* Look for a large enough block in the size class of the request
+   itself. This is only needed when no larger class has a free block.
+   At most HEAPMEM_CLASS_SCAN blocks of the class' list are examined,
+   so that the time of an allocation stays bounded. */
+static struct block *
+find_free_in_class(size_t size)
+{
+  struct block *b;
+  int fl, sl;
+  int n;
+
+  mapping(size, &fl, &sl);
+  b = free_lists[fl][sl];
+  for(n = 0; n < HEAPMEM_CLASS_SCAN && b != NULL; n++) {
+    if(SIZE(b) >= size) {
+      return b;
+    }
+    b = b->next_free;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct block *
+find_block(size_t size)
+{
+  struct block *b;
+
+  if(size == 0 || size > HEAPMEM_ARENA_SIZE) {
+    return NULL;
+  }
+  b = find_free(size);
+  if(b == NULL) {
+    b = find_free_in_class(size);
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+void *
+heapmem_alloc(size_t size)
+{
+  struct block *b;
+
+  if(first_block == NULL) {
+    init();
+  }
+
+  size = adjust_size(size);
+  b = find_block(size);
+  if(b == NULL) {
+    PRINTF("heapmem: failed to allocate %lu bytes\n", (unsigned long)size);
+    failed++;
+    return NULL;
+  }
+
+  remove_free(b);
+  trim(b, size);
+  account(b);
+  return PAYLOAD(b);
+}
+/*---------------------------------------------------------------------------*/
+void *
+heapmem_alloc_aligned(size_t size, size_t align)
+{
+  struct block *b, *n;
+  uintptr_t p, aligned;
+  size_t gap;
+
+  if(align <= ALIGN) {
+    return heapmem_alloc(size);
+  }
+  if(first_block == NULL) {
+    init();
+  }
+
+  size = adjust_size(size);
+  b = size == 0 ? NULL : find_block(size + align + HEADER_SIZE + MIN_SIZE);
+  if(b == NULL) {
+    failed++;
+    return NULL;
+  }
+  remove_free(b);
+
+  /* Any space in front of the aligned address must be large enough to
+     be returned to the heap as a block of its own. */
+  p = (uintptr_t)PAYLOAD(b);
+  aligned = ALIGN_UP(p, (uintptr_t)align);
+  if(aligned != p && aligned - p < HEADER_SIZE + MIN_SIZE) {
+    aligned = ALIGN_UP(p + HEADER_SIZE + MIN_SIZE, (uintptr_t)align);
+  }
+  gap = aligned - p;
+
+  if(gap > 0) {
+    n = (struct block *)((char *)b + gap);
+    n->prev_phys = b;
+    n->size = SIZE(b) - gap;
+    NEXT_PHYS(n)->prev_phys = n;
+    b->size = gap - HEADER_SIZE;
+    insert_free(b);
+    b = n;
+  }
+
+  trim(b, size);
+  account(b);
+  return PAYLOAD(b);
+}
+/*---------------------------------------------------------------------------*/
+void *
+heapmem_realloc(void *ptr, size_t size)
+{
+  struct block *b, *n;
+  void *newptr;
+  size_t oldsize;
+
+  if(ptr == NULL) {
+    return heapmem_alloc(size);
+  }
+  if(size == 0) {
+    heapmem_free(ptr);
+    return NULL;
+  }
+  b = lookup(ptr);
+  size = adjust_size(size);
+  if(b == NULL || size == 0) {
+    return NULL;
+  }
+
+  oldsize = SIZE(b);
+  n = NEXT_PHYS(b);
+  if(oldsize < size && IS_FREE(n) &&
+     oldsize + HEADER_SIZE + SIZE(n) >= size) {
+    /* Grow into the free block that follows. */
+    remove_free(n);
+    b->size = oldsize + HEADER_SIZE + SIZE(n);
+    NEXT_PHYS(b)->prev_phys = b;
+  }
+
+  if(SIZE(b) >= size) {
+    trim(b, size);
+    allocated = allocated - oldsize + SIZE(b);
+    if(allocated > max_allocated) {
+      max_allocated = allocated;
+    }
+    return ptr;
+  }
+
+  newptr = heapmem_alloc(size);
+  if(newptr != NULL) {
+    memcpy(newptr, ptr, oldsize);
+    heapmem_free(ptr);
+  }
+  return newptr;
+}
+/*---------------------------------------------------------------------------*/
+int
+heapmem_free(void *ptr)
+{
+  struct block *b;
+
+  if(ptr == NULL) {
+    return 0;
+  }
+  b = lookup(ptr);
+  if(b == NULL) {
+    PRINTF("heapmem: bad free %p\n", ptr);
+    return 0;
+  }
+
+  chunks--;
+  allocated -= SIZE(b);
+  release(b);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+heapmem_stats(struct heapmem_stats *stats)
+{
+  struct block *b;
+
+  if(first_block == NULL) {
+    init();
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  stats->allocated = allocated;
+  stats->max_allocated = max_allocated;
+  stats->chunks = chunks;
+  stats->failed = failed;
+
+  for(b = first_block; b != last_block; b = NEXT_PHYS(b)) {
+    stats->overhead += HEADER_SIZE;
+    if(IS_FREE(b)) {
+      stats->free_chunks++;
+      stats->available += SIZE(b);
+      if(SIZE(b) > stats->largest_free) {
+        stats->largest_free = SIZE(b);
+      }
+    }
+  }
+  stats->overhead += HEADER_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
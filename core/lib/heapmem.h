@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup mem
+ * @{
+ */
+
+/**
+ * \defgroup heapmem Heap memory allocator
+ *
+ * The heap memory allocator provides malloc-style allocation of
+ * variable-size blocks from a statically allocated arena. It is a
+ * two-level segregated fit (TLSF) allocator: free blocks are kept in
+ * lists indexed by a coarse and a fine size class, with a bitmap for
+ * each level. Finding a suitable free block, splitting it, and
+ * merging a freed block with its free neighbours all take a bounded
+ * number of steps, independent of the number of blocks in the heap.
+ *
+ * Unlike the managed memory allocator, allocated blocks never move,
+ * so plain pointers can be used. The managed memory API can be routed
+ * to this allocator with MMEM_CONF_HEAPMEM.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the heap memory allocator
+ */
+
+#ifndef HEAPMEM_H_
+#define HEAPMEM_H_
+
+#include "contiki-conf.h"
+#include <stddef.h>
+
+/** Size of the heap arena in bytes. */
+#ifdef HEAPMEM_CONF_ARENA_SIZE
+#define HEAPMEM_ARENA_SIZE HEAPMEM_CONF_ARENA_SIZE
+#else /* HEAPMEM_CONF_ARENA_SIZE */
+#define HEAPMEM_ARENA_SIZE 4096
+#endif /* HEAPMEM_CONF_ARENA_SIZE */
+
+/**
+ * Alignment of all allocated blocks. Must be a power of two and at
+ * least sizeof(void *).
+ */
+#ifdef HEAPMEM_CONF_ALIGNMENT
+#define HEAPMEM_ALIGNMENT HEAPMEM_CONF_ALIGNMENT
+#else /* HEAPMEM_CONF_ALIGNMENT */
+#define HEAPMEM_ALIGNMENT sizeof(void *)
+#endif /* HEAPMEM_CONF_ALIGNMENT */
+
+/**
+ * Base-two logarithm of the number of fine size classes per power of
+ * two. Higher values waste less memory on rounding, but use more RAM
+ * for the free list heads.
+ */
+#ifdef HEAPMEM_CONF_SL_LOG2
+#define HEAPMEM_SL_LOG2 HEAPMEM_CONF_SL_LOG2
+#else /* HEAPMEM_CONF_SL_LOG2 */
+#define HEAPMEM_SL_LOG2 3
+#endif /* HEAPMEM_CONF_SL_LOG2 */
+
+/**
+ * Maximum number of free blocks examined in the size class of a
+ * request when no larger class has a free block. A block in the
+ * request's own class may or may not be large enough, so this is the
+ * only part of an allocation that is not a constant number of steps:
+ * it adds at most this many list steps. With 0, such requests fail,
+ * as in a plain TLSF allocator, even when a large enough block is
+ * free.
+ */
+#ifdef HEAPMEM_CONF_CLASS_SCAN
+#define HEAPMEM_CLASS_SCAN HEAPMEM_CONF_CLASS_SCAN
+#else /* HEAPMEM_CONF_CLASS_SCAN */
+#define HEAPMEM_CLASS_SCAN 4
+#endif /* HEAPMEM_CONF_CLASS_SCAN */
+
+/**
+ * Heap usage statistics, see heapmem_stats().
+ */
+struct heapmem_stats {
+  /** Bytes currently allocated, excluding block headers. */
+  size_t allocated;
+  /** The largest value that allocated has had. */
+  size_t max_allocated;
+  /** Bytes used for the headers of all blocks. */
+  size_t overhead;
+  /** Bytes available in free blocks. */
+  size_t available;
+  /** Size of the largest free block. */
+  size_t largest_free;
+  /** Number of allocated blocks. */
+  unsigned int chunks;
+  /** Number of free blocks. */
+  unsigned int free_chunks;
+  /** Number of allocations that failed. */
+  unsigned int failed;
+};
+
+/**
+ * \brief      Allocate a block of memory
+ * \param size The number of bytes to allocate
+ * \return     A pointer to the block, aligned to HEAPMEM_ALIGNMENT,
+ *             or NULL if no block could be allocated.
+ */
+void *heapmem_alloc(size_t size);
+
+/**
+ * \brief       Allocate an aligned block of memory
+ * \param size  The number of bytes to allocate
+ * \param align The alignment of the block, a power of two
+ * \return      A pointer to the block, or NULL if no block could be
+ *              allocated.
+ */
+void *heapmem_alloc_aligned(size_t size, size_t align);
+
+/**
+ * \brief      Change the size of a block of memory
+ * \param ptr  A block allocated with heapmem_alloc(), or NULL
+ * \param size The new size of the block
+ * \return     A pointer to the resized block, or NULL if it could not
+ *             be resized, in which case the old block is left intact.
+ *
+ *             The block is resized in place if possible. Otherwise, a
+ *             new block is allocated and the contents are copied.
+ */
+void *heapmem_realloc(void *ptr, size_t size);
+
+/**
+ * \brief      Free a block of memory
+ * \param ptr  A block allocated with heapmem_alloc(), or NULL
+ * \return     Non-zero if the block was freed, zero if ptr is NULL or
+ *             is rejected as invalid.
+ *
+ *             Pointers outside the heap and misaligned pointers are
+ *             rejected, but other invalid pointers are not always
+ *             detected. Passing a pointer that was not returned by
+ *             heapmem_alloc() or heapmem_realloc(), or one that has
+ *             already been freed, has undefined behavior.
+ */
+int heapmem_free(void *ptr);
+
+/**
+ * \brief       Get heap usage statistics
+ * \param stats Filled in with the current statistics
+ *
+ *              The free block counts are computed by walking the
+ *              heap, so this function is not meant for time-critical
+ *              code. The external fragmentation of the heap is
+ *              1 - largest_free / available.
+ */
+void heapmem_stats(struct heapmem_stats *stats);
+
+#endif /* HEAPMEM_H_ */
+
+/** @} */
+/** @} */
@@ -47,12 +47,36 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_FREELIST
+/*
+ * The control array entry of an allocated block is MEMB_ALLOCATED.
+ * For a free block, it links to the next free block: zero means the
+ * block that follows it in memory, and any other value is the index
+ * of the next free block plus one. Index num ends the list. With this
+ * encoding, a zero-initialized memory block has all blocks free even
+ * before memb_init() is called.
+ */
+#define MEMB_ALLOCATED 0xffff
+
+#define NEXT_FREE(m, i) \
+  ((m)->count[i] == 0 ? (i) + 1 : (m)->count[i] - 1)
+#endif /* MEMB_FREELIST */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
-  memset(m->count, 0, m->num);
+  memset(m->count, 0, m->num * sizeof(memb_count_t));
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  m->used = 0;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  m->max_used = 0;
+  m->failed = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,24 +84,71 @@ memb_alloc(struct memb *m)
 {
   int i;
 
-  for(i = 0; i < m->num; ++i) {
-    if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
-    }
+#if MEMB_FREELIST
+  i = m->free;
+  if(i < m->num) {
+    m->free = NEXT_FREE(m, i);
+    m->count[i] = MEMB_ALLOCATED;
+  } else {
+    i = -1;
+  }
+#else /* MEMB_FREELIST */
+  for(i = 0; i < m->num && m->count[i] != 0; ++i);
+  if(i < m->num) {
+    /* If this block was unused, we increase the reference count to
+       indicate that it now is used. */
+    ++(m->count[i]);
+  } else {
+    i = -1;
+  }
+#endif /* MEMB_FREELIST */
+
+  if(i < 0) {
+    /* No free block was found, so we return NULL to indicate failure
+       to allocate block. */
+#if MEMB_STATS
+    m->failed++;
+#endif /* MEMB_STATS */
+    return NULL;
   }
 
-  /* No free block was found, so we return NULL to indicate failure to
-     allocate block. */
-  return NULL;
+#if MEMB_FREELIST || MEMB_STATS
+  ++m->used;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  if(m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+#endif /* MEMB_STATS */
+  return (void *)((char *)m->mem + (i * m->size));
 }
 /*---------------------------------------------------------------------------*/
 char
 memb_free(struct memb *m, void *ptr)
 {
+#if MEMB_FREELIST
+  unsigned long offset;
+  int i;
+
+  /* The index of the block follows from the pointer, which must point
+     to the start of a block. */
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* Make sure that we don't deallocate free memory. */
+  if(m->count[i] == MEMB_ALLOCATED) {
+    m->count[i] = m->free + 1;
+    m->free = i;
+    --m->used;
+  }
+  return 0;
+#else /* MEMB_FREELIST */
   int i;
   char *ptr2;
 
@@ -92,12 +163,18 @@ memb_free(struct memb *m, void *ptr)
       if(m->count[i] > 0) {
 	/* Make sure that we don't deallocate free memory. */
 	--(m->count[i]);
+#if MEMB_STATS
+	if(m->count[i] == 0) {
+	  --m->used;
+	}
+#endif /* MEMB_STATS */
       }
       return m->count[i];
     }
     ptr2 += m->size;
   }
   return -1;
+#endif /* MEMB_FREELIST */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,6 +187,9 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREELIST
+  return m->num - m->used;
+#else /* MEMB_FREELIST */
   int i;
   int num_free = 0;
 
@@ -120,5 +200,6 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREELIST */
 }
 /** @} */
@@ -65,6 +65,40 @@
 
 #include "sys/cc.h"
 
+/**
+ * If non-zero, the free blocks of a memory block are kept in a free
+ * list, which makes memb_alloc() and memb_free() run in constant
+ * time. The links are stored in the per-block control array, so the
+ * contents of a freed block are left untouched. If zero, memb_alloc()
+ * searches for the first free block, which uses one byte less RAM
+ * per block and four bytes less per memory block. This is the
+ * default on the small-RAM AVR and MSP430 CPUs.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#elif defined(__AVR__) || defined(__MSP430__)
+#define MEMB_FREELIST 0
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 1
+#endif /* MEMB_CONF_FREELIST */
+
+/**
+ * If non-zero, each memory block records the largest number of blocks
+ * that have been in use at the same time and the number of failed
+ * allocations, in the max_used and failed fields of struct memb.
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+#if MEMB_FREELIST
+typedef unsigned short memb_count_t;
+#else /* MEMB_FREELIST */
+typedef char memb_count_t;
+#endif /* MEMB_FREELIST */
+
 /**
  * Declare a memory block.
  *
@@ -87,7 +121,7 @@ MEMB(connections, struct connection, 16);
  *
  */
 #define MEMB(name, structure, num) \
-        static char CC_CONCAT(name,_memb_count)[num]; \
+        static memb_count_t CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
@@ -96,8 +130,22 @@ MEMB(connections, struct connection, 16);
 struct memb {
   unsigned short size;
   unsigned short num;
-  char *count;
+  memb_count_t *count;
   void *mem;
+#if MEMB_FREELIST
+  /* Index of the first free block. */
+  unsigned short free;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  /* Number of allocated blocks. */
+  unsigned short used;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  /* Largest number of blocks that have been allocated at once. */
+  unsigned short max_used;
+  /* Number of calls to memb_alloc() that returned NULL. */
+  unsigned short failed;
+#endif /* MEMB_STATS */
 };
 
 /**
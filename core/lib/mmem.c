@@ -49,6 +49,10 @@
 #include "contiki-conf.h"
 #include <string.h>
 
+#if MMEM_HEAPMEM
+#include "lib/heapmem.h"
+#else /* MMEM_HEAPMEM */
+
 #ifdef MMEM_CONF_SIZE
 #define MMEM_SIZE MMEM_CONF_SIZE
 #else
@@ -58,6 +62,7 @@
 LIST(mmemlist);
 unsigned int avail_memory;
 static char memory[MMEM_SIZE];
+#endif /* MMEM_HEAPMEM */
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -82,6 +87,17 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+#if MMEM_HEAPMEM
+  void *ptr;
+
+  ptr = heapmem_alloc(size);
+  if(ptr == NULL) {
+    return 0;
+  }
+  m->ptr = ptr;
+  m->size = size;
+  return 1;
+#else /* MMEM_HEAPMEM */
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
     return 0;
@@ -104,6 +120,7 @@ mmem_alloc(struct mmem *m, unsigned int size)
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
+#endif /* MMEM_HEAPMEM */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -118,6 +135,9 @@ mmem_alloc(struct mmem *m, unsigned int size)
 void
 mmem_free(struct mmem *m)
 {
+#if MMEM_HEAPMEM
+  heapmem_free(m->ptr);
+#else /* MMEM_HEAPMEM */
   struct mmem *n;
 
   if(m->next != NULL) {
@@ -137,6 +157,7 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_HEAPMEM */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -155,8 +176,10 @@ mmem_init(void)
   if(inited) {
     return;
   }
+#if !MMEM_HEAPMEM
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
+#endif /* !MMEM_HEAPMEM */
   inited = 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -59,6 +59,21 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
+/**
+ * If non-zero, managed memory is allocated from the heap memory
+ * allocator (see heapmem.h) instead of from a compacted memory
+ * area. Blocks then never move and freeing a block takes bounded
+ * time, but the heap can become fragmented. MMEM_PTR() keeps
+ * working, so users of this module need no changes.
+ */
+#ifdef MMEM_CONF_HEAPMEM
+#define MMEM_HEAPMEM MMEM_CONF_HEAPMEM
+#else /* MMEM_CONF_HEAPMEM */
+#define MMEM_HEAPMEM 0
+#endif /* MMEM_CONF_HEAPMEM */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
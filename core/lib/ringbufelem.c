@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Ring buffer of fixed-size elements, with batch operations,
+ *         in-place access and an optional multi-producer mode.
+ */
+
+#include "lib/ringbufelem.h"
+
+#include <string.h>
+
+#define SLOT(r, pos) ((r)->data + (uint16_t)((pos) & (r)->mask) * (r)->elem_size)
+
+/*
+ * A counter or ready flag written by one side is read by the other
+ * side only after the elements it covers have been written or read.
+ */
+#if RINGBUFELEM_ATOMIC
+#define LOAD(v)      __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#define STORE(v, x)  __atomic_store_n(&(v), (x), __ATOMIC_RELEASE)
+#else /* RINGBUFELEM_ATOMIC */
+#define LOAD(v)      (v)
+#define STORE(v, x)  ((v) = (x))
+#endif /* RINGBUFELEM_ATOMIC */
+/*---------------------------------------------------------------------------*/
+void
+ringbufelem_init(struct ringbufelem *r, void *data, uint8_t *ready,
+                 uint16_t elem_size, uint8_t size)
+{
+  r->data = data;
+  r->ready = ready;
+  r->elem_size = elem_size;
+  r->mask = size - 1;
+  r->put_ptr = r->get_ptr = r->claim_ptr = 0;
+  if(ready != NULL) {
+    memset(ready, 0, size);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copy n elements between a linear array and the ring, starting at
+ * position pos and wrapping around the end of the ring.
+ */
+static void
+copy_in(struct ringbufelem *r, uint8_t pos, const uint8_t *src, int n)
+{
+  int first;
+
+  first = r->mask + 1 - (pos & r->mask);
+  if(first > n) {
+    first = n;
+  }
+  memcpy(SLOT(r, pos), src, first * r->elem_size);
+  memcpy(r->data, src + first * r->elem_size, (n - first) * r->elem_size);
+}
+/*---------------------------------------------------------------------------*/
+static void
+copy_out(struct ringbufelem *r, uint8_t pos, uint8_t *dst, int n)
+{
+  int first;
+
+  first = r->mask + 1 - (pos & r->mask);
+  if(first > n) {
+    first = n;
+  }
+  memcpy(dst, SLOT(r, pos), first * r->elem_size);
+  memcpy(dst + first * r->elem_size, r->data, (n - first) * r->elem_size);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_put(struct ringbufelem *r, const void *elem)
+{
+  return ringbufelem_put_n(r, elem, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_put_n(struct ringbufelem *r, const void *elems, int n)
+{
+  int space;
+
+  /* The consumer only ever increases get_ptr, so the free space can
+     only grow while we are copying. */
+  space = r->mask + 1 - (uint8_t)(r->put_ptr - LOAD(r->get_ptr));
+  if(n > space) {
+    n = space;
+  }
+  if(n > 0) {
+    copy_in(r, r->put_ptr, elems, n);
+    ringbufelem_commit(r, n);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void *
+ringbufelem_reserve(struct ringbufelem *r, int *n)
+{
+  int space, contiguous;
+
+  space = r->mask + 1 - (uint8_t)(r->put_ptr - LOAD(r->get_ptr));
+  if(space == 0) {
+    return NULL;
+  }
+  if(n != NULL) {
+    contiguous = r->mask + 1 - (r->put_ptr & r->mask);
+    *n = space < contiguous ? space : contiguous;
+  }
+  return SLOT(r, r->put_ptr);
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufelem_commit(struct ringbufelem *r, int n)
+{
+  STORE(r->put_ptr, (uint8_t)(r->put_ptr + n));
+}
+/*---------------------------------------------------------------------------*/
+#if RINGBUFELEM_WITH_MP
+/*
+ * Claim up to n slots of a multi-producer ring. Returns the number of
+ * slots claimed, and their first position in *pos.
+ */
+static int
+claim(struct ringbufelem *r, int n, uint8_t *pos)
+{
+  uint8_t start;
+  int space;
+#if RINGBUFELEM_ATOMIC
+
+  start = __atomic_load_n(&r->claim_ptr, __ATOMIC_RELAXED);
+  do {
+    space = r->mask + 1 - (uint8_t)(start - LOAD(r->get_ptr));
+    if(n > space) {
+      n = space;
+    }
+    if(n <= 0) {
+      return 0;
+    }
+  } while(!__atomic_compare_exchange_n(&r->claim_ptr, &start,
+                                       (uint8_t)(start + n), 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+#else /* RINGBUFELEM_ATOMIC */
+  int s;
+
+  s = RINGBUFELEM_CONF_LOCK();
+  start = r->claim_ptr;
+  space = r->mask + 1 - (uint8_t)(start - r->get_ptr);
+  if(n > space) {
+    n = space;
+  }
+  if(n > 0) {
+    r->claim_ptr = start + n;
+  }
+  RINGBUFELEM_CONF_UNLOCK(s);
+  if(n <= 0) {
+    return 0;
+  }
+#endif /* RINGBUFELEM_ATOMIC */
+  *pos = start;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_put_mp(struct ringbufelem *r, const void *elem)
+{
+  return ringbufelem_put_n_mp(r, elem, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_put_n_mp(struct ringbufelem *r, const void *elems, int n)
+{
+  uint8_t pos;
+  int i;
+
+  n = claim(r, n, &pos);
+  if(n > 0) {
+    copy_in(r, pos, elems, n);
+    for(i = 0; i < n; i++) {
+      STORE(r->ready[(pos + i) & r->mask], 1);
+    }
+  }
+  return n;
+}
+#endif /* RINGBUFELEM_WITH_MP */
+/*---------------------------------------------------------------------------*/
+/*
+ * On a multi-producer ring, the consumer makes the elements that the
+ * producers have finished writing visible by advancing put_ptr past
+ * every slot marked as ready. A slot that is claimed but not yet
+ * written stops the scan, so that elements are taken in the order
+ * their slots were claimed.
+ */
+static uint8_t
+available(struct ringbufelem *r)
+{
+  uint8_t put;
+
+  put = LOAD(r->put_ptr);
+  if(r->ready != NULL) {
+    while(LOAD(r->ready[put & r->mask])) {
+      r->ready[put & r->mask] = 0;
+      put++;
+    }
+    r->put_ptr = put;
+  }
+  return (uint8_t)(put - r->get_ptr);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_get(struct ringbufelem *r, void *elem)
+{
+  return ringbufelem_get_n(r, elem, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_get_n(struct ringbufelem *r, void *elems, int n)
+{
+  int count;
+
+  count = available(r);
+  if(n > count) {
+    n = count;
+  }
+  if(n > 0) {
+    copy_out(r, r->get_ptr, elems, n);
+    ringbufelem_consume(r, n);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void *
+ringbufelem_peek(struct ringbufelem *r, int *n)
+{
+  int count, contiguous;
+
+  count = available(r);
+  if(count == 0) {
+    return NULL;
+  }
+  if(n != NULL) {
+    contiguous = r->mask + 1 - (r->get_ptr & r->mask);
+    *n = count < contiguous ? count : contiguous;
+  }
+  return SLOT(r, r->get_ptr);
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufelem_consume(struct ringbufelem *r, int n)
+{
+  STORE(r->get_ptr, (uint8_t)(r->get_ptr + n));
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_elements(struct ringbufelem *r)
+{
+  return available(r);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_size(const struct ringbufelem *r)
+{
+  return r->mask + 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_full(const struct ringbufelem *r)
+{
+  uint8_t put;
+
+  put = r->ready != NULL ? r->claim_ptr : r->put_ptr;
+  return (uint8_t)(put - r->get_ptr) == r->mask + 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufelem_empty(struct ringbufelem *r)
+{
+  return available(r) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the ringbufelem library
+ */
+
+/** \addtogroup lib
+    @{ */
+/**
+ * \defgroup ringbufelem Ring buffer of fixed-size elements
+ *
+ * The ringbufelem library is a ring buffer of elements of any fixed
+ * size, for handing data from interrupt handlers and drivers over to
+ * processes. Unlike the \ref ringbuf "ringbuf" library, it stores
+ * whole elements, and unlike ringbufindex it also copies them in and
+ * out. Several elements can be moved in one call with
+ * ringbufelem_put_n() and ringbufelem_get_n(), and elements can be
+ * written and read in place: ringbufelem_reserve() returns the
+ * contiguous free region at the end of the ring, which a driver or a
+ * DMA transfer can fill before it is made visible to the consumer
+ * with ringbufelem_commit(). On the other side, ringbufelem_peek()
+ * and ringbufelem_consume() give access to the contiguous region of
+ * elements at the start of the ring.
+ *
+ * The number of elements must be a power of two, at most 128. All of
+ * them can be used. The read and write positions are 8-bit counters,
+ * so that each of them is read and written in a single access on any
+ * CPU.
+ *
+ * By default a ring has a single producer and a single consumer,
+ * which may run in different contexts, for instance an interrupt
+ * handler and a process, without any locking. A ring declared with
+ * RINGBUFELEM_MP() can instead be filled by several producers, for
+ * instance interrupt handlers of different priorities, using
+ * ringbufelem_put_mp() and ringbufelem_put_n_mp(). A producer claims
+ * its slots with an atomic compare-and-swap where the CPU has one,
+ * and with interrupts disabled (RINGBUFELEM_CONF_LOCK()) where it
+ * does not. It then marks each slot as ready when it has written it,
+ * so that no producer ever waits for another. The consumer functions
+ * are the same for both kinds of ring, but the single-producer put
+ * functions must not be used on a multi-producer ring.
+ * Multi-producer rings are only available when RINGBUFELEM_WITH_MP
+ * is non-zero.
+ *
+ * @{
+ */
+
+#ifndef RINGBUFELEM_H_
+#define RINGBUFELEM_H_
+
+#include "contiki-conf.h"
+#include "sys/cc.h"
+
+/**
+ * Critical section used by multi-producer rings on CPUs without
+ * atomic compare-and-swap. RINGBUFELEM_CONF_LOCK() disables
+ * interrupts and returns the previous state, which is passed to
+ * RINGBUFELEM_CONF_UNLOCK(). The default uses the interrupt hooks of
+ * the rtimer architecture, when it has them.
+ */
+#ifndef RINGBUFELEM_CONF_LOCK
+#include "sys/rtimer.h"
+#ifdef RTIMER_ARCH_INTERRUPTS_DISABLE
+#define RINGBUFELEM_CONF_LOCK()    RTIMER_ARCH_INTERRUPTS_DISABLE()
+#define RINGBUFELEM_CONF_UNLOCK(s) RTIMER_ARCH_INTERRUPTS_RESTORE(s)
+#endif /* RTIMER_ARCH_INTERRUPTS_DISABLE */
+#endif /* RINGBUFELEM_CONF_LOCK */
+
+/**
+ * Non-zero if multi-producer rings claim slots with the compiler's
+ * atomic builtins. The default is to use them when 8-bit atomic
+ * operations are always lock-free.
+ */
+#ifdef RINGBUFELEM_CONF_ATOMIC
+#define RINGBUFELEM_ATOMIC RINGBUFELEM_CONF_ATOMIC
+#elif defined(__GCC_ATOMIC_CHAR_LOCK_FREE) && __GCC_ATOMIC_CHAR_LOCK_FREE == 2
+#define RINGBUFELEM_ATOMIC 1
+#else
+#define RINGBUFELEM_ATOMIC 0
+#endif
+
+/**
+ * Non-zero if multi-producer rings are available. They need either
+ * atomic compare-and-swap or a lock, so the default is to enable them
+ * only when one of the two exists.
+ */
+#ifdef RINGBUFELEM_CONF_WITH_MP
+#define RINGBUFELEM_WITH_MP RINGBUFELEM_CONF_WITH_MP
+#elif RINGBUFELEM_ATOMIC || defined(RINGBUFELEM_CONF_LOCK)
+#define RINGBUFELEM_WITH_MP 1
+#else
+#define RINGBUFELEM_WITH_MP 0
+#endif
+
+#if RINGBUFELEM_WITH_MP && !RINGBUFELEM_ATOMIC && !defined(RINGBUFELEM_CONF_LOCK)
+#error RINGBUFELEM_CONF_WITH_MP needs atomic builtins or RINGBUFELEM_CONF_LOCK() and RINGBUFELEM_CONF_UNLOCK()
+#endif
+
+/**
+ * \brief      Structure that holds the state of a ring buffer.
+ *
+ *             This structure holds the state of a ring buffer. The
+ *             actual buffer needs to be defined separately, or with
+ *             the RINGBUFELEM() macro. This struct is an opaque
+ *             structure with no user-visible elements.
+ *
+ */
+struct ringbufelem {
+  uint8_t *data;
+  /* One flag per slot, set by producers of a multi-producer ring when
+     the element in the slot has been written. NULL for a
+     single-producer ring. */
+  volatile uint8_t *ready;
+  uint16_t elem_size;
+  uint8_t mask;
+  /* Free-running counters of elements put and taken. These must be
+     8-bit quantities to avoid race conditions. */
+  volatile uint8_t put_ptr, get_ptr;
+  /* Free-running counter of slots claimed by producers of a
+     multi-producer ring. */
+  volatile uint8_t claim_ptr;
+};
+
+/**
+ * \brief      Declare and initialize a single-producer ring buffer.
+ * \param name The name of the ring buffer
+ * \param type The type of the elements
+ * \param num  The number of elements, a power of two, at most 128
+ *
+ *             The ring buffer is declared static and does not need
+ *             to be initialized with ringbufelem_init().
+ */
+#define RINGBUFELEM(name, type, num)                                    \
+  static type CC_CONCAT(name,_ringbufelem_data)[num];                   \
+  static struct ringbufelem name = {                                    \
+    (uint8_t *)CC_CONCAT(name,_ringbufelem_data), NULL,                 \
+    sizeof(type), (num) - 1, 0, 0, 0 }
+
+#if RINGBUFELEM_WITH_MP
+/**
+ * \brief      Declare and initialize a multi-producer ring buffer.
+ * \param name The name of the ring buffer
+ * \param type The type of the elements
+ * \param num  The number of elements, a power of two, at most 128
+ */
+#define RINGBUFELEM_MP(name, type, num)                                 \
+  static type CC_CONCAT(name,_ringbufelem_data)[num];                   \
+  static uint8_t CC_CONCAT(name,_ringbufelem_ready)[num];               \
+  static struct ringbufelem name = {                                    \
+    (uint8_t *)CC_CONCAT(name,_ringbufelem_data),                       \
+    CC_CONCAT(name,_ringbufelem_ready),                                 \
+    sizeof(type), (num) - 1, 0, 0, 0 }
+#endif /* RINGBUFELEM_WITH_MP */
+
+/**
+ * \brief      Initialize a ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param data A pointer to an array of \c size elements
+ * \param ready NULL for a single-producer ring, or a pointer to an
+ *             array of \c size bytes for a multi-producer ring
+ * \param elem_size The size of an element, in bytes
+ * \param size The number of elements, a power of two, at most 128
+ */
+void ringbufelem_init(struct ringbufelem *r, void *data, uint8_t *ready,
+                      uint16_t elem_size, uint8_t size);
+
+/**
+ * \brief      Put an element in the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elem The element, which is copied into the ring buffer
+ * \return     Non-zero if the element was put, zero if the ring
+ *             buffer was full
+ */
+int ringbufelem_put(struct ringbufelem *r, const void *elem);
+
+/**
+ * \brief      Put several elements in the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elems An array of elements
+ * \param n    The number of elements in the array
+ * \return     The number of elements that were put, which is smaller
+ *             than \c n if the ring buffer became full
+ */
+int ringbufelem_put_n(struct ringbufelem *r, const void *elems, int n);
+
+/**
+ * \brief      Reserve contiguous space at the end of the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param n    If not NULL, set to the number of contiguous free
+ *             elements
+ * \return     A pointer to the first free element, or NULL if the
+ *             ring buffer is full
+ *
+ *             The elements can be written in place and are added to
+ *             the ring buffer with ringbufelem_commit(). Until then,
+ *             the reservation can be abandoned by not committing it.
+ */
+void *ringbufelem_reserve(struct ringbufelem *r, int *n);
+
+/**
+ * \brief      Add reserved elements to the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param n    The number of elements that have been written, at most
+ *             the number returned by ringbufelem_reserve()
+ */
+void ringbufelem_commit(struct ringbufelem *r, int n);
+
+#if RINGBUFELEM_WITH_MP
+/**
+ * \brief      Put an element in a multi-producer ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elem The element, which is copied into the ring buffer
+ * \return     Non-zero if the element was put, zero if the ring
+ *             buffer was full
+ */
+int ringbufelem_put_mp(struct ringbufelem *r, const void *elem);
+
+/**
+ * \brief      Put several elements in a multi-producer ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elems An array of elements
+ * \param n    The number of elements in the array
+ * \return     The number of elements that were put
+ */
+int ringbufelem_put_n_mp(struct ringbufelem *r, const void *elems, int n);
+#endif /* RINGBUFELEM_WITH_MP */
+
+/**
+ * \brief      Get an element from the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elem A pointer to where the element is copied
+ * \return     Non-zero if an element was taken, zero if the ring
+ *             buffer was empty
+ */
+int ringbufelem_get(struct ringbufelem *r, void *elem);
+
+/**
+ * \brief      Get several elements from the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param elems An array where the elements are copied
+ * \param n    The number of elements that fit in the array
+ * \return     The number of elements that were taken
+ */
+int ringbufelem_get_n(struct ringbufelem *r, void *elems, int n);
+
+/**
+ * \brief      Get the contiguous elements at the start of the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param n    If not NULL, set to the number of contiguous elements
+ * \return     A pointer to the first element, or NULL if the ring
+ *             buffer is empty
+ *
+ *             The elements stay in the ring buffer until they are
+ *             removed with ringbufelem_consume().
+ */
+void *ringbufelem_peek(struct ringbufelem *r, int *n);
+
+/**
+ * \brief      Remove elements from the start of the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \param n    The number of elements to remove, at most the number
+ *             returned by ringbufelem_peek()
+ */
+void ringbufelem_consume(struct ringbufelem *r, int n);
+
+/**
+ * \brief      Get the number of elements in the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \return     The number of elements that can be taken
+ */
+int ringbufelem_elements(struct ringbufelem *r);
+
+/**
+ * \brief      Get the size of the ring buffer
+ * \param r    A pointer to a struct ringbufelem
+ * \return     The number of elements that the ring buffer holds
+ */
+int ringbufelem_size(const struct ringbufelem *r);
+
+/**
+ * \brief      Check if the ring buffer is full
+ * \param r    A pointer to a struct ringbufelem
+ * \return     Non-zero if no more element can be put
+ */
+int ringbufelem_full(const struct ringbufelem *r);
+
+/**
+ * \brief      Check if the ring buffer is empty
+ * \param r    A pointer to a struct ringbufelem
+ * \return     Non-zero if there is no element to take
+ */
+int ringbufelem_empty(struct ringbufelem *r);
+
+#endif /* RINGBUFELEM_H_ */
+
+/** @} */
+/** @} */
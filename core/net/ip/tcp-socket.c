@@ -55,11 +55,171 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+/*
+ * Windowed connections keep every byte in flight at the start of the
+ * output buffer, and send and retransmit segments at offsets into it
+ * with uip_send_at(). The congestion window follows New Reno (RFC
+ * 6582): slow start and congestion avoidance, fast retransmit after
+ * UIP_TCP_DUPACKS duplicate ACKs and fast recovery until everything
+ * that was in flight at that point has been acknowledged.
+ */
+static uint16_t
+window_mss(struct tcp_socket *s)
+{
+  return MIN(s->output_data_max_seg, uip_mss());
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_init(struct tcp_socket *s)
+{
+  uint16_t mss = window_mss(s);
+
+  s->flight = 0;
+  s->send_off = 0;
+  s->recover = 0;
+  s->dupacks = 0;
+  s->ssthresh = 0xffff;
+  /* Initial window from RFC 3390. */
+  s->cwnd = MIN(4 * mss, MAX(2 * mss, 4380));
+  uip_conn->windowed = s->send_window > 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+window_size(struct tcp_socket *s)
+{
+  uint16_t wnd;
+
+  wnd = MIN(s->cwnd, s->send_window);
+  if(uip_conn->snd_wnd_known) {
+    wnd = MIN(wnd, uip_conn->snd_wnd);
+  }
+  return wnd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_send(struct tcp_socket *s, uint16_t offset, uint16_t len)
+{
+  uip_send_at(&s->output_data_ptr[offset], len, offset);
+  if(offset + len > s->flight) {
+    s->flight = offset + len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_senddata(struct tcp_socket *s)
+{
+  uint16_t mss = window_mss(s);
+  uint16_t len;
+
+  if(uip_rexmit() && (uip_conn->dupacks == 0 || s->recover == 0)) {
+    s->ssthresh = MAX(s->flight / 2, 2 * mss);
+    if(uip_conn->dupacks == 0) {
+      /* The retransmission timer expired: start over from the oldest
+         unacknowledged byte with a single segment. */
+      s->cwnd = mss;
+      s->send_off = 0;
+      s->recover = 0;
+    } else {
+      /* Fast retransmit, after which we stay in fast recovery until
+         everything in flight now has been acknowledged. */
+      s->cwnd = s->ssthresh + UIP_TCP_DUPACKS * mss;
+      s->recover = s->flight;
+      s->dupacks = uip_conn->dupacks;
+      window_send(s, 0, MIN(mss, s->flight));
+      return;
+    }
+  } else if(uip_conn->dupacks > s->dupacks) {
+    /* Every further duplicate ACK means that one more segment has
+       left the network. */
+    if(s->recover > 0) {
+      s->cwnd += (uip_conn->dupacks - s->dupacks) * mss;
+    }
+    s->dupacks = uip_conn->dupacks;
+  }
+
+  len = MIN(mss, s->output_data_len - s->send_off);
+  if(len > 0 && window_size(s) == 0) {
+    /* The peer has closed its window. Probe it with a single byte,
+       which is sent again on every retransmission timeout until the
+       window opens (RFC 1122, section 4.2.2.17). */
+    if(s->send_off == 0) {
+      window_send(s, 0, 1);
+      s->send_off = 1;
+    }
+    return;
+  }
+  if(len == 0 ||
+     (s->send_off > 0 && s->send_off + len > window_size(s))) {
+    return;
+  }
+  window_send(s, s->send_off, len);
+  s->send_off += len;
+
+  /* Ask for another chance to send if the window has room for more. */
+  len = MIN(mss, s->output_data_len - s->send_off);
+  if(len > 0 && s->send_off + len <= window_size(s)) {
+    tcpip_poll_tcp(uip_conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_acked(struct tcp_socket *s)
+{
+  uint16_t mss = window_mss(s);
+  uint16_t acked;
+
+  acked = s->flight - uip_conn->len;
+  if(acked == 0) {
+    return;
+  }
+  memmove(&s->output_data_ptr[0], &s->output_data_ptr[acked],
+          s->output_data_len - acked);
+  s->output_data_len -= acked;
+  s->output_senddata_len = s->output_data_len;
+  s->flight -= acked;
+  s->send_off = s->send_off > acked ? s->send_off - acked : 0;
+  s->dupacks = 0;
+
+  if(s->recover > 0) {
+    if(acked >= s->recover) {
+      /* Everything that was in flight at the fast retransmit has been
+         acknowledged. */
+      s->recover = 0;
+      s->cwnd = s->ssthresh;
+    } else {
+      /* A partial ACK: more was lost. As uIP drops segments that
+         arrive out of order, we resend the rest of the window rather
+         than just the next segment. */
+      s->recover -= acked;
+      s->cwnd = s->cwnd > acked ? s->cwnd - acked + mss : mss;
+      s->send_off = 0;
+    }
+  } else if(s->cwnd < s->ssthresh) {
+    /* Slow start. */
+    s->cwnd = MIN(0xffff - mss, s->cwnd) + mss;
+  } else {
+    /* Congestion avoidance. */
+    s->cwnd = MIN(0xffff - mss, s->cwnd) +
+      MAX(1, (uint32_t)mss * mss / s->cwnd);
+  }
+
+  call_event(s, TCP_SOCKET_DATA_SENT);
+}
+#endif /* UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 senddata(struct tcp_socket *s)
 {
   int len = MIN(s->output_data_max_seg, uip_mss());
 
+#if UIP_TCP_SEND_WINDOW
+  if(uip_conn->windowed) {
+    window_senddata(s);
+    return;
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
+
   if(s->output_senddata_len > 0) {
     len = MIN(s->output_senddata_len, len);
     s->output_data_send_nxt = len;
@@ -70,6 +230,12 @@ senddata(struct tcp_socket *s)
 static void
 acked(struct tcp_socket *s)
 {
+#if UIP_TCP_SEND_WINDOW
+  if(uip_conn->windowed) {
+    window_acked(s);
+    return;
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
   if(s->output_senddata_len > 0) {
     /* Copy the data in the outputbuf down and update outputbufptr and
        outputbuf_lastsent */
@@ -162,6 +328,10 @@ appcall(void *state)
 	   s->listen_port == uip_htons(uip_conn->lport)) {
 	  s->flags &= ~TCP_SOCKET_FLAGS_LISTENING;
           s->output_data_max_seg = uip_mss();
+#if UIP_TCP_SEND_WINDOW
+          s->c = uip_conn;
+          window_init(s);
+#endif /* UIP_TCP_SEND_WINDOW */
 	  tcp_markconn(uip_conn, s);
 	  call_event(s, TCP_SOCKET_CONNECTED);
 	  break;
@@ -169,6 +339,9 @@ appcall(void *state)
       }
     } else {
       s->output_data_max_seg = uip_mss();
+#if UIP_TCP_SEND_WINDOW
+      window_init(s);
+#endif /* UIP_TCP_SEND_WINDOW */
       call_event(s, TCP_SOCKET_CONNECTED);
     }
 
@@ -282,6 +455,9 @@ tcp_socket_register(struct tcp_socket *s, void *ptr,
 
   s->listen_port = 0;
   s->flags = TCP_SOCKET_FLAGS_NONE;
+#if UIP_TCP_SEND_WINDOW
+  s->send_window = TCP_SOCKET_SEND_WINDOW;
+#endif /* UIP_TCP_SEND_WINDOW */
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -356,6 +532,14 @@ tcp_socket_send(struct tcp_socket *s,
     s->output_senddata_len = s->output_data_len;
   }
 
+#if UIP_TCP_SEND_WINDOW
+  /* Windowed connections send as soon as they can, rather than at
+     the next periodic poll. */
+  if(len > 0 && s->c != NULL && s->c->windowed) {
+    tcpip_poll_tcp(s->c);
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
+
   return len;
 }
 /*---------------------------------------------------------------------------*/
@@ -398,3 +582,16 @@ tcp_socket_max_sendlen(struct tcp_socket *s)
   return s->output_data_maxlen - s->output_data_len;
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+int
+tcp_socket_set_send_window(struct tcp_socket *s, uint16_t window)
+{
+  if(s == NULL) {
+    return -1;
+  }
+
+  s->send_window = window;
+  return 1;
+}
+#endif /* UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
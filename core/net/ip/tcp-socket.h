@@ -34,6 +34,21 @@
 
 #include "uip.h"
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * The default send window of a TCP socket, in bytes. This is the
+ * most data a connection has in flight at any time, in addition to
+ * the limits set by the congestion window and by the remote host. A
+ * window of zero makes the socket send one segment at a time. The
+ * output buffer must be large enough to hold the window.
+ */
+#ifdef TCP_SOCKET_CONF_SEND_WINDOW
+#define TCP_SOCKET_SEND_WINDOW TCP_SOCKET_CONF_SEND_WINDOW
+#else /* TCP_SOCKET_CONF_SEND_WINDOW */
+#define TCP_SOCKET_SEND_WINDOW (4 * UIP_TCP_MSS)
+#endif /* TCP_SOCKET_CONF_SEND_WINDOW */
+#endif /* UIP_TCP_SEND_WINDOW */
+
 struct tcp_socket;
 
 typedef enum {
@@ -103,6 +118,16 @@ struct tcp_socket {
   uint8_t flags;
   uint16_t listen_port;
   struct uip_conn *c;
+
+#if UIP_TCP_SEND_WINDOW
+  uint16_t send_window;
+  uint16_t flight;
+  uint16_t send_off;
+  uint16_t cwnd;
+  uint16_t ssthresh;
+  uint16_t recover;
+  uint8_t dupacks;
+#endif /* UIP_TCP_SEND_WINDOW */
 };
 
 enum {
@@ -284,4 +309,28 @@ int tcp_socket_unregister(struct tcp_socket *s);
  */
 int tcp_socket_max_sendlen(struct tcp_socket *s);
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * \brief      Set the send window of a TCP socket
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param window The send window in bytes, or zero to send one segment at a time
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ *
+ *             This function sets the largest amount of data that
+ *             the socket may have sent but not yet had acknowledged
+ *             by the remote host. With a window of several segments,
+ *             bulk transfers are no longer limited to one segment
+ *             per round-trip time. Lost segments are retransmitted
+ *             from the output buffer, which should therefore be at
+ *             least as large as the window. Switching between a
+ *             zero and a non-zero window takes effect at the next
+ *             connection of the socket.
+ *
+ *             The default window is TCP_SOCKET_SEND_WINDOW.
+ *
+ */
+int tcp_socket_set_send_window(struct tcp_socket *s, uint16_t window);
+#endif /* UIP_TCP_SEND_WINDOW */
+
 #endif /* TCP_SOCKET_H */
@@ -111,6 +111,22 @@ enum {
   PACKET_INPUT
 };
 
+#if TCPIP_INPUT_QUEUE
+#include "lib/ringbufelem.h"
+
+/* A packet waiting in the input queue, laid out like uip_buf. */
+struct input_packet {
+  uip_buf_t buf;
+  uint16_t len;
+};
+
+RINGBUFELEM(input_queue, struct input_packet, TCPIP_INPUT_QUEUE);
+
+struct tcpip_input_stats tcpip_input_stats;
+
+static void input_queue_process(void);
+#endif /* TCPIP_INPUT_QUEUE */
+
 /* Called on IP packet output. */
 #if NETSTACK_CONF_WITH_IPV6
 
@@ -406,7 +422,7 @@ eventhandler(process_event_t ev, process_data_t data)
       for(cptr = &uip_udp_conns[0];
           cptr < &uip_udp_conns[UIP_UDP_CONNS]; ++cptr) {
         if(cptr->appstate.p == p) {
-          cptr->lport = 0;
+          uip_udp_remove(cptr);
         }
       }
     }
@@ -515,6 +531,12 @@ eventhandler(process_event_t ev, process_data_t data)
   case PACKET_INPUT:
     packet_input();
     break;
+
+#if TCPIP_INPUT_QUEUE
+  case PROCESS_EVENT_POLL:
+    input_queue_process();
+    break;
+#endif /* TCPIP_INPUT_QUEUE */
   };
 }
 /*---------------------------------------------------------------------------*/
@@ -525,6 +547,92 @@ tcpip_input(void)
   uip_clear_buf();
 }
 /*---------------------------------------------------------------------------*/
+#if TCPIP_INPUT_QUEUE
+static void
+input_queued(void)
+{
+  int depth;
+
+  tcpip_input_stats.packets++;
+  depth = ringbufelem_elements(&input_queue);
+  if(depth > tcpip_input_stats.max_depth) {
+    tcpip_input_stats.max_depth = depth;
+  }
+  process_poll(&tcpip_process);
+}
+/*---------------------------------------------------------------------------*/
+int
+tcpip_input_enqueue(const uint8_t *data, uint16_t len)
+{
+  struct input_packet *p;
+
+  p = ringbufelem_reserve(&input_queue, NULL);
+  if(p == NULL || len > UIP_BUFSIZE - UIP_LLH_LEN) {
+    tcpip_input_stats.dropped++;
+    return 0;
+  }
+  memcpy(&p->buf.u8[UIP_LLH_LEN], data, len);
+  p->len = len;
+  ringbufelem_commit(&input_queue, 1);
+  input_queued();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+tcpip_input_reserve(void)
+{
+  struct input_packet *p;
+
+  p = ringbufelem_reserve(&input_queue, NULL);
+  return p != NULL ? p->buf.u8 : NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+tcpip_input_commit(uint16_t len)
+{
+  struct input_packet *p;
+
+  p = ringbufelem_reserve(&input_queue, NULL);
+  if(p == NULL || len > UIP_BUFSIZE - UIP_LLH_LEN) {
+    tcpip_input_stats.dropped++;
+    return;
+  }
+  p->len = len;
+  ringbufelem_commit(&input_queue, 1);
+  input_queued();
+}
+/*---------------------------------------------------------------------------*/
+int
+tcpip_input_queue_depth(void)
+{
+  return ringbufelem_elements(&input_queue);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_queue_process(void)
+{
+  struct input_packet *p;
+  int n;
+
+  /* Process a burst of queued packets in uip_buf, and let other
+     processes run before the next one. */
+  for(n = 0; n < TCPIP_INPUT_BURST; n++) {
+    p = ringbufelem_peek(&input_queue, NULL);
+    if(p == NULL) {
+      return;
+    }
+    memcpy(uip_buf, p->buf.u8, UIP_LLH_LEN + p->len);
+    uip_len = p->len;
+    ringbufelem_consume(&input_queue, 1);
+    packet_input();
+    uip_clear_buf();
+  }
+  if(!ringbufelem_empty(&input_queue)) {
+    process_poll(&tcpip_process);
+  }
+}
+#endif /* TCPIP_INPUT_QUEUE */
+/*---------------------------------------------------------------------------*/
 #if NETSTACK_CONF_WITH_IPV6
 void
 tcpip_ipv6_output(void)
@@ -752,7 +860,7 @@ tcpip_ipv6_output(void)
 void
 tcpip_poll_udp(struct uip_udp_conn *conn)
 {
-  process_post(&tcpip_process, UDP_POLL, conn);
+  process_post_prio(&tcpip_process, UDP_POLL, conn, PROCESS_PRIO_HIGH);
 }
 #endif /* UIP_UDP */
 /*---------------------------------------------------------------------------*/
@@ -760,7 +868,7 @@ tcpip_poll_udp(struct uip_udp_conn *conn)
 void
 tcpip_poll_tcp(struct uip_conn *conn)
 {
-  process_post(&tcpip_process, TCP_POLL, conn);
+  process_post_prio(&tcpip_process, TCP_POLL, conn, PROCESS_PRIO_HIGH);
 }
 #endif /* UIP_TCP */
 /*---------------------------------------------------------------------------*/
@@ -332,10 +332,88 @@ CCIF extern process_event_t tcpip_event;
  *             deliver an incoming packet to the TCP/IP stack. The
  *             incoming packet must be present in the uip_buf buffer,
  *             and the length of the packet must be in the global
- *             uip_len variable.
+ *             uip_len variable. The packet is processed right away,
+ *             without going through the event queue.
  */
 CCIF void tcpip_input(void);
 
+/**
+ * Number of packets that can wait in the input queue, a power of
+ * two. Drivers that receive bursts of packets, such as tun or SLIP
+ * interfaces of a border router, can queue them with
+ * tcpip_input_enqueue() or tcpip_input_reserve() instead of handing
+ * each one over in uip_buf with tcpip_input(). Zero (the default)
+ * leaves the queue out.
+ */
+#ifdef TCPIP_CONF_INPUT_QUEUE
+#define TCPIP_INPUT_QUEUE TCPIP_CONF_INPUT_QUEUE
+#else /* TCPIP_CONF_INPUT_QUEUE */
+#define TCPIP_INPUT_QUEUE 0
+#endif /* TCPIP_CONF_INPUT_QUEUE */
+
+/**
+ * Maximum number of queued packets processed each time
+ * tcpip_process runs, before other processes get a chance to run.
+ */
+#ifdef TCPIP_CONF_INPUT_BURST
+#define TCPIP_INPUT_BURST TCPIP_CONF_INPUT_BURST
+#else /* TCPIP_CONF_INPUT_BURST */
+#define TCPIP_INPUT_BURST 4
+#endif /* TCPIP_CONF_INPUT_BURST */
+
+#if TCPIP_INPUT_QUEUE
+/**
+ * Statistics of the input queue.
+ */
+struct tcpip_input_stats {
+  uint32_t packets;     /**< Packets queued */
+  uint32_t dropped;     /**< Packets dropped because the queue was full */
+  uint16_t max_depth;   /**< Largest number of packets in the queue */
+};
+
+extern struct tcpip_input_stats tcpip_input_stats;
+
+/**
+ * \brief      Queue an incoming packet for the TCP/IP stack
+ * \param data The IP packet, without link-layer header
+ * \param len  The length of the packet
+ * \return     Non-zero if the packet was queued, zero if it was
+ *             dropped because the queue was full or the packet does
+ *             not fit in uip_buf
+ *
+ *             The packet is copied and processed later by
+ *             tcpip_process, as if it had been passed to
+ *             tcpip_input(). uip_buf is not used. tcpip_process is
+ *             polled, so the packet is processed before any event
+ *             waiting in the event queue, in either priority lane.
+ */
+int tcpip_input_enqueue(const uint8_t *data, uint16_t len);
+
+/**
+ * \brief      Get a free buffer in the input queue
+ * \return     A buffer of UIP_BUFSIZE bytes laid out like uip_buf,
+ *             or NULL if the queue is full
+ *
+ *             A driver can receive a packet directly into the
+ *             buffer, at offset UIP_LLH_LEN, and queue it with
+ *             tcpip_input_commit(). The buffer is only queued when
+ *             it is committed, so it can be abandoned by not
+ *             committing it.
+ */
+uint8_t *tcpip_input_reserve(void);
+
+/**
+ * \brief      Queue the packet received in the reserved buffer
+ * \param len  The length of the packet, as it would be in uip_len
+ */
+void tcpip_input_commit(uint16_t len);
+
+/**
+ * \brief      Get the number of packets waiting in the input queue
+ */
+int tcpip_input_queue_depth(void);
+#endif /* TCPIP_INPUT_QUEUE */
+
 /**
  * \brief Output packet to layer 2
  * The eventual parameter is the MAC address of the destination.
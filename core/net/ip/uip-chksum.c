@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum (RFC 1071), with incremental updates
+ *         of existing checksums (RFC 1624).
+ */
+
+#include "net/ip/uip-chksum.h"
+#include "net/ip/uip.h"
+
+#include <string.h>
+
+/* A platform may provide its own uip_chksum_add(), typically using
+   vector instructions. */
+#ifdef UIP_CHKSUM_CONF_ARCH
+uint16_t UIP_CHKSUM_CONF_ARCH(uint16_t sum, const uint8_t *data, uint16_t len);
+#endif /* UIP_CHKSUM_CONF_ARCH */
+
+/* Sum 32-bit words into a 64-bit accumulator. This is only worth it
+   on CPUs with 64-bit registers. */
+#ifdef UIP_CHKSUM_CONF_64BIT
+#define UIP_CHKSUM_64BIT UIP_CHKSUM_CONF_64BIT
+#elif defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define UIP_CHKSUM_64BIT 1
+#else
+#define UIP_CHKSUM_64BIT 0
+#endif
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+#ifdef UIP_CHKSUM_CONF_ARCH
+  return UIP_CHKSUM_CONF_ARCH(sum, data, len);
+#else /* UIP_CHKSUM_CONF_ARCH */
+  /* The carries are accumulated in the upper bits and folded back in
+     at the end, which is the same as adding each carry as it
+     occurs. */
+  uint32_t acc = sum;
+
+#if UIP_CHKSUM_64BIT
+  if(len >= 8) {
+    uint64_t acc64 = 0;
+    uint32_t word;
+    uint16_t s;
+
+    /* Words are loaded in host byte order. The sum of byte swapped
+       words is the byte swapped sum (RFC 1071, section 2). */
+    while(len >= 4) {
+      memcpy(&word, data, sizeof(word));
+      acc64 += word;
+      data += 4;
+      len -= 4;
+    }
+    acc64 = (acc64 & 0xffffffff) + (acc64 >> 32);
+    acc64 = (acc64 & 0xffffffff) + (acc64 >> 32);
+    acc64 = (acc64 & 0xffff) + (acc64 >> 16);
+    acc64 = (acc64 & 0xffff) + (acc64 >> 16);
+    acc64 = (acc64 & 0xffff) + (acc64 >> 16);
+    s = (uint16_t)acc64;
+#if UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN
+    s = (s << 8) | (s >> 8);
+#endif /* UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN */
+    acc += s;
+  }
+#endif /* UIP_CHKSUM_64BIT */
+
+  while(len >= 2) {
+    acc += ((uint16_t)data[0] << 8) | data[1];
+    data += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    acc += (uint16_t)data[0] << 8;
+  }
+
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Return sum in host byte order. */
+  return (uint16_t)acc;
+#endif /* UIP_CHKSUM_CONF_ARCH */
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_update16(uint16_t chksum, uint16_t old_word, uint16_t new_word)
+{
+  uint32_t sum;
+
+  /* RFC 1624, equation 3: HC' = ~(~HC + ~m + m'). Unless all the
+     data is zero, this gives the same result as recomputing the
+     checksum, where HC' = HC + m + ~m' of RFC 1141 may give 0xffff
+     instead of 0. */
+  sum = (uint16_t)~chksum;
+  sum += (uint16_t)~old_word;
+  sum += new_word;
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+
+  return (uint16_t)~sum;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_update(uint16_t chksum, uint16_t old_sum, uint16_t new_sum)
+{
+  return uip_chksum_update16(chksum, uip_htons(old_sum), uip_htons(new_sum));
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum (RFC 1071), with incremental updates
+ *         of existing checksums (RFC 1624).
+ */
+
+#ifndef UIP_CHKSUM_H_
+#define UIP_CHKSUM_H_
+
+#include "contiki.h"
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * Add data to a 16-bit ones' complement sum.
+ *
+ * The data is summed as a sequence of 16-bit big endian words,
+ * starting at the first byte. An odd trailing byte is padded with a
+ * zero byte. Data that is summed in several parts must therefore be
+ * split at even offsets.
+ *
+ * \param sum The sum so far, in host byte order, or 0.
+ * \param data A pointer to the data.
+ * \param len The length of the data, in bytes.
+ *
+ * \return The new sum, in host byte order.
+ */
+uint16_t uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * Update a checksum after a 16-bit word of the data has changed.
+ *
+ * The checksum and the words are taken as they are stored in the
+ * packet, in network byte order. As with a computed checksum, a UDP
+ * checksum of 0 must be sent as 0xffff.
+ *
+ * \param chksum The checksum field before the change.
+ * \param old_word The word before the change.
+ * \param new_word The word after the change.
+ *
+ * \return The checksum field after the change.
+ */
+uint16_t uip_chksum_update16(uint16_t chksum,
+                             uint16_t old_word, uint16_t new_word);
+
+/**
+ * Update a checksum after a part of the data has changed.
+ *
+ * This is used when a field longer than 16 bits changes, such as an
+ * address in a pseudo header. The sums of the part before and after
+ * the change are computed with uip_chksum_add().
+ *
+ * \param chksum The checksum field before the change, in network
+ * byte order.
+ * \param old_sum The sum of the changed part before the change, in
+ * host byte order.
+ * \param new_sum The sum of the changed part after the change, in
+ * host byte order.
+ *
+ * \return The checksum field after the change, in network byte order.
+ */
+uint16_t uip_chksum_update(uint16_t chksum,
+                           uint16_t old_sum, uint16_t new_sum);
+
+/** @} */
+
+#endif /* UIP_CHKSUM_H_ */
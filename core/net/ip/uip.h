@@ -639,6 +639,38 @@ struct uip_conn *uip_connect(const uip_ipaddr_t *ripaddr, uint16_t port);
  */
 CCIF void uip_send(const void *data, int len);
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * Send data at an offset into the send window of the current connection.
+ *
+ * On a connection that has been marked as windowed (see
+ * uip_conn::windowed), this function sends a segment that starts \c
+ * offset bytes after the oldest unacknowledged byte. New data is sent
+ * at the end of the data that is already in flight, and segments are
+ * retransmitted from the start of the window. The segment must not
+ * start beyond the end of the data in flight.
+ *
+ * When invoked with uip_rexmit(), the application should resend the
+ * segment at offset zero. If uip_conn::dupacks is non-zero, the
+ * retransmission was caused by duplicate ACKs rather than by the
+ * retransmission timer.
+ *
+ * \note The configuration parameter UIP_TCP_SEND_WINDOW must be set
+ * for this function to be available.
+ *
+ * \param data A pointer to the data which is to be sent.
+ *
+ * \param len The maximum amount of data bytes to be sent.
+ *
+ * \param offset The offset of the data from the start of the window.
+ *
+ * \hideinitializer
+ */
+#define uip_send_at(data, len, offset) do { uip_sndoff = (offset);     \
+    uip_send((data), (len));                                            \
+  } while(0)
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /**
  * The length of any incoming data that is currently available (if available)
  * in the uip_appdata buffer.
@@ -874,7 +906,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+#define uip_udp_remove(conn) uip_udp_bind(conn, 0)
+#else /* UIP_CONN_HASH */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_CONN_HASH */
 
 /**
  * Bind a UDP connection to a local port.
@@ -886,7 +922,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+void uip_udp_bind(struct uip_udp_conn *conn, uint16_t port);
+#else /* UIP_CONN_HASH */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_CONN_HASH */
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1323,6 +1363,11 @@ extern uint8_t uip_ext_len;
 extern uint16_t uip_urglen, uip_surglen;
 #endif /* UIP_URGDATA > 0 */
 
+#if UIP_TCP_SEND_WINDOW
+/* The offset of the segment to be sent, see uip_send_at(). */
+extern uint16_t uip_sndoff;
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /*
  * Clear uIP buffer
  *
@@ -1370,6 +1415,14 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
                               segment sent. */
+#if UIP_TCP_SEND_WINDOW
+  uint8_t windowed;      /**< Set by the application to send several
+                              segments at a time, see uip_send_at(). */
+  uint8_t dupacks;       /**< The number of duplicate ACKs received. */
+  uint8_t snd_wnd_known; /**< Set once the remote host has advertised
+                              a window. */
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+#endif /* UIP_TCP_SEND_WINDOW */
 
   uip_tcp_appstate_t appstate; /** The application state. */
 };
@@ -1904,6 +1957,7 @@ struct uip_udp_hdr {
 #define UIP_PROTO_ROUTING     43
 #define UIP_PROTO_FRAG        44
 #define UIP_PROTO_NONE        59
+#define UIP_PROTO_IPV6        41
 /** @} */
 
 /** @{ */
@@ -435,6 +435,26 @@ void uip_log(char *msg);
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * Determines if incoming UDP datagrams and TCP segments are matched
+ * with their connection, or listening port, through hash indexes over
+ * the local ports instead of by scanning all connections. This pays
+ * off when UIP_CONF_UDP_CONNS or UIP_CONF_MAX_CONNECTIONS are large.
+ * The indexes take one byte per connection and per listening port,
+ * plus a bucket array of about the same size (twice that with 255
+ * connections or more). Only supported by the IPv6 stack.
+ *
+ * \note With the indexes enabled, the local port of a UDP connection
+ * must only be changed with uip_udp_bind() and uip_udp_remove().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH
+#define UIP_CONN_HASH (UIP_CONF_CONN_HASH && NETSTACK_CONF_WITH_IPV6)
+#else /* UIP_CONF_CONN_HASH */
+#define UIP_CONN_HASH 0
+#endif /* UIP_CONF_CONN_HASH */
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -500,6 +520,34 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * Determines if TCP connections may have more than one segment in
+ * flight.
+ *
+ * With this option, an application can mark a connection as windowed
+ * (see uip_conn::windowed) and then send new segments before the
+ * earlier ones have been acknowledged, with uip_send_at(). The
+ * application keeps all unacknowledged data and retransmits it
+ * itself, also when uIP reports duplicate ACKs. Only supported by
+ * the IPv6 stack.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SEND_WINDOW
+#define UIP_TCP_SEND_WINDOW (UIP_CONF_TCP_SEND_WINDOW && NETSTACK_CONF_WITH_IPV6)
+#else /* UIP_CONF_TCP_SEND_WINDOW */
+#define UIP_TCP_SEND_WINDOW 0
+#endif /* UIP_CONF_TCP_SEND_WINDOW */
+
+/**
+ * The number of duplicate ACKs after which a windowed connection
+ * retransmits its oldest segment without waiting for the
+ * retransmission timer.
+ *
+ * This should not be changed.
+ */
+#define UIP_TCP_DUPACKS 3
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -58,6 +58,7 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uip_arch.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ipv4/uip-fw.h"
 #ifdef AODV_COMPLIANCE
 #include "net/ipv4/uaodv-def.h"
@@ -403,6 +404,7 @@ uint8_t
 uip_fw_forward(void)
 {
   struct fwcache_entry *fw;
+  uint16_t ttl_proto;
 
   /* First check if the packet is destined for ourselves and return 0
      to indicate that the packet should be processed locally. */
@@ -462,14 +464,12 @@ uip_fw_forward(void)
   }
   
   /* Decrement the TTL (time-to-live) value in the IP header */
+  ttl_proto = uip_htons((BUF->ttl << 8) | BUF->proto);
   BUF->ttl = BUF->ttl - 1;
   
-  /* Update the IP checksum. */
-  if(BUF->ipchksum >= UIP_HTONS(0xffff - 0x0100)) {
-    BUF->ipchksum = BUF->ipchksum + UIP_HTONS(0x0100) + 1;
-  } else {
-    BUF->ipchksum = BUF->ipchksum + UIP_HTONS(0x0100);
-  }
+  /* Update the IP checksum for the 16-bit word that holds the TTL. */
+  BUF->ipchksum = uip_chksum_update16(BUF->ipchksum, ttl_proto,
+                                      uip_htons((BUF->ttl << 8) | BUF->proto));
 
   if(uip_len > 0) {
     uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
@@ -66,6 +66,7 @@
 #include "net/ip/tcpip.h"
 #include "net/ip/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
@@ -101,6 +102,16 @@ void uip_log(char *msg);
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 #endif /* SICSLOWPAN_COMPRESSION */
 
+/* Compress the RPL hop-by-hop option, the RPL Source Routing Header
+   and IPv6-in-IPv6 encapsulation into 6LoWPAN Routing Headers (RFC
+   8138) along with IPHC. The frames are sent in 6LoWPAN page 1, which
+   all the nodes of the network must then support. */
+#ifdef SICSLOWPAN_CONF_6LORH
+#define SICSLOWPAN_6LORH SICSLOWPAN_CONF_6LORH
+#else
+#define SICSLOWPAN_6LORH 0
+#endif
+
 #define GET16(ptr,index) (((uint16_t)((ptr)[index] << 8)) | ((ptr)[(index) + 1]))
 #define SET16(ptr,index,value) do {     \
   (ptr)[index] = ((value) >> 8) & 0xff; \
@@ -210,6 +221,10 @@ static uint8_t uncomp_hdr_len;
 static int last_tx_status;
 /** @} */
 
+#if SICSLOWPAN_STATS
+struct sicslowpan_stats sicslowpan_stats;
+#endif /* SICSLOWPAN_STATS */
+
 
 static int last_rssi;
 
@@ -220,20 +235,11 @@ static int last_rssi;
 #if SICSLOWPAN_CONF_FRAG
 static uint16_t my_tag;
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
-
-/* This needs to be defined in NBR / Nodes depending on available RAM   */
-/*   and expected reassembly requirements                               */
-#ifdef SICSLOWPAN_CONF_FRAGMENT_BUFFERS
-#define SICSLOWPAN_FRAGMENT_BUFFERS SICSLOWPAN_CONF_FRAGMENT_BUFFERS
-#else
-#define SICSLOWPAN_FRAGMENT_BUFFERS 12
-#endif
-
 /* REASS_CONTEXTS corresponds to the number of simultaneous
- * reassemblies that can be made. NOTE: the first buffer for each
- * reassembly is stored in the context since it can be larger than the
- * rest of the fragments due to header compression.
+ * reassemblies that can be made. Each context has a buffer for a
+ * whole datagram, in which the fragments are stored at their final
+ * offset as they arrive, so that the datagram can be moved to uip_buf
+ * with a single copy once it is complete.
  **/
 #ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
 #define SICSLOWPAN_REASS_CONTEXTS SICSLOWPAN_CONF_REASS_CONTEXTS
@@ -241,198 +247,363 @@ static uint16_t my_tag;
 #define SICSLOWPAN_REASS_CONTEXTS 2
 #endif
 
-/* The size of each fragment (IP payload) for the 6lowpan fragmentation */
-#ifdef SICSLOWPAN_CONF_FRAGMENT_SIZE
-#define SICSLOWPAN_FRAGMENT_SIZE SICSLOWPAN_CONF_FRAGMENT_SIZE
+/* The size of the reassembly buffer of each context, i.e., the
+   largest datagram that can be reassembled. There is no point in
+   making it larger than what fits in uip_buf. */
+#ifdef SICSLOWPAN_CONF_REASS_BUFSIZE
+#define SICSLOWPAN_REASS_BUFSIZE SICSLOWPAN_CONF_REASS_BUFSIZE
+#else
+#define SICSLOWPAN_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
+#endif
+
+/* Forward the fragments of datagrams that are not for us as they
+   arrive, instead of reassembling the datagram and fragmenting it
+   again at every hop. The first fragment is routed by uIP as a
+   datagram of its own. A virtual reassembly buffer (VRB) entry then
+   maps the sender and tag of the datagram to the next hop and the
+   new tag, through which the following fragments are switched
+   directly. As uIP only sees the first fragment, the next hop must be
+   known: with UIP_CONF_IPV6_QUEUE_PKT, a datagram held for address
+   resolution is dropped. */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+/* The number of datagrams that can be forwarded at the same time */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
 #else
-#define SICSLOWPAN_FRAGMENT_SIZE 110
+#define SICSLOWPAN_VRB_ENTRIES 4
 #endif
 
-/* Assuming that the worst growth for uncompression is 38 bytes */
-#define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
+/* The number of 8-octet units in a reassembly buffer */
+#define REASS_UNITS ((SICSLOWPAN_REASS_BUFSIZE + 7) / 8)
+
+/* Contexts are found through a hash index on the sender and tag of
+   the fragments, with collisions chained through the contexts. */
+#define REASS_HASH_SIZE (2 * SICSLOWPAN_REASS_CONTEXTS)
+#define REASS_NONE 0xff
+
+#if SICSLOWPAN_REASS_CONTEXTS >= REASS_NONE
+#error SICSLOWPAN_CONF_REASS_CONTEXTS must be less than 255
+#endif
 
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
   linkaddr_t sender;
-  /** The destination address of the fragments being merged */
-  linkaddr_t receiver;
   /** When reassembling, the tag in the fragments being merged. */
   uint16_t tag;
-  /** Total length of the fragmented packet */
+  /** Total length of the fragmented packet, 0 if the context is free */
   uint16_t len;
-  /** Current length of reassembled fragments */
-  uint16_t reassembled_len;
+  /** Number of 8-octet units received so far */
+  uint16_t received_units;
+  /** Next context in the same hash bucket, or in the free list */
+  uint8_t next;
   /** Reassembly %process %timer. */
   struct timer reass_timer;
-
-  /** Fragment size of first fragment */
-  uint16_t first_frag_len;
-  /** First fragment - needs a larger buffer since the size is uncompressed size
-   and we need to know total size to know when we have received last fragment. */
-  uint8_t first_frag[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
+  /** One bit per 8-octet unit of the datagram, set once received */
+  uint8_t received[(REASS_UNITS + 7) / 8];
+  /** The datagram being reassembled, aligned like uip_buf since the
+      header is uncompressed in place. */
+  union {
+    uint32_t u32[(SICSLOWPAN_REASS_BUFSIZE + 3) / 4];
+    uint8_t u8[SICSLOWPAN_REASS_BUFSIZE];
+  } buf;
 };
 
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
+static uint8_t frag_hash[REASS_HASH_SIZE];
+static uint8_t frag_free;
 
-struct sicslowpan_frag_buf {
-  /* the index of the frag_info */
-  uint8_t index;
-  /* Fragment offset */
-  uint8_t offset;
-  /* Length of this fragment (if zero this buffer is not allocated) */
-  uint8_t len;
-  uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
-};
+/*---------------------------------------------------------------------------*/
+static uint8_t
+frag_hash_index(const linkaddr_t *sender, uint16_t tag)
+{
+  uint16_t h;
+  int i;
 
-static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
+  h = tag;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 33 + sender->u8[i];
+  }
+  return h % REASS_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_fragments(void)
+{
+  int i;
 
+  for(i = 0; i < REASS_HASH_SIZE; i++) {
+    frag_hash[i] = REASS_NONE;
+  }
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    frag_info[i].len = 0;
+    frag_info[i].next = i + 1 < SICSLOWPAN_REASS_CONTEXTS ? i + 1 : REASS_NONE;
+  }
+  frag_free = 0;
+}
 /*---------------------------------------------------------------------------*/
-static int
+static void
 clear_fragments(uint8_t frag_info_index)
 {
-  int i, clear_count;
-  clear_count = 0;
+  uint8_t *p;
+
+  if(frag_info[frag_info_index].len == 0) {
+    return;
+  }
+  p = &frag_hash[frag_hash_index(&frag_info[frag_info_index].sender,
+                                 frag_info[frag_info_index].tag)];
+  while(*p != frag_info_index) {
+    p = &frag_info[*p].next;
+  }
+  *p = frag_info[frag_info_index].next;
+
   frag_info[frag_info_index].len = 0;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
-      /* deallocate the buffer */
-      frag_buf[i].len = 0;
-      clear_count++;
+  frag_info[frag_info_index].next = frag_free;
+  frag_free = frag_info_index;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the context reassembling the datagram with the given tag from
+   the sender of the packet in packetbuf, or -1 */
+static int8_t
+find_fragments(uint16_t tag)
+{
+  const linkaddr_t *sender;
+  uint8_t i;
+
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  for(i = frag_hash[frag_hash_index(sender, tag)];
+      i != REASS_NONE; i = frag_info[i].next) {
+    if(frag_info[i].tag == tag && linkaddr_cmp(&frag_info[i].sender, sender)) {
+      if(timer_expired(&frag_info[i].reass_timer)) {
+        PRINTF("*** Reassembly timed out - tag: %d\n", tag);
+        SICSLOWPAN_STAT(sicslowpan_stats.reass_timeouts++);
+        clear_fragments(i);
+        return -1;
+      }
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Start reassembling a new datagram, returns its context or -1 */
+static int8_t
+new_fragments(uint16_t tag, uint16_t frag_size)
+{
+  uint8_t i;
+
+  if(frag_free == REASS_NONE) {
+    /* Only look for expired contexts when all are in use */
+    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
+        PRINTF("*** Reassembly timed out - tag: %d\n", frag_info[i].tag);
+        SICSLOWPAN_STAT(sicslowpan_stats.reass_timeouts++);
+        clear_fragments(i);
+      }
+    }
+    if(frag_free == REASS_NONE) {
+      PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
+      SICSLOWPAN_STAT(sicslowpan_stats.reass_no_context++);
+      return -1;
     }
   }
-  return clear_count;
+
+  i = frag_free;
+  frag_free = frag_info[i].next;
+
+  frag_info[i].len = frag_size;
+  frag_info[i].tag = tag;
+  linkaddr_copy(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  frag_info[i].received_units = 0;
+  memset(frag_info[i].received, 0, (frag_size + 63) / 64);
+  timer_set(&frag_info[i].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  frag_info[i].next = frag_hash[frag_hash_index(&frag_info[i].sender, tag)];
+  frag_hash[frag_hash_index(&frag_info[i].sender, tag)] = i;
+  return i;
 }
 /*---------------------------------------------------------------------------*/
+/* Record the reception of len bytes at the given offset, in 8-octet
+   units. Returns 1 if they are new, 0 if they were all received
+   before, and -1 if they overlap with what was received before, in
+   which case the datagram is dropped. */
 static int
-timeout_fragments(int not_context)
+mark_fragment(uint8_t index, uint8_t offset, uint16_t len)
 {
-  int i;
-  int count = 0;
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].len > 0 && i != not_context &&
-       timer_expired(&frag_info[i].reass_timer)) {
-      /* This context can be freed */
-      count += clear_fragments(i);
+  uint16_t units;
+  uint16_t end;
+  uint16_t u;
+  uint16_t seen;
+
+  units = (frag_info[index].len + 7) / 8;
+  end = offset + (len + 7) / 8;
+  if(end > units) {
+    /* There may be extraneous bytes after the end of the datagram */
+    end = units;
+  }
+
+  seen = 0;
+  for(u = offset; u < end; u++) {
+    if(frag_info[index].received[u / 8] & (1 << (u % 8))) {
+      seen++;
     }
   }
-  return count;
+  if(seen == end - offset) {
+    PRINTF("*** Duplicate fragment - tag: %d offset: %d\n",
+           frag_info[index].tag, offset);
+    SICSLOWPAN_STAT(sicslowpan_stats.reass_duplicates++);
+    return 0;
+  }
+  if(seen > 0) {
+    PRINTF("*** Overlapping fragment - tag: %d offset: %d\n",
+           frag_info[index].tag, offset);
+    SICSLOWPAN_STAT(sicslowpan_stats.reass_overlaps++);
+    clear_fragments(index);
+    return -1;
+  }
+
+  for(u = offset; u < end; u++) {
+    frag_info[index].received[u / 8] |= 1 << (u % 8);
+  }
+  frag_info[index].received_units += end - offset;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Whether all the units of the datagram have been received */
+static int
+fragments_complete(uint8_t index)
+{
+  return frag_info[index].received_units == (frag_info[index].len + 7) / 8;
 }
 /*---------------------------------------------------------------------------*/
+/* Store the payload of a FRAGN at its offset in the datagram */
 static int
 store_fragment(uint8_t index, uint8_t offset)
 {
-  int i;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len == 0) {
-      /* copy over the data from packetbuf into the fragment buffer and store offset and len */
-      frag_buf[i].offset = offset; /* frag offset */
-      frag_buf[i].len = packetbuf_datalen() - packetbuf_hdr_len;
-      frag_buf[i].index = index;
-      memcpy(frag_buf[i].data, packetbuf_ptr + packetbuf_hdr_len,
-             packetbuf_datalen() - packetbuf_hdr_len);
-
-      PRINTF("Fragsize: %d\n", frag_buf[i].len);
-      /* return the length of the stored fragment */
-      return frag_buf[i].len;
-    }
+  int len;
+
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(len <= 0 || (uint16_t)(offset << 3) >= frag_info[index].len) {
+    /* failed */
+    return -1;
   }
-  /* failed */
-  return -1;
+  if((uint16_t)(offset << 3) + len > frag_info[index].len) {
+    len = frag_info[index].len - (uint16_t)(offset << 3);
+  }
+  if(mark_fragment(index, offset, len) <= 0) {
+    return -1;
+  }
+  memcpy(frag_info[index].buf.u8 + (uint16_t)(offset << 3),
+         packetbuf_ptr + packetbuf_hdr_len, len);
+  SICSLOWPAN_STAT(sicslowpan_stats.copied_in += len);
+
+  PRINTF("Fragsize: %d\n", len);
+  /* return the length of the stored fragment */
+  return len;
 }
 /*---------------------------------------------------------------------------*/
 /* add a new fragment to the buffer */
 static int8_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 {
-  int i;
-  int len;
-  int8_t found = -1;
+  int8_t found;
 
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
-    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-      /* clear all fragment info with expired timer to free all fragment buffers */
-      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
-	clear_fragments(i);
-      }
+  found = find_fragments(tag);
+  if(found >= 0 && frag_info[found].len != frag_size) {
+    /* The sender has reused the tag for another datagram */
+    clear_fragments(found);
+    found = -1;
+  }
 
-      /* We use len as indication on used or not used */
-      if(found < 0 && frag_info[i].len == 0) {
-        /* We remember the first free fragment info but must continue
-           the loop to free any other expired fragment buffers. */
-        found = i;
-      }
+  if(found < 0) {
+    /* Fragments may arrive in any order, any of them starts the
+       reassembly */
+    if(frag_size == 0 || frag_size > SICSLOWPAN_REASS_BUFSIZE) {
+      PRINTF("*** Fragmented packet too large to reassemble - tag: %d size: %d\n",
+             tag, frag_size);
+      return -1;
     }
-
+    found = new_fragments(tag, frag_size);
     if(found < 0) {
-      PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
       return -1;
     }
+  }
 
-    /* Found a free fragment info to store data in */
-    frag_info[found].len = frag_size;
-    frag_info[found].tag = tag;
-    linkaddr_copy(&frag_info[found].sender,
-                  packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  if(offset == 0) {
+    if(frag_info[found].received[0] & 1) {
+      PRINTF("*** Duplicate fragment - tag: %d offset: 0\n", tag);
+      SICSLOWPAN_STAT(sicslowpan_stats.reass_duplicates++);
+      return -1;
+    }
     /* first fragment can not be stored immediately but is moved into
        the buffer while uncompressing */
     return found;
   }
 
-  /* This is a N-fragment - should find the info */
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-      /* Tag and Sender match - this must be the correct info to store in */
-      found = i;
-      break;
-    }
-  }
-
-  if(found < 0) {
-    /* no entry found for storing the new fragment */
-    PRINTF("*** Failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
-    return -1;
-  }
-
-  /* i is the index of the reassembly context */
-  len = store_fragment(i, offset);
-  if(len < 0 && timeout_fragments(i) > 0) {
-    len = store_fragment(i, offset);
-  }
-  if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
-  } else {
-    /* should we also clear all fragments since we failed to store
-       this fragment? */
-    PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
+  if(store_fragment(found, offset) < 0) {
+    PRINTF("*** Failed to store fragment - tag: %d offset: %d\n", tag, offset);
     return -1;
   }
+  return found;
 }
 /*---------------------------------------------------------------------------*/
-/* Copy all the fragments that are associated with a specific context
-   into uip */
+/* Copy the reassembled datagram of a specific context into uip */
 static void
 copy_frags2uip(int context)
 {
-  int i;
-
-  /* Copy from the fragment context info buffer first */
-  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
-	 frag_info[context].first_frag_len);
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    /* And also copy all matching fragments */
-    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
-      memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[i].offset << 3),
-	     (uint8_t *)frag_buf[i].data, frag_buf[i].len);
-    }
-  }
-  /* deallocate all the fragments for this context */
+  memcpy((uint8_t *)UIP_IP_BUF, frag_info[context].buf.u8,
+         frag_info[context].len);
+  SICSLOWPAN_STAT(sicslowpan_stats.copied_in += frag_info[context].len);
+  /* free the context */
   clear_fragments(context);
 }
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* A virtual reassembly buffer entry, for a datagram being forwarded */
+struct sicslowpan_vrb {
+  /** The previous hop */
+  linkaddr_t sender;
+  /** The next hop */
+  linkaddr_t next_hop;
+  /** The tag from the previous hop */
+  uint16_t tag;
+  /** The datagram size from the previous hop, 0 if the entry is free */
+  uint16_t len;
+  /** The tag towards the next hop */
+  uint16_t out_tag;
+  /** The datagram size towards the next hop, 0 until the first
+      fragment has been sent */
+  uint16_t out_len;
+  /** The number of bytes of the datagram forwarded so far */
+  uint16_t forwarded_len;
+  /** The offset change of the following fragments, in units of 8
+      bytes, when forwarding changed the headers in the first fragment */
+  int8_t offset_shift;
+#if PACKETBUF_WITH_PRIORITY
+  /** The priority class of the datagram, from the headers in the
+      first fragment */
+  uint8_t priority;
+#endif /* PACKETBUF_WITH_PRIORITY */
+  /** Lifetime of the entry */
+  struct timer timer;
+};
+
+static struct sicslowpan_vrb vrb[SICSLOWPAN_VRB_ENTRIES];
+
+/* The entry of the datagram whose first fragment uIP is forwarding,
+   and the length of that first fragment. */
+static struct sicslowpan_vrb *vrb_first;
+static uint16_t vrb_first_len;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
+/* The packetbuf attributes of the fragments being sent */
+static struct packetbuf_attr frag_attrs[PACKETBUF_NUM_ATTRS];
+static struct packetbuf_addr frag_addrs[PACKETBUF_NUM_ADDRS];
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -483,6 +654,56 @@ set_packet_attrs(void)
 /*   } */
 
 }
+/*--------------------------------------------------------------------*/
+#if PACKETBUF_WITH_PRIORITY
+/**
+ * \brief Sets PACKETBUF_ATTR_PRIORITY from the headers in uip_buf
+ *
+ * RPL messages and neighbor discovery are control traffic, TCP
+ * segments without payload, such as pure ACKs, go in the ACK class and
+ * all other packets are data.
+ */
+static void
+set_packet_priority(void)
+{
+  uint8_t proto;
+  uint16_t offset;
+  uint16_t end;
+  uint16_t tcp_hdr_len;
+  int priority;
+
+  /* Skip the extension headers, such as the RPL hop-by-hop option */
+  proto = UIP_IP_BUF->proto;
+  offset = UIP_LLIPH_LEN;
+  end = UIP_LLH_LEN + uip_len;
+  while((proto == UIP_PROTO_HBHO || proto == UIP_PROTO_DESTO ||
+         proto == UIP_PROTO_ROUTING) && offset + 2 <= end) {
+    proto = uip_buf[offset];
+    offset += (uip_buf[offset + 1] + 1) * 8;
+  }
+
+  priority = PACKETBUF_ATTR_PRIORITY_DATA;
+  if(proto == UIP_PROTO_ICMP6 && offset < end) {
+    switch(uip_buf[offset]) {
+    case ICMP6_RPL:
+    case ICMP6_RS:
+    case ICMP6_RA:
+    case ICMP6_NS:
+    case ICMP6_NA:
+    case ICMP6_REDIRECT:
+      priority = PACKETBUF_ATTR_PRIORITY_CONTROL;
+      break;
+    }
+  } else if(proto == UIP_PROTO_TCP && offset + UIP_TCPH_LEN <= end) {
+    /* The data offset is in the upper four bits of byte 12 */
+    tcp_hdr_len = (uip_buf[offset + 12] >> 4) * 4;
+    if(offset + tcp_hdr_len >= end) {
+      priority = PACKETBUF_ATTR_PRIORITY_ACK;
+    }
+  }
+  packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY, priority);
+}
+#endif /* PACKETBUF_WITH_PRIORITY */
 
 
 
@@ -630,6 +851,575 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
   PRINTF("\n");
 }
 
+#if SICSLOWPAN_6LORH
+/*--------------------------------------------------------------------*/
+/** \name 6LoWPAN Routing Header (RFC 8138) functions
+ * @{                                                                 */
+/*--------------------------------------------------------------------*/
+/* The RPL hop-by-hop option header, as inserted by RPL */
+#define RPI_HDR_LEN 8
+/* An RPL Source Routing Header (RFC 6554), before its addresses */
+#define SRH_HDR_LEN 8
+/* Do not use 6LoRHs longer than this, the headers must fit in the
+   first fragment */
+#define LORH_MAX_LEN 48
+
+/* The size of the addresses of each SRH-6LoRH type */
+static const uint8_t srh_sizes[] = {1, 2, 4, 8, 16};
+
+/* The 6LoRHs of the received packet, set by parse_6lorh() */
+static const uint8_t *lorh_srh, *lorh_srh_end, *lorh_rpi, *lorh_ip_in_ip;
+
+/*--------------------------------------------------------------------*/
+/* The number of leading bytes two addresses have in common */
+static uint8_t
+addr_prefix_len(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  uint8_t i;
+
+  i = 0;
+  while(i < 16 && a->u8[i] == b->u8[i]) {
+    i++;
+  }
+  return i;
+}
+/*--------------------------------------------------------------------*/
+/* The smallest SRH-6LoRH type for an address, given the address it is
+   compressed against */
+static uint8_t
+srh_type(const uip_ipaddr_t *addr, const uip_ipaddr_t *ref)
+{
+  uint8_t prefix;
+  uint8_t type;
+
+  prefix = addr_prefix_len(addr, ref);
+  for(type = 0; 16 - srh_sizes[type] > prefix; type++);
+  return type;
+}
+/*--------------------------------------------------------------------*/
+/* Address i of the Source Routing Header rh of n addresses, whose
+   elided prefix is that of the IPv6 destination */
+static void
+srh_get_addr(uip_ipaddr_t *addr, const uint8_t *rh, uint8_t n, uint8_t i)
+{
+  uint8_t cmpri, cmpre;
+  uint8_t cmpr;
+
+  cmpri = rh[4] >> 4;
+  cmpre = rh[4] & 0x0f;
+  cmpr = i == n - 1 ? cmpre : cmpri;
+  uip_ipaddr_copy(addr, &UIP_IP_BUF->destipaddr);
+  memcpy(&addr->u8[cmpr], rh + SRH_HDR_LEN + i * (16 - cmpri), 16 - cmpr);
+}
+/*--------------------------------------------------------------------*/
+/* Number of addresses of the Source Routing Header rh, 0 if it is
+   malformed */
+static uint8_t
+srh_num_addrs(const uint8_t *rh)
+{
+  uint8_t cmpri, cmpre, padding;
+  uint16_t len;
+
+  cmpri = rh[4] >> 4;
+  cmpre = rh[4] & 0x0f;
+  padding = rh[5] >> 4;
+  len = (rh[1] + 1) * 8;
+  if(len < SRH_HDR_LEN + padding + 16 - cmpre) {
+    return 0;
+  }
+  return (len - SRH_HDR_LEN - padding - (16 - cmpre)) / (16 - cmpri) + 1;
+}
+/*--------------------------------------------------------------------*/
+/* The ComprI and ComprE fields of a Source Routing Header rebuilt from
+   6LoRHs: the prefix all its addresses have in common with the
+   destination. */
+static void
+srh_cmpr(uint8_t *cmpri, uint8_t *cmpre, uint8_t prefix, uint8_t last_prefix)
+{
+  *cmpre = MIN(last_prefix, 15);
+  *cmpri = prefix > 15 ? *cmpre : prefix;
+}
+/*--------------------------------------------------------------------*/
+/* Locate the RPL headers after the IPv6 header in uip_buf: the RPL
+   hop-by-hop option, a Source Routing Header and an encapsulated IPv6
+   header. Returns the offset of the header that follows them, and its
+   protocol in proto. */
+static uint16_t
+find_rpl_hdrs(uint8_t **hbh, uint8_t **rh, struct uip_ip_hdr **inner,
+              uint8_t *proto)
+{
+  uint8_t *ptr;
+  uint16_t len;
+
+  *hbh = *rh = NULL;
+  *inner = NULL;
+  *proto = UIP_IP_BUF->proto;
+  ptr = (uint8_t *)UIP_IP_BUF + UIP_IPH_LEN;
+  len = UIP_IPH_LEN;
+
+  if(*proto == UIP_PROTO_HBHO && len + RPI_HDR_LEN <= uip_len &&
+     ptr[1] == 0 && ptr[2] == UIP_EXT_HDR_OPT_RPL &&
+     ptr[3] == RPI_HDR_LEN - 4 && (ptr[4] & 0x1f) == 0) {
+    *hbh = ptr;
+    *proto = ptr[0];
+    ptr += RPI_HDR_LEN;
+    len += RPI_HDR_LEN;
+  }
+  if(*proto == UIP_PROTO_ROUTING && len + SRH_HDR_LEN <= uip_len &&
+     ptr[2] == 3 && ptr[3] > 0 && len + (ptr[1] + 1) * 8 <= uip_len &&
+     srh_num_addrs(ptr) == ptr[3]) {
+    /* Only Source Routing Headers without visited addresses, see
+       normalize_srh() */
+    *rh = ptr;
+    *proto = ptr[0];
+    len += (ptr[1] + 1) * 8;
+    ptr += (ptr[1] + 1) * 8;
+  }
+  if(*proto == UIP_PROTO_IPV6 && len + UIP_IPH_LEN <= uip_len) {
+    *inner = (struct uip_ip_hdr *)ptr;
+    *proto = (*inner)->proto;
+    len += UIP_IPH_LEN;
+  }
+  return len;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Rewrite the Source Routing Header of the packet in uip_buf
+ * the way it is rebuilt from an SRH-6LoRH
+ *
+ * The addresses already visited are removed, and ComprI and ComprE
+ * are set to the prefix the addresses have in common with the
+ * destination. The receiver then gets back the same datagram, as
+ * required by fragmentation.
+ */
+static void
+normalize_srh(void)
+{
+  uint8_t *rh;
+  uint8_t proto;
+  uint8_t *end;
+  uint8_t n, first, i;
+  uint8_t prefix, last_prefix;
+  uint8_t cmpri, cmpre, padding;
+  uint16_t old_len, len;
+  uip_ipaddr_t addr;
+
+  rh = (uint8_t *)UIP_IP_BUF + UIP_IPH_LEN;
+  end = (uint8_t *)UIP_IP_BUF + uip_len;
+  proto = UIP_IP_BUF->proto;
+  if(proto == UIP_PROTO_HBHO && rh + RPI_HDR_LEN <= end && rh[1] == 0) {
+    proto = rh[0];
+    rh += RPI_HDR_LEN;
+  }
+  if(proto != UIP_PROTO_ROUTING || rh + SRH_HDR_LEN > end || rh[2] != 3) {
+    return;
+  }
+  old_len = (rh[1] + 1) * 8;
+  n = srh_num_addrs(rh);
+  if(rh + old_len > end || rh[3] == 0 || rh[3] > n) {
+    return;
+  }
+  first = n - rh[3];
+
+  /* The addresses all share at least the current prefix with the
+     destination, so they can only get shorter */
+  prefix = 16;
+  last_prefix = 0;
+  for(i = first; i < n; i++) {
+    srh_get_addr(&addr, rh, n, i);
+    if(i < n - 1) {
+      prefix = MIN(prefix, addr_prefix_len(&addr, &UIP_IP_BUF->destipaddr));
+    } else {
+      last_prefix = addr_prefix_len(&addr, &UIP_IP_BUF->destipaddr);
+    }
+  }
+  srh_cmpr(&cmpri, &cmpre, prefix, last_prefix);
+  if(first == 0 && cmpri == rh[4] >> 4 && cmpre == (rh[4] & 0x0f)) {
+    return;
+  }
+
+  len = SRH_HDR_LEN;
+  for(i = first; i < n; i++) {
+    srh_get_addr(&addr, rh, n, i);
+    if(i < n - 1) {
+      memcpy(rh + len, &addr.u8[cmpri], 16 - cmpri);
+      len += 16 - cmpri;
+    } else {
+      memcpy(rh + len, &addr.u8[cmpre], 16 - cmpre);
+      len += 16 - cmpre;
+    }
+  }
+  padding = len % 8 == 0 ? 0 : 8 - len % 8;
+  memset(rh + len, 0, padding);
+  len += padding;
+
+  rh[1] = len / 8 - 1;
+  rh[4] = (cmpri << 4) | cmpre;
+  rh[5] = padding << 4;
+  rh[6] = rh[7] = 0;
+
+  memmove(rh + len, rh + old_len, end - (rh + old_len));
+  uip_len -= old_len - len;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the RPL headers of the packet in uip_buf into
+ * 6LoRHs, at the start of packetbuf
+ *
+ * \verbatim
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |1 1 1 1 0 0 0 1| SRH-6LoRHs | RPI-6LoRH | IP-in-IP-6LoRH | IPHC
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * \endverbatim
+ *
+ * The SRH-6LoRHs carry the current destination, then the addresses
+ * left in the Source Routing Header but the last one, which is the
+ * destination in IPHC. Each is compressed against the previous one,
+ * the first against the source of the packet. The encapsulator
+ * address of the IP-in-IP-6LoRH is compressed against the inner
+ * source, and the outer destination must be the inner one.
+ *
+ * \param hdr Set to the IPv6 header to compress with IPHC
+ * \param hdr_len Set to the length of the headers compressed so far
+ * \return 1 if 6LoRHs are used, 0 otherwise
+ */
+static int
+compress_hdr_6lorh(struct uip_ip_hdr *hdr, uint16_t *hdr_len)
+{
+  uint8_t *hbh, *rh;
+  struct uip_ip_hdr *inner;
+  uint8_t proto;
+  uint8_t *ptr, *lorh;
+  uint8_t n, i, type, size;
+  uint16_t len;
+  uip_ipaddr_t final, ref, addr;
+
+  len = find_rpl_hdrs(&hbh, &rh, &inner, &proto);
+  if(hbh == NULL && rh == NULL && inner == NULL) {
+    return 0;
+  }
+
+  n = 0;
+  if(rh != NULL) {
+    n = rh[3];
+    srh_get_addr(&final, rh, n, n - 1);
+  } else {
+    uip_ipaddr_copy(&final, &UIP_IP_BUF->destipaddr);
+  }
+  if(inner != NULL &&
+     (UIP_IP_BUF->vtc != 0x60 || UIP_IP_BUF->tcflow != 0 ||
+      UIP_IP_BUF->flow != 0 ||
+      !uip_ipaddr_cmp(&final, &inner->destipaddr))) {
+    return 0;
+  }
+
+  ptr = packetbuf_ptr;
+  *ptr++ = SICSLOWPAN_DISPATCH_PAGING_1;
+
+  if(rh != NULL) {
+    /* The current destination, then address 0 to n - 2 */
+    uip_ipaddr_copy(&ref, &UIP_IP_BUF->srcipaddr);
+    uip_ipaddr_copy(&addr, &UIP_IP_BUF->destipaddr);
+    lorh = NULL;
+    for(i = 0; i < n; i++) {
+      if(i > 0) {
+        srh_get_addr(&addr, rh, n, i - 1);
+      }
+      type = srh_type(&addr, &ref);
+      size = srh_sizes[type];
+      if(lorh == NULL || lorh[1] != type ||
+         (lorh[0] & SICSLOWPAN_6LORH_LEN_MASK) == SICSLOWPAN_6LORH_LEN_MASK) {
+        if(ptr + 2 + size > packetbuf_ptr + LORH_MAX_LEN) {
+          return 0;
+        }
+        lorh = ptr;
+        lorh[0] = SICSLOWPAN_6LORH_CRITICAL;
+        lorh[1] = type;
+        ptr += 2;
+      } else {
+        if(ptr + size > packetbuf_ptr + LORH_MAX_LEN) {
+          return 0;
+        }
+        /* The size field is the number of addresses minus one */
+        lorh[0]++;
+      }
+      memcpy(ptr, &addr.u8[16 - size], size);
+      ptr += size;
+      uip_ipaddr_copy(&ref, &addr);
+    }
+  }
+
+  if(hbh != NULL) {
+    lorh = ptr;
+    lorh[0] = SICSLOWPAN_6LORH_CRITICAL;
+    lorh[1] = SICSLOWPAN_6LORH_TYPE_RPI;
+    ptr += 2;
+    /* The O, R and F flags are in the same order */
+    lorh[0] |= hbh[4] >> 3;
+    if(hbh[5] == 0) {
+      lorh[0] |= SICSLOWPAN_6LORH_RPI_I;
+    } else {
+      *ptr++ = hbh[5];
+    }
+    *ptr++ = hbh[6];
+    if(hbh[7] == 0) {
+      lorh[0] |= SICSLOWPAN_6LORH_RPI_K;
+    } else {
+      *ptr++ = hbh[7];
+    }
+  }
+
+  if(inner != NULL) {
+    i = addr_prefix_len(&UIP_IP_BUF->srcipaddr, &inner->srcipaddr);
+    size = i == 16 ? 0 : i >= 15 ? 1 : i >= 14 ? 2 : i >= 8 ? 8 : 16;
+    if(ptr + 3 + size > packetbuf_ptr + LORH_MAX_LEN) {
+      return 0;
+    }
+    *ptr++ = SICSLOWPAN_6LORH_ELECTIVE | (1 + size);
+    *ptr++ = SICSLOWPAN_6LORH_TYPE_IP_IN_IP;
+    *ptr++ = UIP_IP_BUF->ttl;
+    memcpy(ptr, &UIP_IP_BUF->srcipaddr.u8[16 - size], size);
+    ptr += size;
+  }
+
+  if(inner != NULL) {
+    memcpy(hdr, inner, UIP_IPH_LEN);
+  } else {
+    memcpy(hdr, UIP_IP_BUF, UIP_IPH_LEN);
+    hdr->proto = proto;
+    uip_ipaddr_copy(&hdr->destipaddr, &final);
+  }
+
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  SICSLOWPAN_STAT(sicslowpan_stats.rpl_hdr_bytes += len - UIP_IPH_LEN);
+  SICSLOWPAN_STAT(sicslowpan_stats.lorh_bytes += packetbuf_hdr_len);
+  *hdr_len = len;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/* Find the 6LoRHs after the page 1 dispatch of a received packet, and
+   skip them. Returns 0 if the packet cannot be handled. */
+static int
+parse_6lorh(void)
+{
+  const uint8_t *ptr;
+  const uint8_t *end;
+  uint16_t len;
+
+  lorh_srh = lorh_srh_end = lorh_rpi = lorh_ip_in_ip = NULL;
+  ptr = packetbuf_ptr + packetbuf_hdr_len + 1;
+  end = packetbuf_ptr + packetbuf_datalen();
+
+  while(ptr + 2 <= end &&
+        (ptr[0] & SICSLOWPAN_6LORH_MASK) == SICSLOWPAN_6LORH_ID) {
+    if((ptr[0] & SICSLOWPAN_6LORH_FORM_MASK) == SICSLOWPAN_6LORH_CRITICAL) {
+      if(ptr[1] <= SICSLOWPAN_6LORH_TYPE_SRH_MAX) {
+        /* The SRH-6LoRHs follow each other */
+        if(lorh_srh == NULL) {
+          lorh_srh = ptr;
+        } else if(lorh_srh_end != ptr) {
+          return 0;
+        }
+        len = 2 + ((ptr[0] & SICSLOWPAN_6LORH_LEN_MASK) + 1) * srh_sizes[ptr[1]];
+        lorh_srh_end = ptr + len;
+      } else if(ptr[1] == SICSLOWPAN_6LORH_TYPE_RPI) {
+        len = 2 + (ptr[0] & SICSLOWPAN_6LORH_RPI_I ? 0 : 1)
+          + (ptr[0] & SICSLOWPAN_6LORH_RPI_K ? 1 : 2);
+        lorh_rpi = ptr;
+      } else {
+        PRINTF("sicslowpan: unsupported critical 6LoRH %u\n", ptr[1]);
+        return 0;
+      }
+    } else {
+      len = 2 + (ptr[0] & SICSLOWPAN_6LORH_LEN_MASK);
+      if(ptr[1] == SICSLOWPAN_6LORH_TYPE_IP_IN_IP) {
+        switch(len - 3) {
+        case 0: case 1: case 2: case 8: case 16:
+          lorh_ip_in_ip = ptr;
+          break;
+        default:
+          return 0;
+        }
+      }
+      /* Other elective 6LoRHs are ignored */
+    }
+    if(len > end - ptr) {
+      PRINTF("sicslowpan: truncated 6LoRH\n");
+      return 0;
+    }
+    ptr += len;
+  }
+
+  if(ptr >= end ||
+     (ptr[0] & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+    return 0;
+  }
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/* Get the next address of the SRH-6LoRHs at *ptr, where *left is the
+   number of addresses left in the current SRH-6LoRH */
+static void
+get_srh_addr(uip_ipaddr_t *addr, const uint8_t **ptr, uint8_t *left,
+             uint8_t *size)
+{
+  if(*left == 0) {
+    *left = ((*ptr)[0] & SICSLOWPAN_6LORH_LEN_MASK) + 1;
+    *size = srh_sizes[(*ptr)[1]];
+    *ptr += 2;
+  }
+  memcpy(&addr->u8[16 - *size], *ptr, *size);
+  *ptr += *size;
+  (*left)--;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Rebuild the headers compressed into the 6LoRHs found by
+ * parse_6lorh(), after the IPv6 header uncompressed in buf
+ *
+ * \param buf The buffer the IPHC header was uncompressed into
+ * \param buf_size The size of buf
+ * \param ip_len The size of the datagram if it is fragmented, 0 otherwise
+ * \return 0 if the headers do not fit
+ */
+static int
+uncompress_hdr_6lorh(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
+{
+  const uint8_t *ptr;
+  uint8_t left, size;
+  uint8_t n, i;
+  uint8_t prefix, last_prefix;
+  uint8_t cmpri, cmpre, padding;
+  uint8_t proto;
+  uint16_t rpi_len, srh_len, ext_len, len;
+  uint8_t *hdr;
+  uip_ipaddr_t src, dst, addr;
+
+  rpi_len = lorh_rpi != NULL ? RPI_HDR_LEN : 0;
+
+  /* The outer source */
+  uip_ipaddr_copy(&src, &SICSLOWPAN_IP_BUF(buf)->srcipaddr);
+  if(lorh_ip_in_ip != NULL) {
+    size = (lorh_ip_in_ip[0] & SICSLOWPAN_6LORH_LEN_MASK) - 1;
+    memcpy(&src.u8[16 - size], lorh_ip_in_ip + 3, size);
+  }
+
+  /* Count the addresses of the Source Routing Header and their prefix
+     in common with the first one, the destination */
+  srh_len = 0;
+  n = 0;
+  cmpri = cmpre = 0;
+  if(lorh_srh != NULL) {
+    prefix = 16;
+    ptr = lorh_srh;
+    left = 0;
+    uip_ipaddr_copy(&addr, &src);
+    while(ptr < lorh_srh_end) {
+      get_srh_addr(&addr, &ptr, &left, &size);
+      if(n == 0) {
+        uip_ipaddr_copy(&dst, &addr);
+      } else {
+        prefix = MIN(prefix, addr_prefix_len(&addr, &dst));
+      }
+      n++;
+    }
+    last_prefix = addr_prefix_len(&SICSLOWPAN_IP_BUF(buf)->destipaddr, &dst);
+    srh_cmpr(&cmpri, &cmpre, prefix, last_prefix);
+    srh_len = SRH_HDR_LEN + (n - 1) * (16 - cmpri) + 16 - cmpre;
+  }
+  padding = srh_len % 8 == 0 ? 0 : 8 - srh_len % 8;
+  srh_len += padding;
+
+  ext_len = rpi_len + srh_len + (lorh_ip_in_ip != NULL ? UIP_IPH_LEN : 0);
+  if(uncomp_hdr_len + ext_len > buf_size) {
+    PRINTF("sicslowpan: 6LoRH headers too large (%u)\n", ext_len);
+    return 0;
+  }
+
+  /* Make room for the headers before the upper-layer header */
+  memmove(buf + UIP_IPH_LEN + ext_len, buf + UIP_IPH_LEN,
+          uncomp_hdr_len - UIP_IPH_LEN);
+  len = (SICSLOWPAN_IP_BUF(buf)->len[0] << 8) + SICSLOWPAN_IP_BUF(buf)->len[1];
+  if(ip_len == 0) {
+    len += ext_len;
+  }
+  proto = SICSLOWPAN_IP_BUF(buf)->proto;
+
+  if(lorh_ip_in_ip != NULL) {
+    hdr = buf + UIP_IPH_LEN + rpi_len + srh_len;
+    memcpy(hdr, buf, UIP_IPH_LEN);
+    ((struct uip_ip_hdr *)hdr)->len[0] = (len - rpi_len - srh_len - UIP_IPH_LEN) >> 8;
+    ((struct uip_ip_hdr *)hdr)->len[1] = (len - rpi_len - srh_len - UIP_IPH_LEN) & 0xff;
+    SICSLOWPAN_IP_BUF(buf)->vtc = 0x60;
+    SICSLOWPAN_IP_BUF(buf)->tcflow = 0;
+    SICSLOWPAN_IP_BUF(buf)->flow = 0;
+    SICSLOWPAN_IP_BUF(buf)->ttl = lorh_ip_in_ip[2];
+    uip_ipaddr_copy(&SICSLOWPAN_IP_BUF(buf)->srcipaddr, &src);
+    proto = UIP_PROTO_IPV6;
+  }
+
+  /* The Source Routing Header */
+  if(lorh_srh != NULL) {
+    hdr = buf + UIP_IPH_LEN + rpi_len;
+    hdr[0] = proto;
+    hdr[1] = srh_len / 8 - 1;
+    hdr[2] = 3;
+    hdr[3] = n;
+    hdr[4] = (cmpri << 4) | cmpre;
+    hdr[5] = padding << 4;
+    hdr[6] = hdr[7] = 0;
+    ptr = lorh_srh;
+    left = 0;
+    uip_ipaddr_copy(&addr, &src);
+    hdr += SRH_HDR_LEN;
+    for(i = 0; i < n; i++) {
+      get_srh_addr(&addr, &ptr, &left, &size);
+      if(i > 0) {
+        memcpy(hdr, &addr.u8[cmpri], 16 - cmpri);
+        hdr += 16 - cmpri;
+      }
+    }
+    memcpy(hdr, &SICSLOWPAN_IP_BUF(buf)->destipaddr.u8[cmpre], 16 - cmpre);
+    memset(hdr + 16 - cmpre, 0, padding);
+    uip_ipaddr_copy(&SICSLOWPAN_IP_BUF(buf)->destipaddr, &dst);
+    proto = UIP_PROTO_ROUTING;
+  }
+
+  /* The RPL hop-by-hop option */
+  if(lorh_rpi != NULL) {
+    hdr = buf + UIP_IPH_LEN;
+    ptr = lorh_rpi + 2;
+    hdr[0] = proto;
+    hdr[1] = 0;
+    hdr[2] = UIP_EXT_HDR_OPT_RPL;
+    hdr[3] = RPI_HDR_LEN - 4;
+    hdr[4] = (lorh_rpi[0] << 3) & 0xe0;
+    hdr[5] = lorh_rpi[0] & SICSLOWPAN_6LORH_RPI_I ? 0 : *ptr++;
+    hdr[6] = *ptr++;
+    hdr[7] = lorh_rpi[0] & SICSLOWPAN_6LORH_RPI_K ? 0 : *ptr;
+    proto = UIP_PROTO_HBHO;
+  }
+
+  SICSLOWPAN_IP_BUF(buf)->proto = proto;
+  SICSLOWPAN_IP_BUF(buf)->len[0] = len >> 8;
+  SICSLOWPAN_IP_BUF(buf)->len[1] = len & 0xff;
+  uncomp_hdr_len += ext_len;
+
+  /* The length of an uncompressed UDP header */
+  if(uncomp_hdr_len > UIP_IPH_LEN + ext_len) {
+    len -= ext_len;
+    hdr = buf + UIP_IPH_LEN + ext_len;
+    hdr[4] = len >> 8;
+    hdr[5] = len & 0xff;
+  }
+  return 1;
+}
+/** @} */
+#endif /* SICSLOWPAN_6LORH */
+
 /*--------------------------------------------------------------------*/
 /**
  * \brief Compress IP/UDP header
@@ -669,6 +1459,12 @@ static void
 compress_hdr_iphc(linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct uip_ip_hdr *ip;
+  struct uip_udp_hdr *udp;
+  uint16_t hdr_len;
+#if SICSLOWPAN_6LORH
+  struct uip_ip_hdr lorh_hdr;
+#endif /* SICSLOWPAN_6LORH */
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -680,7 +1476,18 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
   }
 #endif
 
-  hc06_ptr = packetbuf_ptr + 2;
+  ip = UIP_IP_BUF;
+  hdr_len = UIP_IPH_LEN;
+#if SICSLOWPAN_6LORH
+  /* The RPL headers go into 6LoRHs before IPHC, which compresses the
+     header they leave */
+  if(compress_hdr_6lorh(&lorh_hdr, &hdr_len)) {
+    ip = &lorh_hdr;
+  }
+#endif /* SICSLOWPAN_6LORH */
+  udp = (struct uip_udp_hdr *)((uint8_t *)UIP_IP_BUF + hdr_len);
+
+  hc06_ptr = packetbuf_ptr + packetbuf_hdr_len + 2;
   /*
    * As we copy some bit-length fields, in the IPHC encoding bytes,
    * we sometimes use |=
@@ -702,8 +1509,8 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
   /* check if dest context exists (for allocating third byte) */
   /* TODO: fix this so that it remembers the looked up values for
      avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
+  if(addr_context_lookup_by_prefix(&ip->destipaddr) != NULL ||
+     addr_context_lookup_by_prefix(&ip->srcipaddr) != NULL) {
     /* set context flag and increase hc06_ptr */
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
@@ -719,15 +1526,15 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
 
   /* IPHC format of tc is ECN | DSCP , original is DSCP | ECN */
 
-  tmp = (UIP_IP_BUF->vtc << 4) | (UIP_IP_BUF->tcflow >> 4);
+  tmp = (ip->vtc << 4) | (ip->tcflow >> 4);
   tmp = ((tmp & 0x03) << 6) | (tmp >> 2);
 
-  if(((UIP_IP_BUF->tcflow & 0x0F) == 0) &&
-     (UIP_IP_BUF->flow == 0)) {
+  if(((ip->tcflow & 0x0F) == 0) &&
+     (ip->flow == 0)) {
     /* flow label can be compressed */
     iphc0 |= SICSLOWPAN_IPHC_FL_C;
-    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
-       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
+    if(((ip->vtc & 0x0F) == 0) &&
+       ((ip->tcflow & 0xF0) == 0)) {
       /* compress (elide) all */
       iphc0 |= SICSLOWPAN_IPHC_TC_C;
     } else {
@@ -737,17 +1544,17 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
     }
   } else {
     /* Flow label cannot be compressed */
-    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
-       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
+    if(((ip->vtc & 0x0F) == 0) &&
+       ((ip->tcflow & 0xF0) == 0)) {
       /* compress only traffic class */
       iphc0 |= SICSLOWPAN_IPHC_TC_C;
       *hc06_ptr = (tmp & 0xc0) |
-        (UIP_IP_BUF->tcflow & 0x0F);
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->flow, 2);
+        (ip->tcflow & 0x0F);
+      memcpy(hc06_ptr + 1, &ip->flow, 2);
       hc06_ptr += 3;
     } else {
       /* compress nothing */
-      memcpy(hc06_ptr, &UIP_IP_BUF->vtc, 4);
+      memcpy(hc06_ptr, &ip->vtc, 4);
       /* but replace the top byte with the new ECN | DSCP format*/
       *hc06_ptr = tmp;
       hc06_ptr += 4;
@@ -758,13 +1565,13 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
 
   /* Next header. We compress it if UDP */
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(ip->proto == UIP_PROTO_UDP) {
     iphc0 |= SICSLOWPAN_IPHC_NH_C;
   }
 #endif /*UIP_CONF_UDP*/
 
   if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
-    *hc06_ptr = UIP_IP_BUF->proto;
+    *hc06_ptr = ip->proto;
     hc06_ptr += 1;
   }
 
@@ -775,7 +1582,7 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
    * if 255: compress, encoding is 11
    * else do not compress
    */
-  switch(UIP_IP_BUF->ttl) {
+  switch(ip->ttl) {
     case 1:
       iphc0 |= SICSLOWPAN_IPHC_TTL_1;
       break;
@@ -786,17 +1593,17 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
       iphc0 |= SICSLOWPAN_IPHC_TTL_255;
       break;
     default:
-      *hc06_ptr = UIP_IP_BUF->ttl;
+      *hc06_ptr = ip->ttl;
       hc06_ptr += 1;
       break;
   }
 
   /* source address - cannot be multicast */
-  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+  if(uip_is_addr_unspecified(&ip->srcipaddr)) {
     PRINTF("IPHC: compressing unspecified - setting SAC\n");
     iphc1 |= SICSLOWPAN_IPHC_SAC;
     iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
+  } else if((context = addr_context_lookup_by_prefix(&ip->srcipaddr))
      != NULL) {
     /* elide the prefix - indicate by CID and set context + SAC */
     PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
@@ -806,121 +1613,121 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
     /* compession compare with this nodes address (source) */
 
     iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+                              &ip->srcipaddr, &uip_lladdr);
     /* No context found for this address */
-  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
-            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[3] == 0) {
+  } else if(uip_is_addr_linklocal(&ip->srcipaddr) &&
+            ip->destipaddr.u16[1] == 0 &&
+            ip->destipaddr.u16[2] == 0 &&
+            ip->destipaddr.u16[3] == 0) {
     iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+                              &ip->srcipaddr, &uip_lladdr);
   } else {
     /* send the full address => SAC = 0, SAM = 00 */
     iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
-    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
+    memcpy(hc06_ptr, &ip->srcipaddr.u16[0], 16);
     hc06_ptr += 16;
   }
 
   /* dest address*/
-  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+  if(uip_is_addr_mcast(&ip->destipaddr)) {
     /* Address is multicast, try to compress */
     iphc1 |= SICSLOWPAN_IPHC_M;
-    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF->destipaddr)) {
+    if(sicslowpan_is_mcast_addr_compressable8(&ip->destipaddr)) {
       iphc1 |= SICSLOWPAN_IPHC_DAM_11;
       /* use last byte */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[15];
+      *hc06_ptr = ip->destipaddr.u8[15];
       hc06_ptr += 1;
-    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF->destipaddr)) {
+    } else if(sicslowpan_is_mcast_addr_compressable32(&ip->destipaddr)) {
       iphc1 |= SICSLOWPAN_IPHC_DAM_10;
       /* second byte + the last three */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[13], 3);
+      *hc06_ptr = ip->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &ip->destipaddr.u8[13], 3);
       hc06_ptr += 4;
-    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF->destipaddr)) {
+    } else if(sicslowpan_is_mcast_addr_compressable48(&ip->destipaddr)) {
       iphc1 |= SICSLOWPAN_IPHC_DAM_01;
       /* second byte + the last five */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
+      *hc06_ptr = ip->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &ip->destipaddr.u8[11], 5);
       hc06_ptr += 6;
     } else {
       iphc1 |= SICSLOWPAN_IPHC_DAM_00;
       /* full address */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u8[0], 16);
+      memcpy(hc06_ptr, &ip->destipaddr.u8[0], 16);
       hc06_ptr += 16;
     }
   } else {
     /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+    if((context = addr_context_lookup_by_prefix(&ip->destipaddr)) != NULL) {
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
       PACKETBUF_IPHC_BUF[2] |= context->number;
       /* compession compare with link adress (destination) */
 
       iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-                                &UIP_IP_BUF->destipaddr,
+                                &ip->destipaddr,
                                 (uip_lladdr_t *)link_destaddr);
       /* No context found for this address */
-    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
-              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[3] == 0) {
+    } else if(uip_is_addr_linklocal(&ip->destipaddr) &&
+              ip->destipaddr.u16[1] == 0 &&
+              ip->destipaddr.u16[2] == 0 &&
+              ip->destipaddr.u16[3] == 0) {
       iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-               &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
+               &ip->destipaddr, (uip_lladdr_t *)link_destaddr);
     } else {
       /* send the full address */
       iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
+      memcpy(hc06_ptr, &ip->destipaddr.u16[0], 16);
       hc06_ptr += 16;
     }
   }
 
-  uncomp_hdr_len = UIP_IPH_LEN;
+  uncomp_hdr_len = hdr_len;
 
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
   /* UDP header compression */
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(ip->proto == UIP_PROTO_UDP) {
     PRINTF("IPHC: Uncompressed UDP ports on send side: %x, %x\n",
-           UIP_HTONS(UIP_UDP_BUF->srcport), UIP_HTONS(UIP_UDP_BUF->destport));
+           UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
     /* Mask out the last 4 bits can be used as a mask */
-    if(((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
-       ((UIP_HTONS(UIP_UDP_BUF->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
+    if(((UIP_HTONS(udp->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
+       ((UIP_HTONS(udp->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
       /* we can compress 12 bits of both source and dest */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_11;
       PRINTF("IPHC: remove 12 b of both source & dest with prefix 0xFOB\n");
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp->srcport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN) << 4) +
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp->destport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN));
       hc06_ptr += 2;
-    } else if((UIP_HTONS(UIP_UDP_BUF->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of dest, leave source. */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_01;
       PRINTF("IPHC: leave source, remove 8 bits of dest with prefix 0xF0\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 2);
+      memcpy(hc06_ptr + 1, &udp->srcport, 2);
       *(hc06_ptr + 3) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp->destport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
       hc06_ptr += 4;
-    } else if((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of src, leave dest. Copy compressed port */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_10;
       PRINTF("IPHC: remove 8 bits of source with prefix 0xF0, leave dest. hch: %i\n", *hc06_ptr);
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp->srcport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
-      memcpy(hc06_ptr + 2, &UIP_UDP_BUF->destport, 2);
+      memcpy(hc06_ptr + 2, &udp->destport, 2);
       hc06_ptr += 4;
     } else {
       /* we cannot compress. Copy uncompressed ports, full checksum  */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_00;
       PRINTF("IPHC: cannot compress headers\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 4);
+      memcpy(hc06_ptr + 1, &udp->srcport, 4);
       hc06_ptr += 5;
     }
     /* always inline the checksum  */
     if(1) {
-      memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
+      memcpy(hc06_ptr, &udp->udpchksum, 2);
       hc06_ptr += 2;
     }
     uncomp_hdr_len += UIP_UDPH_LEN;
@@ -1261,6 +2068,135 @@ send_packet(linkaddr_t *dest)
      watchdog know that we are still alive. */
   watchdog_periodic();
 }
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Allocate a VRB entry for a datagram whose first fragment is
+ * in packetbuf, if the datagram is to be forwarded.
+ * \param hdr The uncompressed IPv6 header of the datagram
+ * \param tag The tag of the datagram
+ * \param len The size of the datagram
+ * \return The entry, or NULL if the datagram is to be reassembled
+ */
+static struct sicslowpan_vrb *
+vrb_alloc(struct uip_ip_hdr *hdr, uint16_t tag, uint16_t len)
+{
+  struct sicslowpan_vrb *entry, *found;
+
+  if(uip_is_addr_mcast(&hdr->destipaddr) ||
+     uip_ds6_is_my_addr(&hdr->destipaddr) ||
+     hdr->ttl <= 1 || len > UIP_LINK_MTU) {
+    /* Not forwarded, or uIP needs the whole datagram for the ICMP
+       error message */
+    return NULL;
+  }
+
+  found = NULL;
+  for(entry = vrb; entry < vrb + SICSLOWPAN_VRB_ENTRIES; entry++) {
+    if(entry->len > 0 &&
+       (timer_expired(&entry->timer) ||
+        (entry->tag == tag &&
+         linkaddr_cmp(&entry->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))) {
+      /* Expired, or the datagram is being sent again */
+      entry->len = 0;
+    }
+    if(found == NULL && entry->len == 0) {
+      found = entry;
+    }
+  }
+
+  if(found == NULL) {
+    PRINTF("*** No VRB entry to forward fragments - tag: %d\n", tag);
+    return NULL;
+  }
+
+  linkaddr_copy(&found->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  found->tag = tag;
+  found->len = len;
+  found->out_len = 0;
+  timer_set(&found->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  return found;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Pass the first fragment of a datagram to be forwarded, which
+ * is in uip_buf, to uIP.
+ *
+ * uIP sees the first fragment as a datagram of its own. When uIP
+ * forwards it, output() sends it as the first fragments of the
+ * datagram and fills in the VRB entry for the following fragments.
+ */
+static void
+vrb_input_first(struct sicslowpan_vrb *entry)
+{
+  uip_len = packetbuf_payload_len + uncomp_hdr_len;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+
+  vrb_first = entry;
+  vrb_first_len = uip_len;
+  tcpip_input();
+  vrb_first = NULL;
+
+  if(entry->out_len == 0) {
+    /* Not forwarded; drop the following fragments as well */
+    entry->len = 0;
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a FRAGN in packetbuf, if its datagram has a VRB entry.
+ * \return 1 if the fragment was handled, 0 if it is to be reassembled
+ */
+static int
+vrb_forward(uint16_t tag, uint16_t len, uint8_t offset)
+{
+  struct sicslowpan_vrb *entry;
+  int out_offset;
+
+  for(entry = vrb; entry < vrb + SICSLOWPAN_VRB_ENTRIES; entry++) {
+    if(entry->len == len && entry->tag == tag && entry->out_len > 0 &&
+       linkaddr_cmp(&entry->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      break;
+    }
+  }
+  if(entry == vrb + SICSLOWPAN_VRB_ENTRIES) {
+    return 0;
+  }
+
+  out_offset = offset + entry->offset_shift;
+  if(timer_expired(&entry->timer) || out_offset <= 0 || out_offset > 0xff) {
+    PRINTF("*** Dropping fragment - tag: %d offset: %d\n", tag, offset);
+    entry->len = 0;
+    return 1;
+  }
+
+  entry->forwarded_len += packetbuf_datalen() - packetbuf_hdr_len;
+  if(entry->forwarded_len >= entry->len) {
+    /* Done, unless fragments are lost or duplicated, in which case the
+       entry times out */
+    entry->len = 0;
+  }
+
+  /* Rewrite the fragment header in place and send the frame on */
+  packetbuf_compact();
+  packetbuf_attr_clear();
+#if PACKETBUF_WITH_PRIORITY
+  /* The following fragments only carry the payload, they are sent in
+     the class of the first one */
+  packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY, entry->priority);
+#endif /* PACKETBUF_WITH_PRIORITY */
+  packetbuf_ptr = packetbuf_dataptr();
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAGN << 8) | entry->out_len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, entry->out_tag);
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = out_offset;
+  PRINTFI("sicslowpan input: forwarding fragment (offset %d, tag %d)\n",
+          out_offset, entry->out_tag);
+  send_packet(&entry->next_hop);
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
 /*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
@@ -1276,9 +2212,15 @@ output(const uip_lladdr_t *localdest)
 {
   int framer_hdrlen;
   int max_payload;
+  /* The size of the datagram, of which uip_len bytes are in uip_buf */
+  uint16_t datagram_len;
 
   /* The MAC address of the destination of the packet */
   linkaddr_t dest;
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+  struct sicslowpan_vrb *vrb_out;
+  int shift;
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
 
   /* init */
   uncomp_hdr_len = 0;
@@ -1311,6 +2253,10 @@ output(const uip_lladdr_t *localdest)
   }
 #endif
 
+#if PACKETBUF_WITH_PRIORITY
+  set_packet_priority();
+#endif /* PACKETBUF_WITH_PRIORITY */
+
   /*
    * The destination address will be tagged to each outbound
    * packet. If the argument localdest is NULL, we are sending a
@@ -1322,6 +2268,35 @@ output(const uip_lladdr_t *localdest)
     linkaddr_copy(&dest, (const linkaddr_t *)localdest);
   }
 
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_6LORH
+  /* This may change the size of the datagram */
+  normalize_srh();
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_6LORH */
+
+  datagram_len = uip_len;
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+  vrb_out = NULL;
+  shift = 0;
+  if(vrb_first != NULL && !uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr)) {
+    /* This is the first fragment of a datagram being forwarded. If
+       forwarding changed the size of its headers, the following
+       fragments are shifted. */
+    shift = (int)uip_len - vrb_first_len;
+    if(shift % 8 != 0) {
+      PRINTFO("sicslowpan output: cannot shift fragments by %d, dropping\n",
+              shift);
+      return 0;
+    }
+    vrb_out = vrb_first;
+#if PACKETBUF_WITH_PRIORITY
+    vrb_out->priority = packetbuf_attr(PACKETBUF_ATTR_PRIORITY);
+#endif /* PACKETBUF_WITH_PRIORITY */
+    datagram_len = vrb_first->len + shift;
+    UIP_IP_BUF->len[0] = (datagram_len - UIP_IPH_LEN) >> 8;
+    UIP_IP_BUF->len[1] = (datagram_len - UIP_IPH_LEN) & 0xff;
+  }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
+
   PRINTFO("sicslowpan output: sending packet len %d\n", uip_len);
 
   if(uip_len >= COMPRESSION_THRESHOLD) {
@@ -1352,12 +2327,12 @@ output(const uip_lladdr_t *localdest)
 #endif /* USE_FRAMER_HDRLEN */
 
   max_payload = MAC_MAX_PAYLOAD - framer_hdrlen;
-  if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
+  if((int)datagram_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len ||
+     datagram_len > uip_len) {
 #if SICSLOWPAN_CONF_FRAG
     /* Number of bytes processed. */
     uint16_t processed_ip_out_len;
 
-    struct queuebuf *q;
     uint16_t frag_tag;
 
     /*
@@ -1368,7 +2343,7 @@ output(const uip_lladdr_t *localdest)
      * The following fragments contain only the fragn dispatch.
      */
     int estimated_fragments = ((int)uip_len) / (max_payload - SICSLOWPAN_FRAGN_HDR_LEN) + 1;
-    int freebuf = queuebuf_numfree() - 1;
+    int freebuf = queuebuf_numfree();
     PRINTFO("uip_len: %d, fragments: %d, free bufs: %d\n", uip_len, estimated_fragments, freebuf);
     if(freebuf < estimated_fragments) {
       PRINTFO("Dropping packet, not enough free bufs\n");
@@ -1393,26 +2368,28 @@ output(const uip_lladdr_t *localdest)
 /*     PACKETBUF_FRAG_BUF->dispatch_size = */
 /*       uip_htons((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len); */
     SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
+          ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | datagram_len));
     frag_tag = my_tag++;
     SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
 
     /* Copy payload and send */
     packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
     packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
+    if(packetbuf_payload_len > uip_len - uncomp_hdr_len) {
+      /* Only the first fragment of a forwarded datagram is in uip_buf */
+      packetbuf_payload_len = uip_len - uncomp_hdr_len;
+    }
     PRINTFO("(len %d, tag %d)\n", packetbuf_payload_len, frag_tag);
     memcpy(packetbuf_ptr + packetbuf_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
+    SICSLOWPAN_STAT(sicslowpan_stats.copied_out += packetbuf_payload_len);
     packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-    q = queuebuf_new_from_packetbuf();
-    if(q == NULL) {
-      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
-      return 0;
-    }
+    /* The MAC may use packetbuf for other packets before it returns,
+       so we keep the attributes to set them again for each of the
+       following fragments. Their payload is copied from uip_buf. */
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+    packetbuf_attr_copyto(frag_attrs, frag_addrs);
     send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
-    q = NULL;
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1431,13 +2408,15 @@ output(const uip_lladdr_t *localdest)
      * FRAGN dispatch and for each fragment, the offset
      */
     packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-/*     PACKETBUF_FRAG_BUF->dispatch_size = */
-/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
     packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
     while(processed_ip_out_len < uip_len) {
       PRINTFO("sicslowpan output: fragment ");
+      packetbuf_clear();
+      packetbuf_attr_copyfrom(frag_attrs, frag_addrs);
+      packetbuf_ptr = packetbuf_dataptr();
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | datagram_len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
       PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
 
       /* Copy payload and send */
@@ -1449,16 +2428,9 @@ output(const uip_lladdr_t *localdest)
              processed_ip_out_len >> 3, packetbuf_payload_len, frag_tag);
       memcpy(packetbuf_ptr + packetbuf_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, packetbuf_payload_len);
+      SICSLOWPAN_STAT(sicslowpan_stats.copied_out += packetbuf_payload_len);
       packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-      q = queuebuf_new_from_packetbuf();
-      if(q == NULL) {
-        PRINTFO("could not allocate queuebuf, dropping fragment\n");
-        return 0;
-      }
       send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
-      q = NULL;
       processed_ip_out_len += packetbuf_payload_len;
 
       /* Check tx result. */
@@ -1469,6 +2441,16 @@ output(const uip_lladdr_t *localdest)
         return 0;
       }
     }
+#if SICSLOWPAN_FRAG_FORWARDING
+    if(vrb_out != NULL) {
+      /* Switch the following fragments to the next hop */
+      linkaddr_copy(&vrb_out->next_hop, &dest);
+      vrb_out->out_tag = frag_tag;
+      vrb_out->out_len = datagram_len;
+      vrb_out->offset_shift = shift / 8;
+      vrb_out->forwarded_len = vrb_first_len;
+    }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 #else /* SICSLOWPAN_CONF_FRAG */
     PRINTFO("sicslowpan output: Packet too large to be sent without fragmentation support; dropping packet\n");
     return 0;
@@ -1481,9 +2463,11 @@ output(const uip_lladdr_t *localdest)
      */
     memcpy(packetbuf_ptr + packetbuf_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
            uip_len - uncomp_hdr_len);
+    SICSLOWPAN_STAT(sicslowpan_stats.copied_out += uip_len - uncomp_hdr_len);
     packetbuf_set_datalen(uip_len - uncomp_hdr_len + packetbuf_hdr_len);
     send_packet(&dest);
   }
+  SICSLOWPAN_STAT(sicslowpan_stats.ip_out++);
   return 1;
 }
 
@@ -1507,6 +2491,9 @@ input(void)
   /* offset of the fragment in the IP packet */
   uint8_t frag_offset = 0;
   uint8_t *buffer;
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_6LORH
+  uint8_t lorh;
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_6LORH */
 
 #if SICSLOWPAN_CONF_FRAG
   uint8_t is_fragment = 0;
@@ -1515,6 +2502,9 @@ input(void)
   /* tag of the fragment */
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0, last_fragment = 0;
+#if SICSLOWPAN_FRAG_FORWARDING
+  struct sicslowpan_vrb *vrb_entry = NULL;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* Update link statistics */
@@ -1562,7 +2552,7 @@ input(void)
         return;
       }
 
-      buffer = frag_info[frag_context].first_frag;
+      buffer = frag_info[frag_context].buf.u8;
 
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1578,6 +2568,12 @@ input(void)
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_forward(frag_tag, frag_size, frag_offset)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* If this is the last fragment, we may shave off any extrenous
          bytes at the end. We must be liberal in what we accept. */
       PRINTFI("last_fragment?: packetbuf_payload_len %d frag_size %d\n",
@@ -1594,10 +2590,6 @@ input(void)
       /* Ok - add_fragment will store the fragment automatically - so
          we should not store more */
       buffer = NULL;
-
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
@@ -1612,9 +2604,28 @@ input(void)
 
   /* Process next dispatch and headers */
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+#if SICSLOWPAN_6LORH
+  lorh = PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] == SICSLOWPAN_DISPATCH_PAGING_1;
+  if(lorh) {
+    PRINTFI("sicslowpan input: 6LoRH\n");
+    if(!parse_6lorh()) {
+      return;
+    }
+  }
+#endif /* SICSLOWPAN_6LORH */
   if((PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] & 0xe0) == SICSLOWPAN_DISPATCH_IPHC) {
     PRINTFI("sicslowpan input: IPHC\n");
     uncompress_hdr_iphc(buffer, frag_size);
+#if SICSLOWPAN_6LORH
+    if(lorh && !uncompress_hdr_6lorh(buffer,
+#if SICSLOWPAN_CONF_FRAG
+                                     is_fragment ? SICSLOWPAN_REASS_BUFSIZE :
+#endif /* SICSLOWPAN_CONF_FRAG */
+                                     UIP_BUFSIZE - UIP_LLH_LEN,
+                                     frag_size)) {
+      return;
+    }
+#endif /* SICSLOWPAN_6LORH */
   } else
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
     switch(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH]) {
@@ -1624,6 +2635,7 @@ input(void)
 
       /* Put uncompressed IP header in sicslowpan_buf. */
       memcpy(buffer, packetbuf_ptr + packetbuf_hdr_len, UIP_IPH_LEN);
+      SICSLOWPAN_STAT(sicslowpan_stats.copied_in += UIP_IPH_LEN);
 
       /* Update uncomp_hdr_len and packetbuf_hdr_len. */
       packetbuf_hdr_len += UIP_IPH_LEN;
@@ -1636,6 +2648,21 @@ input(void)
       return;
   }
 
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+  /* Following fragments that arrived before the first one are in the
+     reassembly context, the datagram is then reassembled here */
+  if(first_fragment && frag_info[frag_context].received_units == 0) {
+    vrb_entry = vrb_alloc(SICSLOWPAN_IP_BUF(buffer), frag_tag, frag_size);
+    if(vrb_entry != NULL) {
+      /* The first fragment goes to uip_buf, to be routed by uIP */
+      memcpy(UIP_IP_BUF, buffer, uncomp_hdr_len);
+      SICSLOWPAN_STAT(sicslowpan_stats.copied_in += uncomp_hdr_len);
+      clear_fragments(frag_context);
+      buffer = (uint8_t *)UIP_IP_BUF;
+      first_fragment = 0;
+    }
+  }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
 
 #if SICSLOWPAN_CONF_FRAG
  copypayload:
@@ -1664,27 +2691,44 @@ input(void)
           packetbuf_payload_len, req_size, (unsigned)sizeof(uip_buf));
       return;
     }
+#if SICSLOWPAN_CONF_FRAG
+    if(first_fragment &&
+       uncomp_hdr_len + packetbuf_payload_len > SICSLOWPAN_REASS_BUFSIZE) {
+      PRINTF("SICSLOWPAN: first fragment dropped, larger than the reassembly buffer\n");
+      clear_fragments(frag_context);
+      return;
+    }
+#endif /* SICSLOWPAN_CONF_FRAG */
   }
 
   /* copy the payload if buffer is non-null - which is only the case with first fragment
      or packets that are non fragmented */
   if(buffer != NULL) {
     memcpy((uint8_t *)buffer + uncomp_hdr_len, packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
+    SICSLOWPAN_STAT(sicslowpan_stats.copied_in += packetbuf_payload_len);
+  }
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+  if(vrb_entry != NULL) {
+    vrb_input_first(vrb_entry);
+    return;
   }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
 
   /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
   if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
-      frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+    /* The first fragment was stored while uncompressing, with the
+       size of the uncompressed header. */
+    if(first_fragment != 0 &&
+       mark_fragment(frag_context, 0, uncomp_hdr_len + packetbuf_payload_len) < 0) {
+      return;
     }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      frag_info[frag_context].reassembled_len = frag_size;
+    /* The fragments may have arrived in any order, the datagram is
+       complete once all its units are in. */
+    if(fragments_complete(frag_context)) {
+      last_fragment = 1;
       /* copy to uip */
       copy_frags2uip(frag_context);
     }
@@ -1719,6 +2763,8 @@ input(void)
     }
 #endif
 
+    SICSLOWPAN_STAT(sicslowpan_stats.ip_in++);
+
     /* if callback is set then set attributes and call */
     if(callback) {
       set_packet_attrs();
@@ -1745,6 +2791,14 @@ sicslowpan_init(void)
 
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_STATS
+  memset(&sicslowpan_stats, 0, sizeof(sicslowpan_stats));
+#endif /* SICSLOWPAN_STATS */
+
+#if SICSLOWPAN_CONF_FRAG
+  init_fragments();
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
@@ -82,6 +82,30 @@
 #define SICSLOWPAN_DISPATCH_IPHC                    0x60 /* 011xxxxx = ... */
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
+#define SICSLOWPAN_DISPATCH_PAGING_1                0xf1 /* 11110001 */
+/** @} */
+
+/**
+ * \name 6LoWPAN Routing Header (6LoRH, RFC 8138) encoding, in page 1
+ * @{
+ */
+#define SICSLOWPAN_6LORH_MASK                       0xc0
+#define SICSLOWPAN_6LORH_ID                         0x80 /* 10xxxxxx */
+#define SICSLOWPAN_6LORH_FORM_MASK                  0xe0
+#define SICSLOWPAN_6LORH_CRITICAL                   0x80 /* 100xxxxx */
+#define SICSLOWPAN_6LORH_ELECTIVE                   0xa0 /* 101xxxxx */
+#define SICSLOWPAN_6LORH_LEN_MASK                   0x1f
+/* 6LoRH types. The SRH-6LoRH types 0 to 4 give the size of the
+   compressed addresses, 1, 2, 4, 8 or 16 bytes. */
+#define SICSLOWPAN_6LORH_TYPE_SRH_MAX               4
+#define SICSLOWPAN_6LORH_TYPE_RPI                   5
+#define SICSLOWPAN_6LORH_TYPE_IP_IN_IP              6
+/* RPI-6LoRH flags, in place of the length */
+#define SICSLOWPAN_6LORH_RPI_O                      0x10
+#define SICSLOWPAN_6LORH_RPI_R                      0x08
+#define SICSLOWPAN_6LORH_RPI_F                      0x04
+#define SICSLOWPAN_6LORH_RPI_I                      0x02
+#define SICSLOWPAN_6LORH_RPI_K                      0x01
 /** @} */
 
 /** \name HC1 encoding
@@ -319,6 +343,36 @@ struct sicslowpan_nh_compressor {
 
 };
 
+/* Keep statistics on the datagrams sent and received, and on the
+   number of datagram bytes copied between uip_buf, packetbuf and the
+   reassembly buffers. */
+#ifdef SICSLOWPAN_CONF_STATS
+#define SICSLOWPAN_STATS SICSLOWPAN_CONF_STATS
+#else /* SICSLOWPAN_CONF_STATS */
+#define SICSLOWPAN_STATS 0
+#endif /* SICSLOWPAN_CONF_STATS */
+
+#if SICSLOWPAN_STATS
+/** Statistics of the 6lowpan layer. */
+struct sicslowpan_stats {
+  uint32_t ip_in;       /**< Datagrams passed up to the IP layer */
+  uint32_t ip_out;      /**< Datagrams passed down to the MAC layer */
+  uint32_t copied_in;   /**< Bytes copied for received datagrams */
+  uint32_t copied_out;  /**< Bytes copied for sent datagrams */
+  uint16_t reass_timeouts;   /**< Reassemblies dropped after SICSLOWPAN_REASS_MAXAGE */
+  uint16_t reass_duplicates; /**< Fragments dropped as already received */
+  uint16_t reass_overlaps;   /**< Reassemblies dropped for overlapping fragments */
+  uint16_t reass_no_context; /**< Fragments dropped for lack of a free context */
+  uint32_t rpl_hdr_bytes; /**< Bytes of RPL headers compressed into 6LoRHs */
+  uint32_t lorh_bytes;    /**< Bytes of the 6LoRHs they were compressed into */
+};
+
+extern struct sicslowpan_stats sicslowpan_stats;
+#define SICSLOWPAN_STAT(code) (code)
+#else /* SICSLOWPAN_STATS */
+#define SICSLOWPAN_STAT(code)
+#endif /* SICSLOWPAN_STATS */
+
 int sicslowpan_get_last_rssi(void);
 
 extern const struct network_driver sicslowpan_driver;
@@ -41,6 +41,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ip/uip.h"
 
+#include "lib/dlist.h"
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "net/nbr-table.h"
@@ -68,13 +69,23 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 
 /* Each route is repressented by a uip_ds6_route_t structure and
    memory for each route is allocated from the routememb memory
-   block. These routes are maintained on the routelist. */
-LIST(routelist);
+   block. These routes are maintained on the routelist, which is
+   doubly linked so that the most recently used route can be moved to
+   its front in constant time. */
+DLIST(routelist);
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_HASH_SIZE
+/* Routes are also indexed for uip_ds6_route_lookup(). Host routes are
+   chained in hash buckets, other routes are on the prefix_routes list
+   with the longest prefixes first. Both use the index_next field. */
+static uip_ds6_route_t *host_routes[UIP_DS6_ROUTE_HASH_SIZE];
+static uip_ds6_route_t *prefix_routes;
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
+
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -161,7 +172,11 @@ uip_ds6_route_init(void)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
   memb_init(&routememb);
-  list_init(routelist);
+  dlist_init(routelist);
+#if UIP_DS6_ROUTE_HASH_SIZE
+  memset(host_routes, 0, sizeof(host_routes));
+  prefix_routes = NULL;
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -185,6 +200,72 @@ uip_ds6_route_nexthop_lladdr(uip_ds6_route_t *route)
     return NULL;
   }
 }
+/*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH_SIZE
+static uip_ds6_route_t **
+index_bucket(const uip_ipaddr_t *addr)
+{
+  uint16_t h = 0;
+  int i;
+
+  for(i = 0; i < sizeof(uip_ipaddr_t); i++) {
+    h = (h << 5) + h + addr->u8[i];
+  }
+  return &host_routes[h % UIP_DS6_ROUTE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  if(r->length == 128) {
+    p = index_bucket(&r->ipaddr);
+  } else {
+    for(p = &prefix_routes;
+        *p != NULL && (*p)->length > r->length;
+        p = &(*p)->index_next);
+  }
+  r->index_next = *p;
+  *p = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  if(r->length == 128) {
+    p = index_bucket(&r->ipaddr);
+  } else {
+    p = &prefix_routes;
+  }
+  for(; *p != NULL; p = &(*p)->index_next) {
+    if(*p == r) {
+      *p = r->index_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+
+  for(r = *index_bucket(addr); r != NULL; r = r->index_next) {
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      return r;
+    }
+  }
+  for(r = prefix_routes; r != NULL; r = r->index_next) {
+    if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 /*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
@@ -205,7 +286,7 @@ uip_ds6_route_t *
 uip_ds6_route_head(void)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
-  return list_head(routelist);
+  return dlist_head(routelist);
 #else /* (UIP_CONF_MAX_ROUTES != 0) */
   return NULL;
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -216,7 +297,7 @@ uip_ds6_route_next(uip_ds6_route_t *r)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
   if(r != NULL) {
-    uip_ds6_route_t *n = list_item_next(r);
+    uip_ds6_route_t *n = dlist_item_next(r);
     return n;
   }
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -254,15 +335,19 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH_SIZE
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH_SIZE */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
-
+#if UIP_DS6_ROUTE_HASH_SIZE
+  found_route = index_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH_SIZE */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -278,6 +363,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -289,14 +375,13 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
+  if(found_route != NULL && found_route != dlist_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the end of the
        list - for fast lookups (assuming multiple packets to the same node). */
 
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+    dlist_push(routelist, found_route);
   }
 
   return found_route;
@@ -355,7 +440,7 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 #if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
       /* Removing the oldest route entry from the route table. The
          least recently used route is the first route on the list. */
-      oldest = list_tail(routelist);
+      oldest = dlist_tail(routelist);
 #endif
       if(oldest == NULL) {
         return NULL;
@@ -411,13 +496,14 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
     /* add new routes first - assuming that there is a reason to add this
        and that there is a packet coming soon. */
-    list_push(routelist, r);
+    dlist_push(routelist, r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       PRINTF("uip_ds6_route_add: could not allocate neighbor route list entry\n");
+      dlist_remove(routelist, r);
       memb_free(&routememb, r);
       return NULL;
     }
@@ -436,6 +522,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH_SIZE
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -478,7 +567,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     /* Remove the route from the route list */
-    list_remove(routelist, route);
+    dlist_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH_SIZE
+    index_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -88,6 +88,15 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Number of buckets in the hash index of host (/128) routes. Routes
+   to shorter prefixes are kept on a separate list, sorted by prefix
+   length. With 0, uip_ds6_route_lookup() scans the whole route list. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_CONF_DS6_ROUTE_HASH_SIZE
+#else /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_NB
+#endif /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -147,6 +156,14 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+  /* The route list is a doubly linked list (see lib/dlist.h). */
+  struct uip_ds6_route *prev;
+  struct dlist *list;
+#if UIP_DS6_ROUTE_HASH_SIZE
+  /* The next route in the same hash bucket for host routes, or on the
+     prefix route list for shorter prefixes. */
+  struct uip_ds6_route *index_next;
+#endif /* UIP_DS6_ROUTE_HASH_SIZE */
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
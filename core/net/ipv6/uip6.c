@@ -74,6 +74,7 @@
 #include "sys/cc.h"
 #include "net/ip/uip.h"
 #include "net/ip/uip_arch.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ip/uipopt.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
@@ -193,6 +194,12 @@ uint16_t uip_urglen, uip_surglen;
 
 /* The uip_len is either 8 or 16 bits, depending on the maximum packet size.*/
 uint16_t uip_len, uip_slen;
+
+#if UIP_TCP_SEND_WINDOW
+/* The offset from the oldest unacknowledged byte of the segment to be
+   sent on a windowed connection, set through uip_send_at(). */
+uint16_t uip_sndoff;
+#endif /* UIP_TCP_SEND_WINDOW */
 /** @} */
 
 /*---------------------------------------------------------------------------*/
@@ -268,6 +275,99 @@ struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
 #endif /* UIP_UDP */
 /** @} */
 
+/*---------------------------------------------------------------------------*/
+/**
+ * \name Local port indexes
+ * @{
+ */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_HASH
+/* Each index hashes local ports into buckets, which chain the slots of
+   the connections or listening ports that use a port of the bucket.
+   Chains are kept in slot order so that the first match is the one a
+   scan of the whole table would find. A slot is in the index while its
+   port is non-zero, and stays there when a TCP connection is closed:
+   lookups check the state of what they find. */
+#if UIP_UDP_CONNS < 255 && UIP_CONNS < 255 && UIP_LISTENPORTS < 255
+typedef uint8_t port_slot_t;
+#define PORT_NONE 0xff
+#else
+typedef uint16_t port_slot_t;
+#define PORT_NONE 0xffff
+#endif
+
+/* The smallest power of two with at least n buckets */
+#define PORT_BUCKETS(n) ((n) <= 4 ? 4 : (n) <= 8 ? 8 : (n) <= 16 ? 16 : \
+                         (n) <= 32 ? 32 : (n) <= 64 ? 64 :              \
+                         (n) <= 128 ? 128 : (n) <= 256 ? 256 :          \
+                         (n) <= 512 ? 512 : 1024)
+
+struct port_index {
+  port_slot_t *buckets;
+  port_slot_t *next;
+  uint16_t mask;
+};
+
+#define PORT_INDEX(name, slots)                                         \
+  static port_slot_t name##_buckets[PORT_BUCKETS(slots)];               \
+  static port_slot_t name##_next[slots];                                \
+  static const struct port_index name = {                               \
+    name##_buckets, name##_next, PORT_BUCKETS(slots) - 1 }
+
+#if UIP_UDP
+PORT_INDEX(udp_ports, UIP_UDP_CONNS);
+#endif /* UIP_UDP */
+#if UIP_TCP
+PORT_INDEX(tcp_ports, UIP_CONNS);
+PORT_INDEX(listen_ports, UIP_LISTENPORTS);
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+static port_slot_t *
+port_bucket(const struct port_index *index, uint16_t port)
+{
+  /* Ports are in network byte order, fold both bytes into the hash */
+  return &index->buckets[(port ^ (port >> 8)) & index->mask];
+}
+/*---------------------------------------------------------------------------*/
+static void
+port_index_init(const struct port_index *index)
+{
+  uint16_t i;
+
+  for(i = 0; i <= index->mask; i++) {
+    index->buckets[i] = PORT_NONE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+port_index_add(const struct port_index *index, uint16_t port,
+               port_slot_t slot)
+{
+  port_slot_t *p;
+
+  for(p = port_bucket(index, port); *p != PORT_NONE && *p < slot;
+      p = &index->next[*p]);
+  index->next[slot] = *p;
+  *p = slot;
+}
+/*---------------------------------------------------------------------------*/
+static void
+port_index_remove(const struct port_index *index, uint16_t port,
+                  port_slot_t slot)
+{
+  port_slot_t *p;
+
+  for(p = port_bucket(index, port); *p != PORT_NONE;
+      p = &index->next[*p]) {
+    if(*p == slot) {
+      *p = index->next[slot];
+      return;
+    }
+  }
+}
+#endif /* UIP_CONN_HASH */
+/** @} */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \name ICMPv6 variables
@@ -318,41 +418,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -361,7 +430,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -391,11 +460,11 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
-               upper_layer_len);
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+                       upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -439,7 +508,12 @@ uip_init(void)
   }
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
+    uip_conns[c].lport = 0;
   }
+#if UIP_CONN_HASH
+  port_index_init(&tcp_ports);
+  port_index_init(&listen_ports);
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -450,6 +524,9 @@ uip_init(void)
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
   }
+#if UIP_CONN_HASH
+  port_index_init(&udp_ports);
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_UDP */
 
 #if UIP_IPV6_MULTICAST
@@ -457,6 +534,45 @@ uip_init(void)
 #endif
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP
+static void
+tcp_bind(struct uip_conn *conn, uint16_t port)
+{
+#if UIP_CONN_HASH
+  if(conn->lport != 0) {
+    port_index_remove(&tcp_ports, conn->lport, conn - uip_conns);
+  }
+  if(port != 0) {
+    port_index_add(&tcp_ports, port, conn - uip_conns);
+  }
+#endif /* UIP_CONN_HASH */
+  conn->lport = port;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ACTIVE_OPEN
+static int
+tcp_port_used(uint16_t port)
+{
+#if UIP_CONN_HASH
+  port_slot_t slot;
+
+  for(slot = *port_bucket(&tcp_ports, port); slot != PORT_NONE;
+      slot = tcp_ports.next[slot]) {
+#else /* UIP_CONN_HASH */
+  int slot;
+
+  for(slot = 0; slot < UIP_CONNS; ++slot) {
+#endif /* UIP_CONN_HASH */
+    if(uip_conns[slot].tcpstateflags != UIP_CLOSED &&
+       uip_conns[slot].lport == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* UIP_ACTIVE_OPEN */
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
 #if UIP_TCP && UIP_ACTIVE_OPEN
 struct uip_conn *
 uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
@@ -474,12 +590,8 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
 
   /* Check if this port is already in use, and if so try to find
      another one. */
-  for(c = 0; c < UIP_CONNS; ++c) {
-    conn = &uip_conns[c];
-    if(conn->tcpstateflags != UIP_CLOSED &&
-       conn->lport == uip_htons(lastport)) {
-      goto again;
-    }
+  if(tcp_port_used(uip_htons(lastport))) {
+    goto again;
   }
 
   conn = 0;
@@ -517,11 +629,17 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
 
   conn->len = 1;   /* TCP length of the SYN is one. */
   conn->nrtx = 0;
+#if UIP_TCP_SEND_WINDOW
+  conn->windowed = 0;
+  conn->dupacks = 0;
+  conn->snd_wnd_known = 0;
+  conn->snd_wnd = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
-  conn->lport = uip_htons(lastport);
+  tcp_bind(conn, uip_htons(lastport));
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
 
@@ -554,6 +672,40 @@ remove_ext_hdr(void)
 }
 /*---------------------------------------------------------------------------*/
 #if UIP_UDP
+#if UIP_CONN_HASH
+void
+uip_udp_bind(struct uip_udp_conn *conn, uint16_t port)
+{
+  if(conn->lport != 0) {
+    port_index_remove(&udp_ports, conn->lport, conn - uip_udp_conns);
+  }
+  if(port != 0) {
+    port_index_add(&udp_ports, port, conn - uip_udp_conns);
+  }
+  conn->lport = port;
+}
+#endif /* UIP_CONN_HASH */
+/*---------------------------------------------------------------------------*/
+static int
+udp_port_used(uint16_t port)
+{
+#if UIP_CONN_HASH
+  port_slot_t slot;
+
+  for(slot = *port_bucket(&udp_ports, port); slot != PORT_NONE;
+      slot = udp_ports.next[slot]) {
+#else /* UIP_CONN_HASH */
+  int slot;
+
+  for(slot = 0; slot < UIP_UDP_CONNS; ++slot) {
+#endif /* UIP_CONN_HASH */
+    if(uip_udp_conns[slot].lport == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 struct uip_udp_conn *
 uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
 {
@@ -568,10 +720,8 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     lastport = 4096;
   }
 
-  for(c = 0; c < UIP_UDP_CONNS; ++c) {
-    if(uip_udp_conns[c].lport == uip_htons(lastport)) {
-      goto again;
-    }
+  if(udp_port_used(uip_htons(lastport))) {
+    goto again;
   }
 
   conn = 0;
@@ -586,7 +736,7 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     return 0;
   }
 
-  conn->lport = UIP_HTONS(lastport);
+  uip_udp_bind(conn, UIP_HTONS(lastport));
   conn->rport = rport;
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
@@ -606,6 +756,9 @@ uip_unlisten(uint16_t port)
   int c;
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == port) {
+#if UIP_CONN_HASH
+      port_index_remove(&listen_ports, port, c);
+#endif /* UIP_CONN_HASH */
       uip_listenports[c] = 0;
       return;
     }
@@ -619,6 +772,11 @@ uip_listen(uint16_t port)
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == 0) {
       uip_listenports[c] = port;
+#if UIP_CONN_HASH
+      if(port != 0) {
+        port_index_add(&listen_ports, port, c);
+      }
+#endif /* UIP_CONN_HASH */
       return;
     }
   }
@@ -850,6 +1008,31 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+/* Returns the number of bytes in flight on a windowed connection
+   that the incoming segment acknowledges, and leaves the new
+   snd_nxt in uip_acc32. */
+static uint16_t
+tcp_window_acked(struct uip_conn *conn)
+{
+  uint32_t acked;
+
+  acked = (((uint32_t)UIP_TCP_BUF->ackno[0] << 24) |
+           ((uint32_t)UIP_TCP_BUF->ackno[1] << 16) |
+           ((uint32_t)UIP_TCP_BUF->ackno[2] << 8) |
+           UIP_TCP_BUF->ackno[3]) -
+          (((uint32_t)conn->snd_nxt[0] << 24) |
+           ((uint32_t)conn->snd_nxt[1] << 16) |
+           ((uint32_t)conn->snd_nxt[2] << 8) |
+           conn->snd_nxt[3]);
+  if(acked == 0 || acked > conn->len) {
+    return 0;
+  }
+  uip_add32(conn->snd_nxt, acked);
+  return acked;
+}
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif
 /*---------------------------------------------------------------------------*/
 
@@ -945,21 +1128,38 @@ uip_process(uint8_t flag)
   uint16_t tmp16;
   uint8_t opt;
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_SEND_WINDOW
+  uint16_t acked;
+  uint16_t sndoff = 0;
+  uint8_t wnd_update = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif /* UIP_TCP */
+#if UIP_CONN_HASH && (UIP_UDP || UIP_TCP)
+  port_slot_t slot;
+#endif /* UIP_CONN_HASH && (UIP_UDP || UIP_TCP) */
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
     goto udp_send;
   }
 #endif /* UIP_UDP */
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+#if UIP_TCP_SEND_WINDOW
+  uip_sndoff = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
 
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
+    /* Windowed connections may send more even with data in flight. */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       (!uip_outstanding(uip_connr)
+#if UIP_TCP_SEND_WINDOW
+        || uip_connr->windowed
+#endif /* UIP_TCP_SEND_WINDOW */
+        )) {
       uip_flags = UIP_POLL;
+      uip_slen = 0;
       UIP_APPCALL();
       goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -1061,6 +1261,15 @@ uip_process(uint8_t flag)
              * label).
              */
             uip_flags = UIP_REXMIT;
+#if UIP_TCP_SEND_WINDOW
+            if(uip_connr->windowed) {
+              /* The application goes back to the start of its window,
+                 see uip_send_at(). */
+              uip_connr->dupacks = 0;
+              UIP_APPCALL();
+              goto appsend;
+            }
+#endif /* UIP_TCP_SEND_WINDOW */
             UIP_APPCALL();
             goto apprexmit;
 
@@ -1503,9 +1712,15 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONN_HASH
+  for(slot = *port_bucket(&udp_ports, UIP_UDP_BUF->destport);
+      slot != PORT_NONE; slot = udp_ports.next[slot]) {
+    uip_udp_conn = &uip_udp_conns[slot];
+#else /* UIP_CONN_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
+#endif /* UIP_CONN_HASH */
     /* If the local UDP port is non-zero, the connection is considered
        to be used. If so, the local port number is checked against the
        destination port number in the received packet. If the two port
@@ -1607,8 +1822,14 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONN_HASH
+  for(slot = *port_bucket(&tcp_ports, UIP_TCP_BUF->destport);
+      slot != PORT_NONE; slot = tcp_ports.next[slot]) {
+    uip_connr = &uip_conns[slot];
+#else /* UIP_CONN_HASH */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
+#endif /* UIP_CONN_HASH */
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
        UIP_TCP_BUF->destport == uip_connr->lport &&
        UIP_TCP_BUF->srcport == uip_connr->rport &&
@@ -1627,11 +1848,20 @@ uip_process(uint8_t flag)
 
   tmp16 = UIP_TCP_BUF->destport;
   /* Next, check listening connections. */
+#if UIP_CONN_HASH
+  for(slot = *port_bucket(&listen_ports, tmp16); slot != PORT_NONE;
+      slot = listen_ports.next[slot]) {
+    if(tmp16 == uip_listenports[slot]) {
+      goto found_listen;
+    }
+  }
+#else /* UIP_CONN_HASH */
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(tmp16 == uip_listenports[c]) {
       goto found_listen;
     }
   }
+#endif /* UIP_CONN_HASH */
 
   /* No matching connection found, so we send a RST packet. */
   UIP_STAT(++uip_stat.tcp.synrst);
@@ -1728,7 +1958,13 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
-  uip_connr->lport = UIP_TCP_BUF->destport;
+#if UIP_TCP_SEND_WINDOW
+  uip_connr->windowed = 0;
+  uip_connr->dupacks = 0;
+  uip_connr->snd_wnd_known = 0;
+  uip_connr->snd_wnd = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
+  tcp_bind(uip_connr, UIP_TCP_BUF->destport);
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
@@ -1859,6 +2095,14 @@ uip_process(uint8_t flag)
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
+#if UIP_TCP_SEND_WINDOW
+    /* A windowed connection may have several segments in flight, of
+       which the peer can acknowledge any number. */
+    acked = uip_connr->len;
+    if(uip_connr->windowed) {
+      acked = tcp_window_acked(uip_connr);
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
 
     if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
        UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
@@ -1890,12 +2134,34 @@ uip_process(uint8_t flag)
       /* Reset the retransmission timer. */
       uip_connr->timer = uip_connr->rto;
 
+#if UIP_TCP_SEND_WINDOW
+      /* Reset length of outstanding data, and the retransmission
+         state of windowed connections, which are not reset when the
+         application sends new data. */
+      uip_connr->len -= acked;
+      if(uip_connr->windowed) {
+        uip_connr->nrtx = 0;
+        uip_connr->dupacks = 0;
+      }
+#else /* UIP_TCP_SEND_WINDOW */
       /* Reset length of outstanding data. */
       uip_connr->len = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
     }
 
   }
 
+#if UIP_TCP_SEND_WINDOW
+  /* Windowed connections keep track of the window that the peer
+     advertises, since they may fill more than one segment of it. */
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) | UIP_TCP_BUF->wnd[1];
+    wnd_update = uip_connr->snd_wnd_known && tmp16 != uip_connr->snd_wnd;
+    uip_connr->snd_wnd = tmp16;
+    uip_connr->snd_wnd_known = 1;
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
+
   /* Do different things depending on in what state the connection is. */
   switch(uip_connr->tcpstateflags & UIP_TS_MASK) {
   /* CLOSED and LISTEN are not handled here. CLOSE_WAIT is not
@@ -2046,6 +2312,15 @@ uip_process(uint8_t flag)
       uip_flags |= UIP_NEWDATA;
       uip_add_rcv_nxt(uip_len);
     }
+#if UIP_TCP_SEND_WINDOW
+    /* Data that we do not accept is still acknowledged, with the
+       closed window, so that a peer probing the window knows that we
+       are alive. */
+    if(uip_len > 0 && uip_flags == 0 &&
+       (uip_connr->tcpstateflags & UIP_STOPPED)) {
+      goto tcp_send_ack;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
 
     /* Check if the available buffer space advertised by the other end
          is smaller than the initial MSS for this connection. If so, we
@@ -2082,6 +2357,50 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
+#if UIP_TCP_SEND_WINDOW
+    /* A duplicate ACK for a windowed connection means that a segment
+       was lost but later ones got through. At the third one, we ask
+       the application to retransmit the oldest segment (fast
+       retransmit), and every further one lets it send more data, as
+       another segment has left the network. */
+    if(uip_connr->windowed && uip_flags == 0 && uip_outstanding(uip_connr) &&
+       (UIP_TCP_BUF->flags & TCP_CTL) == TCP_ACK &&
+       memcmp(UIP_TCP_BUF->ackno, uip_connr->snd_nxt, 4) == 0) {
+      if(wnd_update) {
+        /* Not a duplicate ACK but a window update, which may let the
+           application send more. */
+        uip_flags = UIP_POLL;
+        uip_slen = 0;
+        UIP_APPCALL();
+        goto appsend;
+      }
+      if(uip_connr->snd_wnd == 0) {
+        /* The answer to a zero window probe. The peer is alive, so
+           the connection does not time out while the window stays
+           closed: the probes go on at the longest backoff. */
+        if(uip_connr->nrtx > 4) {
+          uip_connr->nrtx = 4;
+        }
+        goto drop;
+      }
+      if(uip_connr->dupacks < 0xff) {
+        ++uip_connr->dupacks;
+      }
+      if(uip_connr->dupacks >= UIP_TCP_DUPACKS) {
+        if(uip_connr->dupacks == UIP_TCP_DUPACKS) {
+          UIP_STAT(++uip_stat.tcp.rexmit);
+          uip_flags = UIP_REXMIT;
+        } else {
+          uip_flags = UIP_POLL;
+        }
+        uip_slen = 0;
+        UIP_APPCALL();
+        goto appsend;
+      }
+      goto drop;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
+
     if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
       uip_slen = 0;
       UIP_APPCALL();
@@ -2104,6 +2423,31 @@ uip_process(uint8_t flag)
         goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      if(uip_connr->windowed) {
+        /* The application sends its segment at an offset into the
+           window with uip_send_at(), which may not leave a gap after
+           the data already in flight. The application keeps the
+           data in flight, so the retransmission state is not reset
+           here. */
+        if(uip_slen > 0 && uip_sndoff <= uip_connr->len) {
+          if(uip_slen > uip_connr->mss) {
+            uip_slen = uip_connr->mss;
+          }
+          if(uip_sndoff + uip_slen > uip_connr->len) {
+            uip_connr->len = uip_sndoff + uip_slen;
+          }
+          sndoff = uip_sndoff;
+          uip_appdata = uip_sappdata;
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+        uip_slen = 0;
+        goto apprexmit;
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
+
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
 
@@ -2253,6 +2597,12 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SEND_WINDOW
+  if(sndoff > 0) {
+    uip_add32(UIP_TCP_BUF->seqno, sndoff);
+    memcpy(UIP_TCP_BUF->seqno, uip_acc32, 4);
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
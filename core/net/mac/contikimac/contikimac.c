@@ -863,16 +863,15 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     return;
   }
 
-  /* Create and secure frames in advance */
+  /* Create and secure the frames of the burst in advance. The MAC has
+     set PACKETBUF_ATTR_PENDING on all of them but the last one. */
   curr = buf_list;
   do {
     next = list_item_next(curr);
     queuebuf_to_packetbuf(curr->buf);
+    pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
     if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
       /* create and secure this frame */
-      if(next != NULL) {
-        packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
-      }
       packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
       if(NETSTACK_FRAMER.create() < 0) {
         PRINTF("contikimac: framer failed\n");
@@ -884,7 +883,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       queuebuf_update_from_packetbuf(curr->buf);
     }
     curr = next;
-  } while(next != NULL);
+  } while(next != NULL && pending);
 
   /* The receiver needs to be awoken before we send */
   is_receiver_awake = 0;
@@ -415,7 +415,7 @@ on_sfd(void)
 #endif /* SECRDC_WITH_SECURE_PHASE_LOCK */
   if(is_duty_cycling && u.duty_cycle.waiting_for_shr) {
     u.duty_cycle.got_shr = 1;
-    rtimer_run_next();
+    rtimer_run_now(&timer);
     rtimer_set(&timer, RTIMER_NOW(), 1, on_rtimer_freed, NULL);
   }
 }
@@ -93,11 +93,87 @@
 #define CSMA_MAX_MAX_FRAME_RETRIES 7
 #endif
 
+/* Frames queued for the same neighbor are sent in bursts: back to back,
+   with the frame pending bit set on all but the last one of the burst.
+   CSMA_BURST_MAX_FRAMES bounds the number of frames in a burst, 1
+   disables bursts. */
+#ifdef CSMA_CONF_BURST_MAX_FRAMES
+#define CSMA_BURST_MAX_FRAMES CSMA_CONF_BURST_MAX_FRAMES
+#else
+#define CSMA_BURST_MAX_FRAMES 4
+#endif
+
+/* The airtime budget of a burst, in microseconds. The airtime of a
+   frame is estimated for a 250 kbit/s radio, including the PHY header,
+   MAC header and the acknowledgment. */
+#ifdef CSMA_CONF_BURST_AIRTIME
+#define CSMA_BURST_AIRTIME CSMA_CONF_BURST_AIRTIME
+#else
+#define CSMA_BURST_AIRTIME 20000
+#endif
+
+/* The security enabled and frame pending bits of the first byte of the
+   IEEE 802.15.4 frame control field */
+#define FCF_SECURITY_ENABLED 0x08
+#define FCF_FRAME_PENDING    0x10
+
+/* Bytes on air per frame on top of the queued packet: SHR and PHR,
+   MAC header and FCS, turnaround and the acknowledgment */
+#define BURST_FRAME_OVERHEAD 40
+#define BURST_FRAME_AIRTIME(q) \
+  (32UL * (queuebuf_datalen((q)->buf) + BURST_FRAME_OVERHEAD))
+
+#if CSMA_WITH_PRIORITIES
+/* Retry budget of each priority class */
+#ifdef CSMA_CONF_DATA_MAX_FRAME_RETRIES
+#define CSMA_DATA_MAX_FRAME_RETRIES CSMA_CONF_DATA_MAX_FRAME_RETRIES
+#else
+#define CSMA_DATA_MAX_FRAME_RETRIES CSMA_MAX_MAX_FRAME_RETRIES
+#endif
+
+#ifdef CSMA_CONF_ACK_MAX_FRAME_RETRIES
+#define CSMA_ACK_MAX_FRAME_RETRIES CSMA_CONF_ACK_MAX_FRAME_RETRIES
+#else
+#define CSMA_ACK_MAX_FRAME_RETRIES CSMA_MAX_MAX_FRAME_RETRIES
+#endif
+
+#ifdef CSMA_CONF_CONTROL_MAX_FRAME_RETRIES
+#define CSMA_CONTROL_MAX_FRAME_RETRIES CSMA_CONF_CONTROL_MAX_FRAME_RETRIES
+#else
+#define CSMA_CONTROL_MAX_FRAME_RETRIES CSMA_MAX_MAX_FRAME_RETRIES
+#endif
+
+/* The number of queued packets that only the ACK and control classes
+   may use, so that they still get through when data fills the queues */
+#ifdef CSMA_CONF_PRIORITY_RESERVE
+#define CSMA_PRIORITY_RESERVE CSMA_CONF_PRIORITY_RESERVE
+#else
+#define CSMA_PRIORITY_RESERVE (MAX_QUEUED_PACKETS / 4)
+#endif
+
+/* The same, for the slots of each neighbor queue */
+#ifdef CSMA_CONF_PRIORITY_NEIGHBOR_RESERVE
+#define CSMA_PRIORITY_NEIGHBOR_RESERVE CSMA_CONF_PRIORITY_NEIGHBOR_RESERVE
+#else
+#define CSMA_PRIORITY_NEIGHBOR_RESERVE (CSMA_MAX_PACKET_PER_NEIGHBOR / 4)
+#endif
+
+/* The classes are served in strict priority order, highest first. With
+   CSMA_CONF_PRIORITY_WEIGHTS, e.g. { 1, 2, 4 } for the data, ACK and
+   control classes, they are served in weighted round robin instead. */
+#ifdef CSMA_CONF_PRIORITY_WEIGHTS
+#define CSMA_PRIORITY_WEIGHTS CSMA_CONF_PRIORITY_WEIGHTS
+#endif
+#endif /* CSMA_WITH_PRIORITIES */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+#if CSMA_WITH_PRIORITIES
+  uint8_t priority;
+#endif /* CSMA_WITH_PRIORITIES */
 };
 
 /* Every neighbor has its own packet queue */
@@ -107,6 +183,9 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+#ifdef CSMA_PRIORITY_WEIGHTS
+  uint8_t credits[PACKETBUF_ATTR_PRIORITY_NUM];
+#endif /* CSMA_PRIORITY_WEIGHTS */
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -130,6 +209,22 @@ MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+#if CSMA_WITH_PRIORITIES
+struct csma_class_stats csma_class_stats[PACKETBUF_ATTR_PRIORITY_NUM];
+
+static const uint8_t class_max_transmissions[PACKETBUF_ATTR_PRIORITY_NUM] = {
+  CSMA_DATA_MAX_FRAME_RETRIES + 1,
+  CSMA_ACK_MAX_FRAME_RETRIES + 1,
+  CSMA_CONTROL_MAX_FRAME_RETRIES + 1
+};
+#ifdef CSMA_PRIORITY_WEIGHTS
+static const uint8_t class_weights[PACKETBUF_ATTR_PRIORITY_NUM] =
+  CSMA_PRIORITY_WEIGHTS;
+#endif /* CSMA_PRIORITY_WEIGHTS */
+
+#define PRIORITY(q) (((struct qbuf_metadata *)(q)->ptr)->priority)
+#endif /* CSMA_WITH_PRIORITIES */
+
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 /*---------------------------------------------------------------------------*/
@@ -163,15 +258,120 @@ backoff_period(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+/* Clears the frame pending bit of a frame that the RDC has already
+   created, once no frame follows it anymore. The bit is in the first
+   byte of the frame control field. A secured frame cannot be changed
+   without breaking its MIC: it keeps the bit in its header, and the
+   receiver only stays awake a little longer after it. */
+static void
+clear_created_pending(struct rdc_buf_list *q)
+{
+  uint8_t *frame;
+
+  queuebuf_set_attr(q->buf, PACKETBUF_ATTR_PENDING, 0);
+  frame = queuebuf_dataptr(q->buf);
+  if(!(frame[0] & FCF_SECURITY_ENABLED)) {
+    frame[0] &= ~FCF_FRAME_PENDING;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Marks the frames that the RDC sends back to back with the head of
+   the queue, by setting PACKETBUF_ATTR_PENDING on all of them but the
+   last. A frame that the RDC has already created keeps its frame
+   pending bit, so the burst ends at the first such frame without it,
+   unless it is the last frame of the queue. */
+static void
+mark_burst(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q;
+  struct rdc_buf_list *next;
+  unsigned long airtime;
+  uint8_t frames;
+  int pending;
+
+  q = list_head(n->queued_packet_list);
+  airtime = BURST_FRAME_AIRTIME(q);
+  for(frames = 1; ; frames++) {
+    next = list_item_next(q);
+    if(queuebuf_attr(q->buf, PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+      pending = queuebuf_attr(q->buf, PACKETBUF_ATTR_PENDING);
+      if(pending && next == NULL) {
+        /* The frames that followed it when it was created are gone */
+        clear_created_pending(q);
+      }
+    } else {
+      /* No bursts of broadcasts, nobody acknowledges them */
+      pending = next != NULL &&
+        frames < CSMA_BURST_MAX_FRAMES &&
+        !linkaddr_cmp(&n->addr, &linkaddr_null) &&
+        airtime + BURST_FRAME_AIRTIME(next) <= CSMA_BURST_AIRTIME;
+      if(queuebuf_attr(q->buf, PACKETBUF_ATTR_PENDING) != pending) {
+        queuebuf_set_attr(q->buf, PACKETBUF_ATTR_PENDING, pending);
+      }
+    }
+    if(!pending || next == NULL) {
+      break;
+    }
+    airtime += BURST_FRAME_AIRTIME(next);
+    q = next;
+  }
+  PRINTF("csma: burst of %u frames, %lu us\n", frames, airtime);
+}
+/*---------------------------------------------------------------------------*/
+#ifdef CSMA_PRIORITY_WEIGHTS
+/* Weighted round robin between the classes: moves the first packet of
+   the class to serve next to the head of the queue. Each class gets as
+   many turns as its weight in a round. */
+static void
+select_class(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *first[PACKETBUF_ATTR_PRIORITY_NUM];
+  struct rdc_buf_list *q;
+  int round;
+  int c;
+
+  memset(first, 0, sizeof(first));
+  for(q = list_head(n->queued_packet_list); q != NULL; q = list_item_next(q)) {
+    if(first[PRIORITY(q)] == NULL) {
+      first[PRIORITY(q)] = q;
+    }
+  }
+
+  for(round = 0; round < 2; round++) {
+    for(c = PACKETBUF_ATTR_PRIORITY_NUM - 1; c >= 0; c--) {
+      if(first[c] != NULL && n->credits[c] > 0) {
+        n->credits[c]--;
+        if(first[c] != list_head(n->queued_packet_list)) {
+          list_remove(n->queued_packet_list, first[c]);
+          list_push(n->queued_packet_list, first[c]);
+        }
+        return;
+      }
+    }
+    /* The classes with packets have used their turns, start a new round */
+    memcpy(n->credits, class_weights, sizeof(n->credits));
+  }
+}
+#endif /* CSMA_PRIORITY_WEIGHTS */
+/*---------------------------------------------------------------------------*/
 static void
 transmit_packet_list(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
-    struct rdc_buf_list *q = list_head(n->queued_packet_list);
+    struct rdc_buf_list *q;
+#ifdef CSMA_PRIORITY_WEIGHTS
+    if(n->transmissions == 0 && n->collisions == CSMA_MIN_BE &&
+       list_head(n->queued_packet_list) != NULL) {
+      /* This is a new packet, not a retransmission */
+      select_class(n);
+    }
+#endif /* CSMA_PRIORITY_WEIGHTS */
+    q = list_head(n->queued_packet_list);
     if(q != NULL) {
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+      mark_burst(n);
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
     }
@@ -250,6 +450,14 @@ tx_done(int status, struct rdc_buf_list *q, struct neighbor_queue *n)
     break;
   }
 
+#if CSMA_WITH_PRIORITIES
+  if(status == MAC_TX_OK) {
+    csma_class_stats[metadata->priority].sent++;
+  } else {
+    csma_class_stats[metadata->priority].tx_drops++;
+  }
+#endif /* CSMA_WITH_PRIORITIES */
+
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, n->transmissions);
 }
@@ -360,12 +568,43 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_WITH_PRIORITIES
+/* Queues q ahead of the packets of lower classes, but never ahead of
+   the head of the queue, which may already be on its way. */
+static void
+enqueue_by_priority(struct neighbor_queue *n, struct rdc_buf_list *q)
+{
+  struct rdc_buf_list *prev;
+  struct rdc_buf_list *p;
+
+  prev = list_head(n->queued_packet_list);
+  if(prev == NULL) {
+    list_add(n->queued_packet_list, q);
+    return;
+  }
+  for(p = list_item_next(prev); p != NULL; p = list_item_next(p)) {
+    if(PRIORITY(p) < PRIORITY(q)) {
+      break;
+    }
+    prev = p;
+  }
+  list_insert(n->queued_packet_list, prev, q);
+}
+#endif /* CSMA_WITH_PRIORITIES */
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   struct rdc_buf_list *q;
   struct neighbor_queue *n;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+#if CSMA_WITH_PRIORITIES
+  uint8_t priority = packetbuf_attr(PACKETBUF_ATTR_PRIORITY);
+
+  if(priority >= PACKETBUF_ATTR_PRIORITY_NUM) {
+    priority = PACKETBUF_ATTR_PRIORITY_NUM - 1;
+  }
+#endif /* CSMA_WITH_PRIORITIES */
 
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
@@ -377,6 +616,9 @@ send_packet(mac_callback_t sent, void *ptr)
       linkaddr_copy(&n->addr, addr);
       n->transmissions = 0;
       n->collisions = CSMA_MIN_BE;
+#ifdef CSMA_PRIORITY_WEIGHTS
+      memcpy(n->credits, class_weights, sizeof(n->credits));
+#endif /* CSMA_PRIORITY_WEIGHTS */
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
@@ -387,7 +629,19 @@ send_packet(mac_callback_t sent, void *ptr)
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
     if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
-      q = memb_alloc(&packet_memb);
+#if CSMA_WITH_PRIORITIES
+      if(priority == PACKETBUF_ATTR_PRIORITY_DATA &&
+         (list_length(n->queued_packet_list) >=
+          CSMA_MAX_PACKET_PER_NEIGHBOR - CSMA_PRIORITY_NEIGHBOR_RESERVE ||
+          memb_numfree(&packet_memb) <= CSMA_PRIORITY_RESERVE ||
+          queuebuf_numfree() <= CSMA_PRIORITY_RESERVE)) {
+        /* Leave the reserved packets to the other classes */
+        q = NULL;
+      } else
+#endif /* CSMA_WITH_PRIORITIES */
+      {
+        q = memb_alloc(&packet_memb);
+      }
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
         if(q->ptr != NULL) {
@@ -397,13 +651,20 @@ send_packet(mac_callback_t sent, void *ptr)
             /* Neighbor and packet successfully allocated */
             if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
               /* Use default configuration for max transmissions */
+#if CSMA_WITH_PRIORITIES
+              metadata->max_transmissions = class_max_transmissions[priority];
+#else /* CSMA_WITH_PRIORITIES */
               metadata->max_transmissions = CSMA_MAX_MAX_FRAME_RETRIES + 1;
+#endif /* CSMA_WITH_PRIORITIES */
             } else {
               metadata->max_transmissions =
                 packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
+#if CSMA_WITH_PRIORITIES
+            metadata->priority = priority;
+#endif /* CSMA_WITH_PRIORITIES */
 #if PACKETBUF_WITH_PACKET_TYPE
             if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
                PACKETBUF_ATTR_PACKET_TYPE_ACK) {
@@ -411,7 +672,11 @@ send_packet(mac_callback_t sent, void *ptr)
             } else
 #endif
             {
+#if CSMA_WITH_PRIORITIES
+              enqueue_by_priority(n, q);
+#else /* CSMA_WITH_PRIORITIES */
               list_add(n->queued_packet_list, q);
+#endif /* CSMA_WITH_PRIORITIES */
             }
 
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
@@ -440,6 +705,9 @@ send_packet(mac_callback_t sent, void *ptr)
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+#if CSMA_WITH_PRIORITIES
+  csma_class_stats[priority].queue_drops++;
+#endif /* CSMA_WITH_PRIORITIES */
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
@@ -42,8 +42,26 @@
 #define CSMA_H_
 
 #include "net/mac/mac.h"
+#include "net/packetbuf.h"
 #include "dev/radio.h"
 
+/* Per-neighbor queues ordered by the priority class of the packets
+   (PACKETBUF_ATTR_PRIORITY), with a retry budget and counters for each
+   class. Set with CSMA_CONF_WITH_PRIORITIES, which also enables
+   PACKETBUF_ATTR_PRIORITY and its sniffing in sicslowpan. */
+#define CSMA_WITH_PRIORITIES PACKETBUF_WITH_PRIORITY
+
+#if CSMA_WITH_PRIORITIES
+struct csma_class_stats {
+  uint16_t sent;          /* Acknowledged, or sent if broadcast */
+  uint16_t queue_drops;   /* Refused because the queue was full */
+  uint16_t tx_drops;      /* Given up after the retry budget */
+};
+
+/* Indexed by PACKETBUF_ATTR_PRIORITY */
+extern struct csma_class_stats csma_class_stats[PACKETBUF_ATTR_PRIORITY_NUM];
+#endif /* CSMA_WITH_PRIORITIES */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
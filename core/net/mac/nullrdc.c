@@ -248,14 +248,18 @@ send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
      * mac_call_sent_callback() */
     struct rdc_buf_list *next = buf_list->next;
     int last_sent_ok;
+    int pending;
 
     queuebuf_to_packetbuf(buf_list->buf);
+    /* The MAC sets PACKETBUF_ATTR_PENDING on all frames of a burst but
+     * the last one */
+    pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
     last_sent_ok = send_one_packet(sent, ptr);
 
     /* If packet transmission was not successful, we should back off and let
      * upper layers retransmit, rather than potentially sending out-of-order
      * packet fragments. */
-    if(!last_sent_ok) {
+    if(!last_sent_ok || !pending) {
       return;
     }
     buf_list = next;
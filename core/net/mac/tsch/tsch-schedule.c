@@ -88,7 +88,7 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       /* Initialize the slotframe */
       sf->handle = handle;
       ASN_DIVISOR_INIT(sf->size, size);
-      LIST_STRUCT_INIT(sf, links_list);
+      DLIST_STRUCT_INIT(sf, links_list);
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -120,7 +120,7 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
   if(slotframe != NULL) {
     /* Remove all links belonging to this slotframe */
     struct tsch_link *l;
-    while((l = list_head(slotframe->links_list))) {
+    while((l = dlist_head(slotframe->links_list))) {
       tsch_schedule_remove_link(slotframe, l);
     }
 
@@ -159,7 +159,7 @@ tsch_schedule_get_link_by_handle(uint16_t handle)
   if(!tsch_is_locked()) {
     struct tsch_slotframe *sf = list_head(slotframe_list);
     while(sf != NULL) {
-      struct tsch_link *l = list_head(sf->links_list);
+      struct tsch_link *l = dlist_head(sf->links_list);
       /* Loop over all items. Assume there is max one link per timeslot */
       while(l != NULL) {
         if(l->handle == handle) {
@@ -196,7 +196,7 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
         static int current_link_handle = 0;
         struct tsch_neighbor *n;
         /* Add the link to the slotframe */
-        list_add(slotframe->links_list, l);
+        dlist_add(slotframe->links_list, l);
         /* Initialize link */
         l->handle = current_link_handle++;
         l->link_options = link_options;
@@ -255,7 +255,7 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
              slotframe->handle, l->link_options, l->timeslot, l->channel_offset,
              TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
 
-      list_remove(slotframe->links_list, l);
+      dlist_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
 
       /* Release the lock before we update the neighbor (will take the lock) */
@@ -294,7 +294,7 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
-      struct tsch_link *l = list_head(slotframe->links_list);
+      struct tsch_link *l = dlist_head(slotframe->links_list);
       /* Loop over all items. Assume there is max one link per timeslot */
       while(l != NULL) {
         if(l->timeslot == timeslot) {
@@ -325,7 +325,7 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = ASN_MOD(*asn, sf->size);
-      struct tsch_link *l = list_head(sf->links_list);
+      struct tsch_link *l = dlist_head(sf->links_list);
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
@@ -428,7 +428,7 @@ tsch_schedule_print(void)
     printf("Schedule: slotframe list\n");
 
     while(sf != NULL) {
-      struct tsch_link *l = list_head(sf->links_list);
+      struct tsch_link *l = dlist_head(sf->links_list);
 
       printf("[Slotframe] Handle %u, size %u\n", sf->handle, sf->size.val);
       printf("List of links:\n");
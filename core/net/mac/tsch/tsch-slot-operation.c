@@ -124,11 +124,11 @@ enum tsch_radio_state_off_cmd {
 
 /* A ringbuf storing outgoing packets after they were dequeued.
  * Will be processed layer by tsch_tx_process_pending */
-struct ringbufindex dequeued_ringbuf;
+struct ringbufelem dequeued_ringbuf;
 struct tsch_packet *dequeued_array[TSCH_DEQUEUED_ARRAY_SIZE];
 /* A ringbuf storing incoming packets.
  * Will be processed layer by tsch_rx_process_pending */
-struct ringbufindex input_ringbuf;
+struct ringbufelem input_ringbuf;
 struct input_packet input_array[TSCH_MAX_INCOMING_PACKETS];
 
 /* Last time we received Sync-IE (ACK or data packet from a time source) */
@@ -482,7 +482,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
   static uint8_t mac_tx_status;
   /* is the packet in its neighbor's queue? */
   uint8_t in_queue;
-  static int dequeued_index;
+  static struct tsch_packet **dequeued_slot;
   static int packet_ready = 1;
 
   PT_BEGIN(pt);
@@ -491,8 +491,8 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
   /* First check if we have space to store a newly dequeued packet (in case of
    * successful Tx or Drop) */
-  dequeued_index = ringbufindex_peek_put(&dequeued_ringbuf);
-  if(dequeued_index != -1) {
+  dequeued_slot = ringbufelem_reserve(&dequeued_ringbuf, NULL);
+  if(dequeued_slot != NULL) {
     if(current_packet == NULL || current_packet->qb == NULL) {
       mac_tx_status = MAC_TX_ERR_FATAL;
     } else {
@@ -696,8 +696,8 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
     /* The packet was dequeued, add it to dequeued_ringbuf for later processing */
     if(in_queue == 0) {
-      dequeued_array[dequeued_index] = current_packet;
-      ringbufindex_put(&dequeued_ringbuf);
+      *dequeued_slot = current_packet;
+      ringbufelem_commit(&dequeued_ringbuf, 1);
     }
 
     /* Log every tx attempt */
@@ -740,18 +740,18 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
   struct tsch_neighbor *n;
   static linkaddr_t source_address;
   static linkaddr_t destination_address;
-  static int16_t input_index;
   static int input_queue_drop = 0;
+  static struct input_packet *current_input;
 
   PT_BEGIN(pt);
 
   TSCH_DEBUG_RX_EVENT();
 
-  input_index = ringbufindex_peek_put(&input_ringbuf);
-  if(input_index == -1) {
+  /* Receive directly into the next free slot of the input ringbuf */
+  current_input = ringbufelem_reserve(&input_ringbuf, NULL);
+  if(current_input == NULL) {
     input_queue_drop++;
   } else {
-    static struct input_packet *current_input;
     /* Estimated drift based on RX time */
     static int32_t estimated_drift;
     /* Rx timestamps */
@@ -764,8 +764,6 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     /* Default start time: expected Rx time */
     rx_start_time = expected_rx_time;
 
-    current_input = &input_array[input_index];
-
     /* Wait before starting to listen */
     TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
     TSCH_DEBUG_RX_EVENT();
@@ -917,7 +915,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
           }
 
           /* Add current input to ringbuf */
-          ringbufindex_put(&input_ringbuf);
+          ringbufelem_commit(&input_ringbuf, 1);
 
           /* Poll process for processing of pending input and logs */
           process_poll(&tsch_pending_events_process);
@@ -36,7 +36,7 @@
 /********** Includes **********/
 
 #include "contiki.h"
-#include "lib/ringbufindex.h"
+#include "lib/ringbufelem.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-private.h"
 
@@ -97,11 +97,11 @@ struct input_packet {
 
 /* A ringbuf storing outgoing packets after they were dequeued.
  * Will be processed layer by tsch_tx_process_pending */
-extern struct ringbufindex dequeued_ringbuf;
+extern struct ringbufelem dequeued_ringbuf;
 extern struct tsch_packet *dequeued_array[TSCH_DEQUEUED_ARRAY_SIZE];
 /* A ringbuf storing incoming packets.
  * Will be processed layer by tsch_rx_process_pending */
-extern struct ringbufindex input_ringbuf;
+extern struct ringbufelem input_ringbuf;
 extern struct input_packet input_array[TSCH_MAX_INCOMING_PACKETS];
 
 /********** Functions *********/
@@ -329,10 +329,9 @@ eb_input(struct input_packet *current_input)
 static void
 tsch_rx_process_pending()
 {
-  int16_t input_index;
+  struct input_packet *current_input;
   /* Loop on accessing (without removing) a pending input packet */
-  while((input_index = ringbufindex_peek_get(&input_ringbuf)) != -1) {
-    struct input_packet *current_input = &input_array[input_index];
+  while((current_input = ringbufelem_peek(&input_ringbuf, NULL)) != NULL) {
     uint8_t ret;
     uint8_t frame_type;
     int is_data = 0;
@@ -356,7 +355,7 @@ tsch_rx_process_pending()
     }
 
     /* Remove input from ringbuf */
-    ringbufindex_get(&input_ringbuf);
+    ringbufelem_consume(&input_ringbuf, 1);
 
     if(is_data) {
       /* Pass to upper layers */
@@ -372,10 +371,10 @@ tsch_rx_process_pending()
 static void
 tsch_tx_process_pending()
 {
-  int16_t dequeued_index;
+  struct tsch_packet **dequeued_slot;
   /* Loop on accessing (without removing) a pending input packet */
-  while((dequeued_index = ringbufindex_peek_get(&dequeued_ringbuf)) != -1) {
-    struct tsch_packet *p = dequeued_array[dequeued_index];
+  while((dequeued_slot = ringbufelem_peek(&dequeued_ringbuf, NULL)) != NULL) {
+    struct tsch_packet *p = *dequeued_slot;
     /* Put packet into packetbuf for packet_sent callback */
     queuebuf_to_packetbuf(p->qb);
     /* Call packet_sent callback */
@@ -385,7 +384,7 @@ tsch_tx_process_pending()
     /* Free all unused neighbors */
     tsch_queue_free_unused_neighbors();
     /* Remove dequeued packet from ringbuf */
-    ringbufindex_get(&dequeued_ringbuf);
+    ringbufelem_consume(&dequeued_ringbuf, 1);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -832,8 +831,10 @@ tsch_init(void)
   tsch_queue_init();
   tsch_schedule_init();
   tsch_log_init();
-  ringbufindex_init(&input_ringbuf, TSCH_MAX_INCOMING_PACKETS);
-  ringbufindex_init(&dequeued_ringbuf, TSCH_DEQUEUED_ARRAY_SIZE);
+  ringbufelem_init(&input_ringbuf, input_array, NULL,
+                   sizeof(struct input_packet), TSCH_MAX_INCOMING_PACKETS);
+  ringbufelem_init(&dequeued_ringbuf, dequeued_array, NULL,
+                   sizeof(struct tsch_packet *), TSCH_DEQUEUED_ARRAY_SIZE);
 
   tsch_is_initialized = 1;
 
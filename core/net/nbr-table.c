@@ -125,17 +125,146 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_HASH
+/*---------------------------------------------------------------------------*/
+/* The hash index is an open addressing table with linear probing. Each
+ * slot holds the index of a key in neighbor_addr_mem, or HASH_EMPTY.
+ * Removals shift the following entries back instead of leaving
+ * tombstones, so that lookups of absent addresses stay short. */
+#if NBR_TABLE_MAX_NEIGHBORS <= 4
+#define HASH_SIZE 8
+#elif NBR_TABLE_MAX_NEIGHBORS <= 8
+#define HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define HASH_SIZE 256
+#elif NBR_TABLE_MAX_NEIGHBORS <= 256
+#define HASH_SIZE 512
+#elif NBR_TABLE_MAX_NEIGHBORS <= 512
+#define HASH_SIZE 1024
+#elif NBR_TABLE_MAX_NEIGHBORS <= 1024
+#define HASH_SIZE 2048
+#elif NBR_TABLE_MAX_NEIGHBORS <= 2048
+#define HASH_SIZE 4096
+#else
+#error "NBR_TABLE_MAX_NEIGHBORS too large for the hash index"
+#endif
+
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t hash_slot_t;
+#define HASH_EMPTY 0xff
+#else
+typedef uint16_t hash_slot_t;
+#define HASH_EMPTY 0xffff
+#endif
+
+static hash_slot_t hash_slots[HASH_SIZE];
+static uint8_t hash_initialized;
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  uint16_t h = 0;
+  int i;
+  /* Neighbors often differ only in the last bytes of their address, so
+     every byte is mixed into the whole hash. */
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 5) + h + lladdr->u8[i];
+  }
+  return (h ^ (h >> 7) ^ (h >> 11)) & (HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_init(void)
+{
+  int i;
+  for(i = 0; i < HASH_SIZE; i++) {
+    hash_slots[i] = HASH_EMPTY;
+  }
+  hash_initialized = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(nbr_table_key_t *key)
+{
+  unsigned i;
+
+  if(!hash_initialized) {
+    hash_init();
+  }
+  i = hash_lladdr(&key->lladdr);
+  while(hash_slots[i] != HASH_EMPTY) {
+    i = (i + 1) & (HASH_SIZE - 1);
+  }
+  hash_slots[i] = index_from_key(key);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  unsigned i, j, home;
+  hash_slot_t index = index_from_key(key);
+
+  if(!hash_initialized) {
+    return;
+  }
+  i = hash_lladdr(&key->lladdr);
+  while(hash_slots[i] != index) {
+    if(hash_slots[i] == HASH_EMPTY) {
+      return;
+    }
+    i = (i + 1) & (HASH_SIZE - 1);
+  }
+
+  /* Move back every following entry of the probe sequence that would
+     no longer be reachable from its home slot once slot i is empty. */
+  j = i;
+  for(;;) {
+    j = (j + 1) & (HASH_SIZE - 1);
+    if(hash_slots[j] == HASH_EMPTY) {
+      break;
+    }
+    home = hash_lladdr(&key_from_index(hash_slots[j])->lladdr);
+    if(((j - home) & (HASH_SIZE - 1)) >= ((j - i) & (HASH_SIZE - 1))) {
+      hash_slots[i] = hash_slots[j];
+      i = j;
+    }
+  }
+  hash_slots[i] = HASH_EMPTY;
+}
+#endif /* NBR_TABLE_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_HASH
+  unsigned i;
+#else /* NBR_TABLE_HASH */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  if(!hash_initialized) {
+    return -1;
+  }
+  i = hash_lladdr(lladdr);
+  while(hash_slots[i] != HASH_EMPTY) {
+    if(linkaddr_cmp(lladdr, &key_from_index(hash_slots[i])->lladdr)) {
+      return hash_slots[i];
+    }
+    i = (i + 1) & (HASH_SIZE - 1);
+  }
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -143,6 +272,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -195,6 +325,9 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+  hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -362,6 +495,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -463,7 +599,13 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
    * Copy the new lladdr into the key - since we know that there is no
    * conflicting entry.
    */
+#if NBR_TABLE_HASH
+  hash_remove(key);
+#endif /* NBR_TABLE_HASH */
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+#if NBR_TABLE_HASH
+  hash_add(key);
+#endif /* NBR_TABLE_HASH */
   NBR_TABLE_RELEASE_LOCK();
   return 1;
 }
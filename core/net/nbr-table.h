@@ -46,6 +46,16 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Look up neighbors through a hash index over their link-layer
+ * addresses instead of scanning all neighbors. The index takes one
+ * byte per slot (two with 255 neighbors or more), with at least twice
+ * as many slots as NBR_TABLE_MAX_NEIGHBORS. */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 1
+#endif /* NBR_TABLE_CONF_HASH */
+
 #ifndef NBR_TABLE_CONF_WITH_LOCKING
 #define NBR_TABLE_CONF_WITH_LOCKING 0
 #endif /* NBR_TABLE_CONF_WITH_LOCKING */
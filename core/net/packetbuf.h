@@ -79,6 +79,14 @@
 #define PACKETBUF_WITH_UNENCRYPTED_BYTES 0
 #endif /* PACKETBUF_CONF_WITH_UNENCRYPTED_BYTES */
 
+/* PACKETBUF_ATTR_PRIORITY is only used by the priority classes of
+   CSMA, which CSMA_CONF_WITH_PRIORITIES enables */
+#ifdef CSMA_CONF_WITH_PRIORITIES
+#define PACKETBUF_WITH_PRIORITY CSMA_CONF_WITH_PRIORITIES
+#else /* CSMA_CONF_WITH_PRIORITIES */
+#define PACKETBUF_WITH_PRIORITY 0
+#endif /* CSMA_CONF_WITH_PRIORITIES */
+
 /**
  * \brief      Clear and reset the packetbuf
  *
@@ -228,6 +236,15 @@ struct packetbuf_addr {
 #define PACKETBUF_ATTR_PACKET_TYPE_STREAM_END 3
 #define PACKETBUF_ATTR_PACKET_TYPE_TIMESTAMP 4
 
+#if PACKETBUF_WITH_PRIORITY
+/* Priority classes of PACKETBUF_ATTR_PRIORITY, lowest first. Packets
+   default to the data class. */
+#define PACKETBUF_ATTR_PRIORITY_DATA         0
+#define PACKETBUF_ATTR_PRIORITY_ACK          1
+#define PACKETBUF_ATTR_PRIORITY_CONTROL      2
+#define PACKETBUF_ATTR_PRIORITY_NUM          3
+#endif /* PACKETBUF_WITH_PRIORITY */
+
 enum {
   PACKETBUF_ATTR_NONE,
 
@@ -244,6 +261,9 @@ enum {
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
   PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+#if PACKETBUF_WITH_PRIORITY
+  PACKETBUF_ATTR_PRIORITY,
+#endif /* PACKETBUF_WITH_PRIORITY */
 #if TSCH_WITH_LINK_SELECTOR
   PACKETBUF_ATTR_TSCH_SLOTFRAME,
   PACKETBUF_ATTR_TSCH_TIMESLOT,
@@ -45,6 +45,31 @@
 #define RPL_CONF_STATS 0
 #endif /* RPL_CONF_STATS */
 
+/*
+ * RPL event trace. When enabled, parent and rank changes, DAO ACKs and
+ * NACKs, repairs and trickle resets are recorded with a timestamp in a
+ * ring of RPL_TRACE_SIZE entries, and all RPL messages sent and
+ * received are counted. See rpl-trace.h.
+ * */
+#ifdef RPL_CONF_WITH_TRACE
+#define RPL_WITH_TRACE RPL_CONF_WITH_TRACE
+#else /* RPL_CONF_WITH_TRACE */
+#define RPL_WITH_TRACE 0
+#endif /* RPL_CONF_WITH_TRACE */
+
+#ifdef RPL_CONF_TRACE_SIZE
+#define RPL_TRACE_SIZE RPL_CONF_TRACE_SIZE
+#else /* RPL_CONF_TRACE_SIZE */
+#define RPL_TRACE_SIZE 32
+#endif /* RPL_CONF_TRACE_SIZE */
+
+/* Set to 1 to also print each recorded event, e.g. for Cooja scripts */
+#ifdef RPL_CONF_TRACE_PRINT
+#define RPL_TRACE_PRINT RPL_CONF_TRACE_PRINT
+#else /* RPL_CONF_TRACE_PRINT */
+#define RPL_TRACE_PRINT 0
+#endif /* RPL_CONF_TRACE_PRINT */
+
 /*
  * The objective function (OF) used by a RPL root is configurable through
  * the RPL_CONF_OF_OCP parameter. This is defined as the objective code
@@ -245,6 +270,39 @@
 #define RPL_WITH_DAO_ACK 0
 #endif /* RPL_CONF_WITH_DAO_ACK */
 
+/*
+ * RPL DAO aggregation, for storing mode. When enabled, a node holds
+ * the targets of the DAOs it forwards for RPL_DAO_AGGREGATION_DELAY
+ * and sends them to its parent together, in DAOs of up to
+ * RPL_DAO_MAX_TARGETS targets. A node also advertises all its global
+ * addresses in one DAO, instead of only the first one.
+ * DAOs with several targets are accepted either way.
+ * */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION 0
+#endif /* RPL_CONF_DAO_AGGREGATION */
+
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY RPL_CONF_DAO_AGGREGATION_DELAY
+#else
+#define RPL_DAO_AGGREGATION_DELAY CLOCK_SECOND
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+/*
+ * The most targets a node puts in one DAO, and the most targets it
+ * forwards from one received DAO (up to twice as many with
+ * aggregation). Targets beyond that are dropped and counted in
+ * rpl_stats.dao_fwd_drops, until they are advertised again by the
+ * next DAO refresh.
+ * */
+#ifdef RPL_CONF_DAO_MAX_TARGETS
+#define RPL_DAO_MAX_TARGETS RPL_CONF_DAO_MAX_TARGETS
+#else
+#define RPL_DAO_MAX_TARGETS 4
+#endif /* RPL_CONF_DAO_MAX_TARGETS */
+
 /*
  * RPL REPAIR ON DAO NACK. When enabled, DAO NACK will trigger a local
  * repair in order to quickly find a new parent to send DAO's to.
@@ -249,6 +249,9 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
     RPL_CALLBACK_PARENT_SWITCH(dag->preferred_parent, p);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
 
+    RPL_TRACE(RPL_TRACE_PARENT, p != NULL ? rpl_get_parent_ipaddr(p) : NULL,
+              p != NULL ? p->rank : 0, 0);
+
     /* Always keep the preferred parent locked, so it remains in the
      * neighbor table. */
     nbr_table_unlock(rpl_parents, dag->preferred_parent);
@@ -435,6 +438,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   PRINTF("\n");
 
   ANNOTATE("#A root=%u\n", dag->dag_id.u8[sizeof(dag->dag_id) - 1]);
+  RPL_TRACE(RPL_TRACE_JOIN, &dag->dag_id, dag->rank, dag->version);
 
   rpl_reset_dio_timer(instance);
 
@@ -456,6 +460,8 @@ rpl_repair_root(uint8_t instance_id)
 
   RPL_LOLLIPOP_INCREMENT(instance->current_dag->version);
   RPL_LOLLIPOP_INCREMENT(instance->dtsn_out);
+  RPL_TRACE(RPL_TRACE_GLOBAL_REPAIR, NULL, instance->current_dag->rank,
+            instance->current_dag->version);
   PRINTF("RPL: rpl_repair_root initiating global repair with version %d\n", instance->current_dag->version);
   rpl_reset_dio_timer(instance);
   return 1;
@@ -822,6 +828,10 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
     return NULL;
   }
 
+  if(best_dag->rank != old_rank) {
+    RPL_TRACE(RPL_TRACE_RANK, NULL, best_dag->rank, 0);
+  }
+
   if(best_dag->preferred_parent != last_parent) {
     rpl_set_default_route(instance, rpl_get_parent_ipaddr(best_dag->preferred_parent));
     PRINTF("RPL: Changed preferred parent, rank changed from %u to %u\n",
@@ -1161,6 +1171,7 @@ rpl_join_instance(uip_ipaddr_t *from, rpl_dio_t *dio)
   PRINTF("\n");
 
   ANNOTATE("#A join=%u\n", dag->dag_id.u8[sizeof(dag->dag_id) - 1]);
+  RPL_TRACE(RPL_TRACE_JOIN, &dag->dag_id, dag->rank, dag->version);
 
   rpl_reset_dio_timer(instance);
   rpl_set_default_route(instance, from);
@@ -1251,6 +1262,7 @@ rpl_add_dag(uip_ipaddr_t *from, rpl_dio_t *dio)
   PRINTF("\n");
 
   ANNOTATE("#A join=%u\n", dag->dag_id.u8[sizeof(dag->dag_id) - 1]);
+  RPL_TRACE(RPL_TRACE_JOIN, &dag->dag_id, dag->rank, dag->version);
 
   rpl_process_parent_event(instance, p);
   p->dtsn = dio->dtsn;
@@ -1292,6 +1304,7 @@ global_repair(uip_ipaddr_t *from, rpl_dag_t *dag, rpl_dio_t *dio)
 
   PRINTF("RPL: Participating in a global repair (version=%u, rank=%hu)\n",
          dag->version, dag->rank);
+  RPL_TRACE(RPL_TRACE_GLOBAL_REPAIR, from, dag->rank, dag->version);
 
   RPL_STAT(rpl_stats.global_repairs++);
 }
@@ -1322,6 +1335,7 @@ rpl_local_repair(rpl_instance_t *instance)
   RPL_LOLLIPOP_INCREMENT(instance->dtsn_out);
 
   RPL_STAT(rpl_stats.local_repairs++);
+  RPL_TRACE(RPL_TRACE_LOCAL_REPAIR, NULL, INFINITE_RANK, 0);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -322,21 +322,84 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   return n;
 }
 /*---------------------------------------------------------------------------*/
+/* Makes room for a Source Routing Header of path_len addresses, with
+   ComprI == ComprE == cmpr, after the IPv6 header and fills in
+   everything but the addresses. Returns where the addresses go, or
+   NULL if the packet would be too long. */
+static uint8_t *
+make_srh(uint8_t path_len, uint8_t cmpr)
+{
+  uint8_t temp_len;
+  uint8_t ext_len;
+  uint8_t padding;
+  uint8_t *addresses;
+
+  /* Extension header length: fixed headers + (n-1) * (16-ComprI) + (16-ComprE)*/
+  ext_len = RPL_RH_LEN + RPL_SRH_LEN
+      + (path_len - 1) * (16 - cmpr)
+      + (16 - cmpr);
+
+  padding = ext_len % 8 == 0 ? 0 : (8 - (ext_len % 8));
+  ext_len += padding;
+
+  PRINTF("RPL: SRH Path len: %u, ComprI %u, ComprE %u, ext len %u (padding %u)\n",
+      path_len, cmpr, cmpr, ext_len, padding);
+
+  /* Check if there is enough space to store the extension header */
+  if(uip_len + ext_len > UIP_BUFSIZE) {
+    PRINTF("RPL: Packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+    return NULL;
+  }
+
+  /* Move existing ext headers and payload uip_ext_len further */
+  memmove(uip_buf + uip_l2_l3_hdr_len + ext_len,
+      uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
+  memset(uip_buf + uip_l2_l3_hdr_len, 0, ext_len);
+
+  /* Insert source routing header */
+  UIP_RH_BUF->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+
+  /* Initialize IPv6 Routing Header */
+  UIP_RH_BUF->len = (ext_len - 8) / 8;
+  UIP_RH_BUF->routing_type = RPL_RH_TYPE_SRH;
+  UIP_RH_BUF->seg_left = path_len;
+
+  /* Initialize RPL Source Routing Header */
+  UIP_RPL_SRH_BUF->cmpr = (cmpr << 4) + cmpr;
+  UIP_RPL_SRH_BUF->pad = padding << 4;
+
+  addresses = ((uint8_t *)UIP_RH_BUF) + RPL_RH_LEN + RPL_SRH_LEN;
+
+  /* In-place update of IPv6 length field */
+  temp_len = UIP_IP_BUF->len[1];
+  UIP_IP_BUF->len[1] += ext_len;
+  if(UIP_IP_BUF->len[1] < temp_len) {
+    UIP_IP_BUF->len[0]++;
+  }
+
+  uip_ext_len += ext_len;
+  uip_len += ext_len;
+
+  return addresses;
+}
+/*---------------------------------------------------------------------------*/
 static int
 insert_srh_header(void)
 {
   /* Implementation of RFC6554 */
-  uint8_t temp_len;
   uint8_t path_len;
-  uint8_t ext_len;
-  uint8_t cmpri, cmpre; /* ComprI and ComprE fields of the RPL Source Routing Header */
+  uint8_t cmpri; /* ComprI and ComprE fields of the RPL Source Routing Header */
+  uint8_t *addresses;
   uint8_t *hop_ptr;
-  uint8_t padding;
   rpl_ns_node_t *dest_node;
   rpl_ns_node_t *root_node;
   rpl_ns_node_t *node;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
+#if RPL_NS_SRH_CACHE_SIZE
+  const rpl_ns_srh_t *srh;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
 
   PRINTF("RPL: SRH creating source routing header with destination ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
@@ -358,6 +421,21 @@ insert_srh_header(void)
     return 1;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  /* Use the source route compiled for an earlier packet, if any */
+  srh = rpl_ns_srh_lookup(dest_node);
+  if(srh != NULL) {
+    PRINTF("RPL: SRH from cache\n");
+    addresses = make_srh(srh->path_len, srh->cmpr);
+    if(addresses != NULL) {
+      memcpy(addresses, srh->addresses, srh->path_len * (16 - srh->cmpr));
+      rpl_ns_get_node_global_addr(&node_addr, srh->first_hop);
+      uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
+    }
+    return 1;
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
   root_node = rpl_ns_get_node(dag, &dag->dag_id);
   if(root_node == NULL) {
     PRINTF("RPL: SRH root node not found\n");
@@ -374,7 +452,6 @@ insert_srh_header(void)
   node = dest_node->parent;
   /* For simplicity, we use cmpri = cmpre */
   cmpri = 15;
-  cmpre = 15;
 
   if(node == root_node) {
     PRINTF("RPL: SRH no need to insert SRH\n");
@@ -387,7 +464,6 @@ insert_srh_header(void)
 
     /* How many bytes in common between all nodes in the path? */
     cmpri = MIN(cmpri, count_matching_bytes(&node_addr, &UIP_IP_BUF->destipaddr, 16));
-    cmpre = cmpri;
 
     PRINTF("RPL: SRH Hop ");
     PRINT6ADDR(&node_addr);
@@ -396,45 +472,15 @@ insert_srh_header(void)
     path_len++;
   }
 
-  /* Extension header length: fixed headers + (n-1) * (16-ComprI) + (16-ComprE)*/
-  ext_len = RPL_RH_LEN + RPL_SRH_LEN
-      + (path_len - 1) * (16 - cmpre)
-      + (16 - cmpri);
-
-  padding = ext_len % 8 == 0 ? 0 : (8 - (ext_len % 8));
-  ext_len += padding;
-
-  PRINTF("RPL: SRH Path len: %u, ComprI %u, ComprE %u, ext len %u (padding %u)\n",
-      path_len, cmpri, cmpre, ext_len, padding);
-
-  /* Check if there is enough space to store the extension header */
-  if(uip_len + ext_len > UIP_BUFSIZE) {
-    PRINTF("RPL: Packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+  addresses = make_srh(path_len, cmpri);
+  if(addresses == NULL) {
     return 1;
   }
 
-  /* Move existing ext headers and payload uip_ext_len further */
-  memmove(uip_buf + uip_l2_l3_hdr_len + ext_len,
-      uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
-  memset(uip_buf + uip_l2_l3_hdr_len, 0, ext_len);
-
-  /* Insert source routing header */
-  UIP_RH_BUF->next = UIP_IP_BUF->proto;
-  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
-
-  /* Initialize IPv6 Routing Header */
-  UIP_RH_BUF->len = (ext_len - 8) / 8;
-  UIP_RH_BUF->routing_type = RPL_RH_TYPE_SRH;
-  UIP_RH_BUF->seg_left = path_len;
-
-  /* Initialize RPL Source Routing Header */
-  UIP_RPL_SRH_BUF->cmpr = (cmpri << 4) + cmpre;
-  UIP_RPL_SRH_BUF->pad = padding << 4;
-
   /* Initialize addresses field (the actual source route).
    * From last to first. */
   node = dest_node;
-  hop_ptr = ((uint8_t *)UIP_RH_BUF) + ext_len - padding; /* Pointer where to write the next hop compressed address */
+  hop_ptr = addresses + path_len * (16 - cmpri); /* Pointer where to write the next hop compressed address */
 
   while(node != NULL && node->parent != root_node) {
     rpl_ns_get_node_global_addr(&node_addr, node);
@@ -445,20 +491,14 @@ insert_srh_header(void)
     node = node->parent;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  rpl_ns_srh_store(dest_node, node, path_len, cmpri, addresses);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
   /* The next hop (i.e. node whose parent is the root) is placed as the current IPv6 destination */
   rpl_ns_get_node_global_addr(&node_addr, node);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
-  /* In-place update of IPv6 length field */
-  temp_len = UIP_IP_BUF->len[1];
-  UIP_IP_BUF->len[1] += ext_len;
-  if(UIP_IP_BUF->len[1] < temp_len) {
-    UIP_IP_BUF->len[0]++;
-  }
-
-  uip_ext_len += ext_len;
-  uip_len += ext_len;
-
   return 1;
 }
 #else /* RPL_WITH_NON_STORING */
@@ -78,8 +78,8 @@ static void dio_input(void);
 static void dao_input(void);
 static void dao_ack_input(void);
 
-static void dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
-				  uint8_t lifetime, uint8_t seq_no);
+static void dao_output_targets(rpl_parent_t *parent, const uip_ipaddr_t *prefixes,
+                               int count, uint8_t lifetime, uint8_t seq_no);
 
 /* some debug callbacks useful when debugging RPL networks */
 #ifdef RPL_DEBUG_DIO_INPUT
@@ -121,38 +121,59 @@ find_route_entry_by_dao_ack(uint8_t seq)
 #endif /* RPL_WITH_DAO_ACK */
 
 #if RPL_WITH_STORING
-/* prepare for forwarding of DAO */
-static uint8_t
-prepare_for_dao_fwd(uint8_t sequence, uip_ds6_route_t *rep)
-{
-  /* not pending - or pending but not a retransmission */
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-
-  /* set DAO pending and sequence numbers */
-  rep->state.dao_seqno_in = sequence;
-  rep->state.dao_seqno_out = dao_sequence;
-  RPL_ROUTE_SET_DAO_PENDING(rep);
-  return dao_sequence;
-}
+/* Targets of received DAOs, waiting to be sent on to the preferred
+   parent. A target from a retransmitted DAO, whose route still waits
+   for the parent's DAO ACK, goes out again with the sequence number of
+   that ACK. */
+struct dao_fwd_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+  uint8_t instance_id;
+  uint8_t retransmit;
+  uint8_t seqno_out;
+};
+
+#if RPL_DAO_AGGREGATION
+/* Room for the targets of one more DAO while a full DAO waits */
+#define DAO_FWD_QUEUE_SIZE (2 * RPL_DAO_MAX_TARGETS)
+static struct ctimer dao_fwd_timer;
+#else /* RPL_DAO_AGGREGATION */
+#define DAO_FWD_QUEUE_SIZE RPL_DAO_MAX_TARGETS
+#endif /* RPL_DAO_AGGREGATION */
+
+static struct dao_fwd_target dao_fwd_queue[DAO_FWD_QUEUE_SIZE];
+static uint8_t dao_fwd_count;
 #endif /* RPL_WITH_STORING */
+
+/* Own addresses advertised in one DAO */
+#if RPL_DAO_AGGREGATION
+#define DAO_OWN_TARGETS MIN(UIP_DS6_ADDR_NB, RPL_DAO_MAX_TARGETS)
+#else /* RPL_DAO_AGGREGATION */
+#define DAO_OWN_TARGETS 1
+#endif /* RPL_DAO_AGGREGATION */
+
+/* Space for RPL options in a DAO */
+#define DAO_MAX_LEN (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPICMPH_LEN)
 /*---------------------------------------------------------------------------*/
 static int
-get_global_addr(uip_ipaddr_t *addr)
+get_global_addrs(uip_ipaddr_t *addrs, int max)
 {
   int i;
+  int n;
   int state;
 
-  for(i = 0; i < UIP_DS6_ADDR_NB; i++) {
+  n = 0;
+  for(i = 0; i < UIP_DS6_ADDR_NB && n < max; i++) {
     state = uip_ds6_if.addr_list[i].state;
     if(uip_ds6_if.addr_list[i].isused &&
        (state == ADDR_TENTATIVE || state == ADDR_PREFERRED)) {
       if(!uip_is_addr_linklocal(&uip_ds6_if.addr_list[i].ipaddr)) {
-        memcpy(addr, &uip_ds6_if.addr_list[i].ipaddr, sizeof(uip_ipaddr_t));
-        return 1;
+        memcpy(&addrs[n++], &uip_ds6_if.addr_list[i].ipaddr, sizeof(uip_ipaddr_t));
       }
     }
   }
-  return 0;
+  return n;
 }
 /*---------------------------------------------------------------------------*/
 static uint32_t
@@ -222,6 +243,7 @@ dis_input(void)
   PRINTF("RPL: Received a DIS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("\n");
+  RPL_TRACE(RPL_TRACE_DIS_IN, NULL, 0, 0);
 
   for(instance = &instance_table[0], end = instance + RPL_MAX_INSTANCES;
       instance < end; ++instance) {
@@ -281,6 +303,7 @@ dis_output(uip_ipaddr_t *addr)
   PRINT6ADDR(addr);
   PRINTF("\n");
 
+  RPL_TRACE(RPL_TRACE_DIS_OUT, NULL, 0, 0);
   uip_icmp6_send(addr, ICMP6_RPL, RPL_CODE_DIS, 2);
 }
 /*---------------------------------------------------------------------------*/
@@ -296,6 +319,7 @@ dio_input(void)
   uip_ipaddr_t from;
 
   memset(&dio, 0, sizeof(dio));
+  RPL_TRACE(RPL_TRACE_DIO_IN, NULL, 0, 0);
 
   /* Set default values in case the DIO configuration option is missing. */
   dio.dag_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
@@ -612,6 +636,7 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
       (unsigned)dag->rank);
   PRINT6ADDR(uc_addr);
   PRINTF("\n");
+  RPL_TRACE(RPL_TRACE_DIO_OUT, NULL, 0, 0);
   uip_icmp6_send(uc_addr, ICMP6_RPL, RPL_CODE_DIO, pos);
 #else /* RPL_LEAF_ONLY */
   /* Unicast requests get unicast replies! */
@@ -619,17 +644,281 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
     PRINTF("RPL: Sending a multicast-DIO with rank %u\n",
         (unsigned)instance->current_dag->rank);
     uip_create_linklocal_rplnodes_mcast(&addr);
+    RPL_TRACE(RPL_TRACE_DIO_OUT, NULL, 0, 0);
     uip_icmp6_send(&addr, ICMP6_RPL, RPL_CODE_DIO, pos);
   } else {
     PRINTF("RPL: Sending unicast-DIO with rank %u to ",
         (unsigned)instance->current_dag->rank);
     PRINT6ADDR(uc_addr);
     PRINTF("\n");
+    RPL_TRACE(RPL_TRACE_DIO_OUT, NULL, 0, 0);
     uip_icmp6_send(uc_addr, ICMP6_RPL, RPL_CODE_DIO, pos);
   }
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+/* Writes the DAO base object to buffer and returns its length */
+static int
+dao_add_header(unsigned char *buffer, rpl_dag_t *dag, int ack, uint8_t seq_no)
+{
+  int pos;
+
+  pos = 0;
+  buffer[pos++] = dag->instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+#if RPL_WITH_DAO_ACK
+  if(ack) {
+    buffer[pos] |= RPL_DAO_K_FLAG;
+  }
+#endif /* RPL_WITH_DAO_ACK */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = seq_no;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos+=sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_add_target(unsigned char *buffer, int pos, const uip_ipaddr_t *prefix,
+               uint8_t prefixlen)
+{
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = prefixlen;
+  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
+  pos += ((prefixlen + 7) / CHAR_BIT);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+/* Adds the transit information for the targets added since the last
+   one. In non-storing mode it holds the parent's global address. */
+static int
+dao_add_transit(unsigned char *buffer, int pos, rpl_parent_t *parent,
+                uint8_t lifetime)
+{
+  rpl_instance_t *instance = parent->dag->instance;
+
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = (instance->mop != RPL_MOP_NON_STORING) ? 4 : 20;
+  buffer[pos++] = 0; /* flags - ignored */
+  buffer[pos++] = 0; /* path control - ignored */
+  buffer[pos++] = 0; /* path seq - ignored */
+  buffer[pos++] = lifetime;
+
+  if(instance->mop == RPL_MOP_NON_STORING) {
+    /* Include parent global IP address */
+    memcpy(buffer + pos, &parent->dag->dag_id, 8); /* Prefix */
+    pos += 8;
+    memcpy(buffer + pos, ((const unsigned char *)rpl_get_parent_ipaddr(parent)) + 8, 8); /* Interface identifier */
+    pos += 8;
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the length of the DAO option at position i of buffer */
+static int
+dao_option_len(const unsigned char *buffer, int i)
+{
+  if(buffer[i] == RPL_OPTION_PAD1) {
+    return 1;
+  }
+  /* The option consists of a two-byte header and a payload. */
+  return 2 + buffer[i + 1];
+}
+/*---------------------------------------------------------------------------*/
+/* Reads the target option at position i of buffer. Returns 0 if the
+   prefix length is not valid. */
+static int
+dao_get_target(const unsigned char *buffer, int i, uip_ipaddr_t *prefix,
+               uint8_t *prefixlen)
+{
+  *prefixlen = buffer[i + 3];
+  if(*prefixlen > sizeof(*prefix) * CHAR_BIT) {
+    return 0;
+  }
+  memset(prefix, 0, sizeof(*prefix));
+  memcpy(prefix, buffer + i + 4, (*prefixlen + 7) / CHAR_BIT);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING
+/* Queues a target for the preferred parent. A target that is already
+   queued takes the lifetime of the latest DAO. Unless rep is NULL, the
+   route to the target records the sequence number of the DAO it came
+   in, and a retransmission of a DAO still pending reuses the outgoing
+   sequence number. */
+static void
+dao_fwd_add(rpl_instance_t *instance, const uip_ipaddr_t *prefix,
+            uint8_t prefixlen, uint8_t lifetime,
+            uip_ds6_route_t *rep, uint8_t sequence)
+{
+  uint8_t retransmit;
+  struct dao_fwd_target *t;
+  int i;
+
+  retransmit = 0;
+  if(rep != NULL) {
+    /* if this is pending and we get the same seq no it is a retrans */
+    retransmit = RPL_ROUTE_IS_DAO_PENDING(rep) &&
+                 rep->state.dao_seqno_in == sequence;
+    rep->state.dao_seqno_in = sequence;
+  }
+
+  for(i = 0; i < dao_fwd_count; i++) {
+    t = &dao_fwd_queue[i];
+    if(t->instance_id == instance->instance_id &&
+       t->prefixlen == prefixlen && uip_ipaddr_cmp(&t->prefix, prefix)) {
+      t->lifetime = lifetime;
+      return;
+    }
+  }
+
+  if(dao_fwd_count == DAO_FWD_QUEUE_SIZE) {
+    /* The queue holds the received DAO until it is parsed, so the
+       target cannot be flushed to the parent here. */
+    RPL_STAT(rpl_stats.dao_fwd_drops++);
+    PRINTF("RPL: No room to forward DAO target ");
+    PRINT6ADDR(prefix);
+    PRINTF("\n");
+    return;
+  }
+
+  t = &dao_fwd_queue[dao_fwd_count++];
+  uip_ipaddr_copy(&t->prefix, prefix);
+  t->prefixlen = prefixlen;
+  t->lifetime = lifetime;
+  t->instance_id = instance->instance_id;
+  t->retransmit = retransmit;
+  t->seqno_out = retransmit ? rep->state.dao_seqno_out : 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Tells whether two queued targets can share a DAO */
+static int
+dao_fwd_match(const struct dao_fwd_target *t, const struct dao_fwd_target *u)
+{
+  return t->instance_id == u->instance_id &&
+    t->retransmit == u->retransmit &&
+    (!t->retransmit || t->seqno_out == u->seqno_out);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the queued targets to the preferred parent, in as few DAOs as
+   possible. Targets with the same lifetime share a transit option.
+   Retransmitted targets go out in DAOs of their own, one for each
+   sequence number the parent has yet to acknowledge. */
+static void
+dao_fwd_send(void *ptr)
+{
+  uint8_t picked[DAO_FWD_QUEUE_SIZE];
+  struct dao_fwd_target *t;
+  rpl_instance_t *instance;
+  rpl_parent_t *parent;
+  uip_ipaddr_t *parent_ipaddr;
+  uip_ds6_route_t *rep;
+  unsigned char *buffer;
+  uint8_t lifetime;
+  uint8_t seqno;
+  int group;
+  int targets;
+  int live;
+  int pos;
+  int i, j, n;
+
+  while(dao_fwd_count > 0) {
+    memset(picked, 0, sizeof(picked));
+
+    instance = rpl_get_instance(dao_fwd_queue[0].instance_id);
+    parent = NULL;
+    parent_ipaddr = NULL;
+    if(instance != NULL && instance->current_dag != NULL) {
+      parent = instance->current_dag->preferred_parent;
+      parent_ipaddr = rpl_get_parent_ipaddr(parent);
+    }
+
+    if(parent_ipaddr == NULL) {
+      PRINTF("RPL: No parent to forward DAO targets to\n");
+      for(i = 0; i < dao_fwd_count; i++) {
+        picked[i] = dao_fwd_queue[i].instance_id == dao_fwd_queue[0].instance_id;
+      }
+    } else {
+      if(dao_fwd_queue[0].retransmit) {
+        /* keep the same seq-no as before for parent also */
+        seqno = dao_fwd_queue[0].seqno_out;
+      } else {
+        RPL_LOLLIPOP_INCREMENT(dao_sequence);
+        seqno = dao_sequence;
+      }
+      buffer = UIP_ICMP_PAYLOAD;
+      pos = dao_add_header(buffer, parent->dag, 0, seqno);
+      targets = 0;
+      live = 0;
+
+      for(i = 0; i < dao_fwd_count && targets < RPL_DAO_MAX_TARGETS; i++) {
+        if(picked[i] || !dao_fwd_match(&dao_fwd_queue[i], &dao_fwd_queue[0])) {
+          continue;
+        }
+        lifetime = dao_fwd_queue[i].lifetime;
+        group = 0;
+        for(j = i; j < dao_fwd_count && targets < RPL_DAO_MAX_TARGETS; j++) {
+          t = &dao_fwd_queue[j];
+          n = (t->prefixlen + 7) / CHAR_BIT;
+          if(picked[j] || !dao_fwd_match(t, &dao_fwd_queue[0]) ||
+             t->lifetime != lifetime || pos + 4 + n + 6 > DAO_MAX_LEN) {
+            continue;
+          }
+          pos = dao_add_target(buffer, pos, &t->prefix, t->prefixlen);
+          picked[j] = 1;
+          group++;
+          targets++;
+
+          /* Set DAO pending so that the DAO ACK finds its way back */
+          rep = uip_ds6_route_lookup(&t->prefix);
+          if(lifetime != RPL_ZERO_LIFETIME &&
+             rep != NULL && rep->length == t->prefixlen) {
+            rep->state.dao_seqno_out = seqno;
+            RPL_ROUTE_SET_DAO_PENDING(rep);
+          }
+        }
+        if(group > 0) {
+          pos = dao_add_transit(buffer, pos, parent, lifetime);
+          live |= lifetime != RPL_ZERO_LIFETIME;
+        }
+      }
+
+#if RPL_WITH_DAO_ACK
+      if(live) {
+        buffer[1] |= RPL_DAO_K_FLAG;
+      }
+#endif /* RPL_WITH_DAO_ACK */
+
+      PRINTF("RPL: Forwarding a DAO with %d targets and sequence number %u to ",
+             targets, seqno);
+      PRINT6ADDR(parent_ipaddr);
+      PRINTF("\n");
+
+      RPL_STAT(rpl_stats.dao_sent++);
+      RPL_STAT(rpl_stats.dao_bytes += pos);
+      RPL_TRACE(RPL_TRACE_DAO_OUT, NULL, 0, 0);
+      uip_icmp6_send(parent_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
+    }
+
+    /* Remove the targets sent (or dropped) */
+    for(i = 0, j = 0; i < dao_fwd_count; i++) {
+      if(!picked[i]) {
+        dao_fwd_queue[j++] = dao_fwd_queue[i];
+      }
+    }
+    dao_fwd_count = j;
+  }
+}
+#endif /* RPL_WITH_STORING */
+/*---------------------------------------------------------------------------*/
 static void
 dao_input_storing(void)
 {
@@ -654,12 +943,15 @@ dao_input_storing(void)
   int pos;
   int len;
   int i;
+  int j;
+  int group;
   int learned_from;
   rpl_parent_t *parent;
   uip_ds6_nbr_t *nbr;
   int is_root;
+  int should_ack;
+  uint8_t nack_status;
 
-  prefixlen = 0;
   parent = NULL;
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
@@ -723,171 +1015,159 @@ dao_input_storing(void)
     }
   }
 
-  /* Check if there are any RPL options present. */
-  for(i = pos; i < buffer_length; i += len) {
-    subopt_type = buffer[i];
-    if(subopt_type == RPL_OPTION_PAD1) {
-      len = 1;
-    } else {
-      /* The option consists of a two-byte header and a payload. */
-      len = 2 + buffer[i + 1];
-    }
-
-    switch(subopt_type) {
-    case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
-      break;
-    case RPL_OPTION_TRANSIT:
+  /* Unless a route is still on its way up, acknowledge the DAO now */
+  should_ack = (flags & RPL_DAO_K_FLAG) != 0;
+  nack_status = 0;
+
+  /* Check if there are any RPL options present. A transit option
+     applies to the targets before it, back to the previous transit
+     option. */
+  group = pos;
+  for(i = pos; i <= buffer_length; i += len) {
+    if(i < buffer_length) {
+      len = dao_option_len(buffer, i);
+      subopt_type = buffer[i];
+      if(subopt_type != RPL_OPTION_TRANSIT) {
+        continue;
+      }
       /* The path sequence and control are ignored. */
       /*      pathcontrol = buffer[i + 3];
               pathsequence = buffer[i + 4];*/
       lifetime = buffer[i + 5];
       /* The parent address is also ignored. */
-      break;
+    } else {
+      /* Targets not followed by a transit option take the last lifetime */
+      len = 1;
     }
-  }
-
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
 
-#if RPL_WITH_MULTICAST
-  if(uip_is_addr_mcast_global(&prefix)) {
-    mcast_group = uip_mcast6_route_add(&prefix);
-    if(mcast_group) {
-      mcast_group->dag = dag;
-      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
-    }
-    goto fwd_dao;
-  }
-#endif
+    for(j = group; j < i; j += dao_option_len(buffer, j)) {
+      if(buffer[j] != RPL_OPTION_TARGET ||
+         !dao_get_target(buffer, j, &prefix, &prefixlen)) {
+        continue;
+      }
 
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       !RPL_ROUTE_IS_NOPATH_RECEIVED(rep) &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
+      PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+          (unsigned)lifetime, (unsigned)prefixlen);
       PRINT6ADDR(&prefix);
       PRINTF("\n");
-      RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
-      rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
-
-      /* We forward the incoming No-Path DAO to our parent, if we have
-         one. */
-      if(dag->preferred_parent != NULL &&
-         rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-        uint8_t out_seq;
-        out_seq = prepare_for_dao_fwd(sequence, rep);
-
-        PRINTF("RPL: Forwarding No-path DAO to parent - out_seq:%d",
-	       out_seq);
-        PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-        PRINTF("\n");
 
-        buffer = UIP_ICMP_PAYLOAD;
-        buffer[3] = out_seq; /* add an outgoing seq no before fwd */
-        uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                       ICMP6_RPL, RPL_CODE_DAO, buffer_length);
+#if RPL_WITH_MULTICAST
+      if(uip_is_addr_mcast_global(&prefix)) {
+        mcast_group = uip_mcast6_route_add(&prefix);
+        if(mcast_group) {
+          mcast_group->dag = dag;
+          mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+        }
+        if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+          dao_fwd_add(instance, &prefix, prefixlen, lifetime, NULL, sequence);
+        }
+        continue;
       }
-    }
-    /* independent if we remove or not - ACK the request */
-    if(flags & RPL_DAO_K_FLAG) {
-      /* indicate that we accepted the no-path DAO */
-      uip_clear_buf();
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-                     RPL_DAO_ACK_UNCONDITIONAL_ACCEPT);
-    }
-    return;
-  }
-
-  PRINTF("RPL: Adding DAO route\n");
-
-  /* Update and add neighbor - if no room - fail. */
-  if((nbr = rpl_icmp6_update_nbr_table(&dao_sender_addr, NBR_TABLE_REASON_RPL_DAO, instance)) == NULL) {
-    PRINTF("RPL: Out of Memory, dropping DAO from ");
-    PRINT6ADDR(&dao_sender_addr);
-    PRINTF(", ");
-    PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    PRINTF("\n");
-    if(flags & RPL_DAO_K_FLAG) {
-      /* signal the failure to add the node */
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-		     is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
-		     RPL_DAO_ACK_UNABLE_TO_ACCEPT);
-    }
-    return;
-  }
-
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    if(flags & RPL_DAO_K_FLAG) {
-      /* signal the failure to add the node */
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-		     is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
-		     RPL_DAO_ACK_UNABLE_TO_ACCEPT);
-    }
-    return;
-  }
+#endif
 
-  /* set lifetime and clear NOPATH bit */
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
+      rep = uip_ds6_route_lookup(&prefix);
+
+      if(lifetime == RPL_ZERO_LIFETIME) {
+        PRINTF("RPL: No-Path DAO received\n");
+        /* No-Path DAO received; invoke the route purging routine. */
+        if(rep != NULL &&
+           !RPL_ROUTE_IS_NOPATH_RECEIVED(rep) &&
+           rep->length == prefixlen &&
+           uip_ds6_route_nexthop(rep) != NULL &&
+           uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
+          PRINTF("RPL: Setting expiration timer for prefix ");
+          PRINT6ADDR(&prefix);
+          PRINTF("\n");
+          RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
+          rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
+
+          /* We forward the incoming No-Path DAO to our parent, if we have
+             one. */
+          if(dag->preferred_parent != NULL &&
+             rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
+            rep->state.dao_seqno_in = sequence;
+            dao_fwd_add(instance, &prefix, prefixlen, lifetime, NULL, sequence);
+          }
+        }
+        /* independent if we remove or not - ACK the request */
+        continue;
+      }
 
-#if RPL_WITH_MULTICAST
-fwd_dao:
-#endif
+      PRINTF("RPL: Adding DAO route\n");
 
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    int should_ack = 0;
+      /* Update and add neighbor - if no room - fail. */
+      if((nbr = rpl_icmp6_update_nbr_table(&dao_sender_addr, NBR_TABLE_REASON_RPL_DAO, instance)) == NULL) {
+        PRINTF("RPL: Out of Memory, dropping DAO from ");
+        PRINT6ADDR(&dao_sender_addr);
+        PRINTF(", ");
+        PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+        PRINTF("\n");
+        /* signal the failure to add the node */
+        nack_status = is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+                      RPL_DAO_ACK_UNABLE_TO_ACCEPT;
+        break;
+      }
 
-    if(flags & RPL_DAO_K_FLAG) {
-      /*
-       * check if this route is already installed and we can ack now!
-       * not pending - and same seq-no means that we can ack.
-       * (e.g. the route is installed already so it will not take any
-       * more room that it already takes - so should be ok!)
-       */
-      if((!RPL_ROUTE_IS_DAO_PENDING(rep) &&
-          rep->state.dao_seqno_in == sequence) ||
-          dag->rank == ROOT_RANK(instance)) {
-        should_ack = 1;
+      rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
+      if(rep == NULL) {
+        RPL_STAT(rpl_stats.mem_overflows++);
+        PRINTF("RPL: Could not add a route after receiving a DAO\n");
+        /* signal the failure to add the node */
+        nack_status = is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+                      RPL_DAO_ACK_UNABLE_TO_ACCEPT;
+        continue;
       }
-    }
 
-    if(dag->preferred_parent != NULL &&
-       rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-      uint8_t out_seq = 0;
-      /* if this is pending and we get the same seq no it is a retrans */
-      if(RPL_ROUTE_IS_DAO_PENDING(rep) &&
-         rep->state.dao_seqno_in == sequence) {
-        /* keep the same seq-no as before for parent also */
-        out_seq = rep->state.dao_seqno_out;
+      if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+        /*
+         * check if this route is already installed and we can ack now!
+         * not pending - and same seq-no means that we can ack.
+         * (e.g. the route is installed already so it will not take any
+         * more room that it already takes - so should be ok!)
+         */
+        if(!((!RPL_ROUTE_IS_DAO_PENDING(rep) &&
+              rep->state.dao_seqno_in == sequence) ||
+             dag->rank == ROOT_RANK(instance))) {
+          should_ack = 0;
+        }
+
+        if(dag->preferred_parent != NULL &&
+           rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
+          dao_fwd_add(instance, &prefix, prefixlen, lifetime, rep, sequence);
+        }
       } else {
-        out_seq = prepare_for_dao_fwd(sequence, rep);
+        should_ack = 0;
       }
 
-      PRINTF("RPL: Forwarding DAO to parent ");
-      PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-      PRINTF(" in seq: %d out seq: %d\n", sequence, out_seq);
+      /* set lifetime and clear NOPATH bit */
+      rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+      RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
+    }
+    if(nack_status != 0) {
+      break;
+    }
+    group = i + len;
+  }
 
-      buffer = UIP_ICMP_PAYLOAD;
-      buffer[3] = out_seq; /* add an outgoing seq no before fwd */
-      uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                     ICMP6_RPL, RPL_CODE_DAO, buffer_length);
+  if(dao_fwd_count > 0) {
+#if RPL_DAO_AGGREGATION
+    /* Wait for more targets, unless a full DAO is ready */
+    if(dao_fwd_count >= RPL_DAO_MAX_TARGETS) {
+      ctimer_stop(&dao_fwd_timer);
+      dao_fwd_send(NULL);
+    } else if(ctimer_expired(&dao_fwd_timer)) {
+      ctimer_set(&dao_fwd_timer, RPL_DAO_AGGREGATION_DELAY, dao_fwd_send, NULL);
     }
-    if(should_ack) {
+#else /* RPL_DAO_AGGREGATION */
+    dao_fwd_send(NULL);
+#endif /* RPL_DAO_AGGREGATION */
+  }
+
+  if(flags & RPL_DAO_K_FLAG) {
+    if(nack_status != 0) {
+      uip_clear_buf();
+      dao_ack_output(instance, &dao_sender_addr, sequence, nack_status);
+    } else if(should_ack) {
       PRINTF("RPL: Sending DAO ACK\n");
       uip_clear_buf();
       dao_ack_output(instance, &dao_sender_addr, sequence,
@@ -917,8 +1197,9 @@ dao_input_nonstoring(void)
   int pos;
   int len;
   int i;
-
-  prefixlen = 0;
+  int j;
+  int group;
+  int should_ack;
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
   memset(&dao_parent_addr, 0, 16);
@@ -946,24 +1227,18 @@ dao_input_nonstoring(void)
     pos += 16;
   }
 
-  /* Check if there are any RPL options present. */
-  for(i = pos; i < buffer_length; i += len) {
-    subopt_type = buffer[i];
-    if(subopt_type == RPL_OPTION_PAD1) {
-      len = 1;
-    } else {
-      /* The option consists of a two-byte header and a payload. */
-      len = 2 + buffer[i + 1];
-    }
-
-    switch(subopt_type) {
-    case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
-      break;
-    case RPL_OPTION_TRANSIT:
+  /* Check if there are any RPL options present. A transit option
+     applies to the targets before it, back to the previous transit
+     option. */
+  should_ack = (flags & RPL_DAO_K_FLAG) != 0;
+  group = pos;
+  for(i = pos; i <= buffer_length; i += len) {
+    if(i < buffer_length) {
+      len = dao_option_len(buffer, i);
+      subopt_type = buffer[i];
+      if(subopt_type != RPL_OPTION_TRANSIT) {
+        continue;
+      }
       /* The path sequence and control are ignored. */
       /*      pathcontrol = buffer[i + 3];
               pathsequence = buffer[i + 4];*/
@@ -971,28 +1246,37 @@ dao_input_nonstoring(void)
       if(len >= 20) {
         memcpy(&dao_parent_addr, buffer + i + 6, 16);
       }
-      break;
+    } else {
+      /* Targets not followed by a transit option take the last lifetime */
+      len = 1;
     }
-  }
 
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF(", parent: ");
-  PRINT6ADDR(&dao_parent_addr);
-  PRINTF(" \n");
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    rpl_ns_expire_parent(dag, &prefix, &dao_parent_addr);
-  } else {
-    if(rpl_ns_update_node(dag, &prefix, &dao_parent_addr, RPL_LIFETIME(instance, lifetime)) == NULL) {
-      PRINTF("RPL: failed to add link\n");
-      return;
+    for(j = group; j < i; j += dao_option_len(buffer, j)) {
+      if(buffer[j] != RPL_OPTION_TARGET ||
+         !dao_get_target(buffer, j, &prefix, &prefixlen)) {
+        continue;
+      }
+
+      PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+              (unsigned)lifetime, (unsigned)prefixlen);
+      PRINT6ADDR(&prefix);
+      PRINTF(", parent: ");
+      PRINT6ADDR(&dao_parent_addr);
+      PRINTF(" \n");
+
+      if(lifetime == RPL_ZERO_LIFETIME) {
+        PRINTF("RPL: No-Path DAO received\n");
+        rpl_ns_expire_parent(dag, &prefix, &dao_parent_addr);
+      } else if(rpl_ns_update_node(dag, &prefix, &dao_parent_addr,
+                                   RPL_LIFETIME(instance, lifetime)) == NULL) {
+        PRINTF("RPL: failed to add link\n");
+        should_ack = 0;
+      }
     }
+    group = i + len;
   }
 
-  if(flags & RPL_DAO_K_FLAG) {
+  if(should_ack) {
     PRINTF("RPL: Sending DAO ACK\n");
     uip_clear_buf();
     dao_ack_output(instance, &dao_sender_addr, sequence,
@@ -1011,6 +1295,7 @@ dao_input(void)
   PRINTF("RPL: Received a DAO from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("\n");
+  RPL_TRACE(RPL_TRACE_DAO_IN, NULL, 0, 0);
 
   instance_id = UIP_ICMP_PAYLOAD[0];
   instance = rpl_get_instance(instance_id);
@@ -1035,7 +1320,8 @@ static void
 handle_dao_retransmission(void *ptr)
 {
   rpl_parent_t *parent;
-  uip_ipaddr_t prefix;
+  uip_ipaddr_t prefixes[DAO_OWN_TARGETS];
+  int count;
   rpl_instance_t *instance;
 
   parent = ptr;
@@ -1070,7 +1356,8 @@ handle_dao_retransmission(void *ptr)
   PRINTF("RPL: will retransmit DAO - seq:%d trans:%d\n", instance->my_dao_seqno,
 	 instance->my_dao_transmissions);
 
-  if(get_global_addr(&prefix) == 0) {
+  count = get_global_addrs(prefixes, DAO_OWN_TARGETS);
+  if(count == 0) {
     return;
   }
 
@@ -1080,8 +1367,8 @@ handle_dao_retransmission(void *ptr)
 	     handle_dao_retransmission, parent);
 
   instance->my_dao_transmissions++;
-  dao_output_target_seq(parent, &prefix,
-			instance->default_lifetime, instance->my_dao_seqno);
+  dao_output_targets(parent, prefixes, count,
+                     instance->default_lifetime, instance->my_dao_seqno);
 }
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
@@ -1089,9 +1376,11 @@ void
 dao_output(rpl_parent_t *parent, uint8_t lifetime)
 {
   /* Destination Advertisement Object */
-  uip_ipaddr_t prefix;
+  uip_ipaddr_t prefixes[DAO_OWN_TARGETS];
+  int count;
 
-  if(get_global_addr(&prefix) == 0) {
+  count = get_global_addrs(prefixes, DAO_OWN_TARGETS);
+  if(count == 0) {
     PRINTF("RPL: No global address set for this node - suppressing DAO\n");
     return;
   }
@@ -1103,7 +1392,7 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
   RPL_LOLLIPOP_INCREMENT(dao_sequence);
 #if RPL_WITH_DAO_ACK
   /* set up the state since this will be the first transmission of DAO */
-  /* retransmissions will call directly to dao_output_target_seq */
+  /* retransmissions will call directly to dao_output_targets */
   /* keep track of my own sending of DAO for handling ack and loss of ack */
   if(lifetime != RPL_ZERO_LIFETIME) {
     rpl_instance_t *instance;
@@ -1120,25 +1409,29 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
   parent->dag->instance->has_downward_route = lifetime != RPL_ZERO_LIFETIME;
 #endif /* RPL_WITH_DAO_ACK */
 
-  /* Sending a DAO with own prefix as target */
-  dao_output_target(parent, &prefix, lifetime);
+  /* Sending a DAO with own addresses as targets */
+  dao_output_targets(parent, prefixes, count, lifetime, dao_sequence);
 }
 /*---------------------------------------------------------------------------*/
 void
 dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
 {
-  dao_output_target_seq(parent, prefix, lifetime, dao_sequence);
+  if(prefix == NULL) {
+    PRINTF("RPL dao_output_target error prefix NULL\n");
+    return;
+  }
+  dao_output_targets(parent, prefix, 1, lifetime, dao_sequence);
 }
 /*---------------------------------------------------------------------------*/
 static void
-dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
-		      uint8_t lifetime, uint8_t seq_no)
+dao_output_targets(rpl_parent_t *parent, const uip_ipaddr_t *prefixes,
+                   int count, uint8_t lifetime, uint8_t seq_no)
 {
   rpl_dag_t *dag;
   rpl_instance_t *instance;
   unsigned char *buffer;
-  uint8_t prefixlen;
   int pos;
+  int i;
   uip_ipaddr_t *parent_ipaddr = NULL;
   uip_ipaddr_t *dest_ipaddr = NULL;
 
@@ -1172,7 +1465,7 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
     PRINTF("RPL dao_output_target error instance NULL\n");
     return;
   }
-  if(prefix == NULL) {
+  if(prefixes == NULL || count <= 0) {
     PRINTF("RPL dao_output_target error prefix NULL\n");
     return;
   }
@@ -1181,60 +1474,29 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
 #endif
 
   buffer = UIP_ICMP_PAYLOAD;
-  pos = 0;
+  pos = dao_add_header(buffer, dag, lifetime != RPL_ZERO_LIFETIME, seq_no);
 
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
-#if RPL_WITH_DAO_ACK
-  if(lifetime != RPL_ZERO_LIFETIME) {
-    buffer[pos] |= RPL_DAO_K_FLAG;
+  /* create target subopts, all sharing one transit */
+  for(i = 0; i < count; i++) {
+    pos = dao_add_target(buffer, pos, &prefixes[i],
+                         sizeof(prefixes[i]) * CHAR_BIT);
   }
-#endif /* RPL_WITH_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = seq_no;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos+=sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
-
-  /* create target subopt */
-  prefixlen = sizeof(*prefix) * CHAR_BIT;
-  buffer[pos++] = RPL_OPTION_TARGET;
-  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = prefixlen;
-  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
-  pos += ((prefixlen + 7) / CHAR_BIT);
 
   /* Create a transit information sub-option. */
-  buffer[pos++] = RPL_OPTION_TRANSIT;
-  buffer[pos++] = (instance->mop != RPL_MOP_NON_STORING) ? 4 : 20;
-  buffer[pos++] = 0; /* flags - ignored */
-  buffer[pos++] = 0; /* path control - ignored */
-  buffer[pos++] = 0; /* path seq - ignored */
-  buffer[pos++] = lifetime;
+  pos = dao_add_transit(buffer, pos, parent, lifetime);
 
   if(instance->mop != RPL_MOP_NON_STORING) {
     /* Send DAO to parent */
     dest_ipaddr = parent_ipaddr;
   } else {
-    /* Include parent global IP address */
-    memcpy(buffer + pos, &parent->dag->dag_id, 8); /* Prefix */
-    pos += 8;
-    memcpy(buffer + pos, ((const unsigned char *)parent_ipaddr) + 8, 8); /* Interface identifier */
-    pos += 8;
     /* Send DAO to root */
     dest_ipaddr = &parent->dag->dag_id;
   }
 
-  PRINTF("RPL: Sending a %sDAO with sequence number %u, lifetime %u, prefix ",
-      lifetime == RPL_ZERO_LIFETIME ? "No-Path " : "", seq_no, lifetime);
+  PRINTF("RPL: Sending a %sDAO with sequence number %u, lifetime %u, %d targets, prefix ",
+      lifetime == RPL_ZERO_LIFETIME ? "No-Path " : "", seq_no, lifetime, count);
 
-  PRINT6ADDR(prefix);
+  PRINT6ADDR(&prefixes[0]);
   PRINTF(" to ");
   PRINT6ADDR(dest_ipaddr);
   PRINTF(" , parent ");
@@ -1242,6 +1504,9 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
   PRINTF("\n");
 
   if(dest_ipaddr != NULL) {
+    RPL_STAT(rpl_stats.dao_sent++);
+    RPL_STAT(rpl_stats.dao_bytes += pos);
+    RPL_TRACE(RPL_TRACE_DAO_OUT, NULL, 0, 0);
     uip_icmp6_send(dest_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
   }
 }
@@ -1289,6 +1554,10 @@ dao_ack_input(void)
 
   if(sequence == instance->my_dao_seqno) {
     instance->has_downward_route = status < 128;
+    RPL_TRACE(status < 128 ? RPL_TRACE_DAO_ACK : RPL_TRACE_DAO_NACK,
+              &UIP_IP_BUF->srcipaddr,
+              instance->current_dag != NULL ? instance->current_dag->rank :
+              INFINITE_RANK, status);
 
     /* always stop the retransmit timer when the ACK arrived */
     ctimer_stop(&instance->dao_retransmit_timer);
@@ -1311,29 +1580,47 @@ dao_ack_input(void)
   } else if(RPL_IS_STORING(instance)) {
     /* this DAO ACK should be forwarded to another recently registered route */
     uip_ds6_route_t *re;
+    uip_ds6_route_t *r;
+    uip_ds6_route_t *next;
     uip_ipaddr_t *nexthop;
-    if((re = find_route_entry_by_dao_ack(sequence)) != NULL) {
+    if((re = find_route_entry_by_dao_ack(sequence)) == NULL) {
+      PRINTF("RPL: No route entry found to forward DAO ACK (seqno %u)\n", sequence);
+    }
+    /* An aggregated DAO carries targets from several DAOs. Each of them
+       gets one DAO ACK, covering all of its routes. */
+    while(re != NULL) {
       /* pick the recorded seq no from that node and forward DAO ACK - and
          clear the pending flag*/
       RPL_ROUTE_CLEAR_DAO_PENDING(re);
 
       nexthop = uip_ds6_route_nexthop(re);
+      for(r = uip_ds6_route_head(); r != NULL; r = next) {
+        next = uip_ds6_route_next(r);
+        if(r != re && RPL_ROUTE_IS_DAO_PENDING(r) &&
+           r->state.dao_seqno_out == sequence &&
+           r->state.dao_seqno_in == re->state.dao_seqno_in &&
+           uip_ds6_route_nexthop(r) == nexthop) {
+          RPL_ROUTE_CLEAR_DAO_PENDING(r);
+          if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT) {
+            uip_ds6_route_rm(r);
+          }
+        }
+      }
+
       if(nexthop == NULL) {
         PRINTF("RPL: No next hop to fwd DAO ACK to\n");
       } else {
         PRINTF("RPL: Fwd DAO ACK to:");
         PRINT6ADDR(nexthop);
         PRINTF("\n");
-        buffer[2] = re->state.dao_seqno_in;
-        uip_icmp6_send(nexthop, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
+        dao_ack_output(instance, nexthop, re->state.dao_seqno_in, status);
       }
 
       if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT) {
         /* this node did not get in to the routing tables above... - remove */
         uip_ds6_route_rm(re);
       }
-    } else {
-      PRINTF("RPL: No route entry found to forward DAO ACK (seqno %u)\n", sequence);
+      re = find_route_entry_by_dao_ack(sequence);
     }
   }
 #endif /* RPL_WITH_DAO_ACK */
@@ -1358,6 +1645,7 @@ dao_ack_output(rpl_instance_t *instance, uip_ipaddr_t *dest, uint8_t sequence,
   buffer[2] = sequence;
   buffer[3] = status;
 
+  RPL_TRACE(RPL_TRACE_DAO_ACK_OUT, NULL, 0, 0);
   uip_icmp6_send(dest, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
 #endif /* RPL_WITH_DAO_ACK */
 }
@@ -46,6 +46,7 @@
 #include "net/rpl/rpl-private.h"
 #include "net/rpl/rpl-ns.h"
 #include "lib/list.h"
+#include "lib/dlist.h"
 #include "lib/memb.h"
 
 #if RPL_WITH_NON_STORING
@@ -63,6 +64,16 @@ static int num_nodes;
 LIST(nodelist);
 MEMB(nodememb, rpl_ns_node_t, RPL_NS_LINK_NUM);
 
+#if RPL_NS_HASH_SIZE
+/* Nodes are also chained in hash buckets through their hash_next field */
+static rpl_ns_node_t *node_hash[RPL_NS_HASH_SIZE];
+#endif /* RPL_NS_HASH_SIZE */
+
+#if RPL_NS_SRH_CACHE_SIZE
+DLIST(srhcache);
+MEMB(srhmemb, rpl_ns_srh_t, RPL_NS_SRH_CACHE_SIZE);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
 /*---------------------------------------------------------------------------*/
 int
 rpl_ns_num_nodes(void)
@@ -81,11 +92,54 @@ node_matches_address(const rpl_dag_t *dag, const rpl_ns_node_t *node, const uip_
       && !memcmp(((const unsigned char *)addr) + 8, node->link_identifier, 8);
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_NS_HASH_SIZE
+static rpl_ns_node_t **
+hash_bucket(const unsigned char *link_identifier)
+{
+  uint16_t h = 0;
+  int i;
+
+  for(i = 0; i < 8; i++) {
+    h = (h << 5) + h + link_identifier[i];
+  }
+  return &node_hash[h % RPL_NS_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t **p = hash_bucket(node->link_identifier);
+
+  node->hash_next = *p;
+  *p = node;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t **p;
+
+  for(p = hash_bucket(node->link_identifier); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == node) {
+      *p = node->hash_next;
+      return;
+    }
+  }
+}
+#endif /* RPL_NS_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
 rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
 {
   rpl_ns_node_t *l;
+#if RPL_NS_HASH_SIZE
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(l = *hash_bucket(((const unsigned char *)addr) + 8); l != NULL; l = l->hash_next) {
+#else /* RPL_NS_HASH_SIZE */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+#endif /* RPL_NS_HASH_SIZE */
     /* Compare prefix and node identifier */
     if(node_matches_address(dag, l, addr)) {
       return l;
@@ -94,6 +148,88 @@ rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_NS_SRH_CACHE_SIZE
+static void
+srh_remove(rpl_ns_srh_t *srh)
+{
+  srh->dest->srh = NULL;
+  dlist_remove(srhcache, srh);
+  memb_free(&srhmemb, srh);
+}
+/*---------------------------------------------------------------------------*/
+/* Drops the cached routes whose path includes node, i.e. the routes to
+   node and to all nodes below it. Called when node changes parent or
+   is removed. */
+static void
+srh_invalidate(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t *n = node;
+  /* Bound the walk in case unreachable nodes form a loop */
+  int max_steps = 2 * RPL_NS_LINK_NUM;
+
+  /* Depth-first walk of the subtree, going up through parent links */
+  while(max_steps-- > 0) {
+    if(n->srh != NULL) {
+      srh_remove(n->srh);
+    }
+    if(n->first_child != NULL) {
+      n = n->first_child;
+      continue;
+    }
+    while(n != node && n->next_sibling == NULL && max_steps-- > 0) {
+      n = n->parent;
+    }
+    if(n == node) {
+      return;
+    }
+    n = n->next_sibling;
+  }
+}
+/*---------------------------------------------------------------------------*/
+const rpl_ns_srh_t *
+rpl_ns_srh_lookup(rpl_ns_node_t *dest)
+{
+  rpl_ns_srh_t *srh = dest->srh;
+
+  if(srh != NULL && srh != dlist_head(srhcache)) {
+    dlist_remove(srhcache, srh);
+    dlist_push(srhcache, srh);
+  }
+  return srh;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_srh_store(rpl_ns_node_t *dest, rpl_ns_node_t *first_hop,
+                 uint8_t path_len, uint8_t cmpr, const uint8_t *addresses)
+{
+  rpl_ns_srh_t *srh;
+  int len = path_len * (16 - cmpr);
+
+  if(len > sizeof(srh->addresses)) {
+    return;
+  }
+
+  srh = dest->srh;
+  if(srh == NULL) {
+    srh = memb_alloc(&srhmemb);
+    if(srh == NULL) {
+      /* Replace the least recently used route */
+      srh = dlist_tail(srhcache);
+      srh_remove(srh);
+      srh = memb_alloc(&srhmemb);
+    }
+    srh->dest = dest;
+    dest->srh = srh;
+    dlist_push(srhcache, srh);
+  }
+
+  srh->first_hop = first_hop;
+  srh->path_len = path_len;
+  srh->cmpr = cmpr;
+  memcpy(srh->addresses, addresses, len);
+}
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 int
 rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
 {
@@ -107,6 +243,32 @@ rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
   return node != NULL && node == root_node;
 }
 /*---------------------------------------------------------------------------*/
+static void
+set_parent(rpl_ns_node_t *node, rpl_ns_node_t *parent)
+{
+#if RPL_NS_SRH_CACHE_SIZE
+  rpl_ns_node_t **p;
+
+  if(node->parent == parent) {
+    return;
+  }
+  /* Keep the lists of children up to date */
+  if(node->parent != NULL) {
+    for(p = &node->parent->first_child; *p != NULL; p = &(*p)->next_sibling) {
+      if(*p == node) {
+        *p = node->next_sibling;
+        break;
+      }
+    }
+  }
+  if(parent != NULL) {
+    node->next_sibling = parent->first_child;
+    parent->first_child = node;
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+  node->parent = parent;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t *parent)
 {
@@ -114,6 +276,10 @@ rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr
   /* Check if parent matches */
   if(l != NULL && node_matches_address(dag, l->parent, parent)) {
     l->lifetime = RPL_NOPATH_REMOVAL_DELAY;
+#if RPL_NS_SRH_CACHE_SIZE
+    /* The child no longer uses this parent */
+    srh_invalidate(l);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -123,6 +289,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
   rpl_ns_node_t *child_node = rpl_ns_get_node(dag, child);
   rpl_ns_node_t *parent_node = rpl_ns_get_node(dag, parent);
   rpl_ns_node_t *old_parent_node;
+#if RPL_NS_SRH_CACHE_SIZE
+  rpl_ns_node_t *prev_parent_node;
+  rpl_dag_t *prev_dag;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -142,31 +312,50 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
       return NULL;
     }
     child_node->parent = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+#if RPL_NS_SRH_CACHE_SIZE
+    child_node->first_child = NULL;
+    child_node->next_sibling = NULL;
+    child_node->srh = NULL;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+#if RPL_NS_HASH_SIZE
+    hash_add(child_node);
+#endif /* RPL_NS_HASH_SIZE */
     list_add(nodelist, child_node);
     num_nodes++;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  prev_parent_node = child_node->parent;
+  prev_dag = child_node->dag;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
   /* Initialize node */
   child_node->dag = dag;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
   /* Is the node reachable before the update? */
   if(rpl_ns_is_node_reachable(dag, child)) {
     old_parent_node = child_node->parent;
     /* Update node */
-    child_node->parent = parent_node;
+    set_parent(child_node, parent_node);
     /* Has the node become unreachable? May happen if we create a loop. */
     if(!rpl_ns_is_node_reachable(dag, child)) {
       /* The new parent makes the node unreachable, restore old parent.
        * We will take the update next time, with chances we know more of
        * the topology and the loop is gone. */
-      child_node->parent = old_parent_node;
+      set_parent(child_node, old_parent_node);
     }
   } else {
-    child_node->parent = parent_node;
+    set_parent(child_node, parent_node);
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  if(child_node->parent != prev_parent_node || child_node->dag != prev_dag) {
+    srh_invalidate(child_node);
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
   return child_node;
 }
 /*---------------------------------------------------------------------------*/
@@ -176,6 +365,13 @@ rpl_ns_init(void)
   num_nodes = 0;
   memb_init(&nodememb);
   list_init(nodelist);
+#if RPL_NS_HASH_SIZE
+  memset(node_hash, 0, sizeof(node_hash));
+#endif /* RPL_NS_HASH_SIZE */
+#if RPL_NS_SRH_CACHE_SIZE
+  memb_init(&srhmemb);
+  dlist_init(srhcache);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
@@ -203,6 +399,7 @@ void
 rpl_ns_periodic(void)
 {
   rpl_ns_node_t *l;
+  rpl_ns_node_t *next;
   /* First pass, decrement lifetime for all nodes with non-infinite lifetime */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Don't touch infinite lifetime nodes */
@@ -211,7 +408,8 @@ rpl_ns_periodic(void)
     }
   }
   /* Second pass, for all expire nodes, deallocate them iff no child points to them */
-  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+  for(l = list_head(nodelist); l != NULL; l = next) {
+    next = list_item_next(l);
     if(l->lifetime == 0) {
       rpl_ns_node_t *l2;
       for(l2 = list_head(nodelist); l2 != NULL; l2 = list_item_next(l2)) {
@@ -219,10 +417,19 @@ rpl_ns_periodic(void)
           break;
         }
       }
-      /* No child found, deallocate node */
-      list_remove(nodelist, l);
-      memb_free(&nodememb, l);
-      num_nodes--;
+      if(l2 == NULL) {
+        /* No child found, deallocate node */
+#if RPL_NS_SRH_CACHE_SIZE
+        srh_invalidate(l);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+        set_parent(l, NULL);
+#if RPL_NS_HASH_SIZE
+        hash_remove(l);
+#endif /* RPL_NS_HASH_SIZE */
+        list_remove(nodelist, l);
+        memb_free(&nodememb, l);
+        num_nodes--;
+      }
     }
   }
 }
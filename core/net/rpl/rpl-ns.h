@@ -49,6 +49,31 @@
 #define RPL_NS_LINK_NUM 32
 #endif /* RPL_NS_CONF_LINK_NUM */
 
+/* Number of buckets in the hash index of nodes, keyed on the link
+   identifier. With 0, rpl_ns_get_node() scans the whole node list. */
+#ifdef RPL_NS_CONF_HASH_SIZE
+#define RPL_NS_HASH_SIZE RPL_NS_CONF_HASH_SIZE
+#else /* RPL_NS_CONF_HASH_SIZE */
+#define RPL_NS_HASH_SIZE RPL_NS_LINK_NUM
+#endif /* RPL_NS_CONF_HASH_SIZE */
+
+/* Number of source routes kept in compiled form at the root, for the
+   most recently used destinations. A cached route is dropped as soon
+   as a node on its path changes parent or is removed. 0 disables the
+   cache. */
+#ifdef RPL_NS_CONF_SRH_CACHE_SIZE
+#define RPL_NS_SRH_CACHE_SIZE RPL_NS_CONF_SRH_CACHE_SIZE
+#else /* RPL_NS_CONF_SRH_CACHE_SIZE */
+#define RPL_NS_SRH_CACHE_SIZE 0
+#endif /* RPL_NS_CONF_SRH_CACHE_SIZE */
+
+/* Longest source route, in addresses, that fits in the cache */
+#ifdef RPL_NS_CONF_SRH_CACHE_HOPS
+#define RPL_NS_SRH_CACHE_HOPS RPL_NS_CONF_SRH_CACHE_HOPS
+#else /* RPL_NS_CONF_SRH_CACHE_HOPS */
+#define RPL_NS_SRH_CACHE_HOPS 16
+#endif /* RPL_NS_CONF_SRH_CACHE_HOPS */
+
 typedef struct rpl_ns_node {
   struct rpl_ns_node *next;
   uint32_t lifetime;
@@ -56,8 +81,44 @@ typedef struct rpl_ns_node {
   /* Store only IPv6 link identifiers as all nodes in the DAG share the same prefix */
   unsigned char link_identifier[8];
   struct rpl_ns_node *parent;
+#if RPL_NS_HASH_SIZE
+  /* The next node in the same hash bucket */
+  struct rpl_ns_node *hash_next;
+#endif /* RPL_NS_HASH_SIZE */
+#if RPL_NS_SRH_CACHE_SIZE
+  /* The children of a node are linked through next_sibling, so that
+     the cached routes below a node can be found when it moves */
+  struct rpl_ns_node *first_child;
+  struct rpl_ns_node *next_sibling;
+  /* The cached source route to this node, if any */
+  struct rpl_ns_srh *srh;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
 } rpl_ns_node_t;
 
+#if RPL_NS_SRH_CACHE_SIZE
+/* A source route in the form it takes in the RPL Source Routing
+   Header (RFC 6554), with ComprI == ComprE */
+typedef struct rpl_ns_srh {
+  /* The cache is a doubly linked list (see lib/dlist.h), most
+     recently used first */
+  struct rpl_ns_srh *next;
+  struct rpl_ns_srh *prev;
+  struct dlist *list;
+  rpl_ns_node_t *dest;
+  /* The first hop, i.e. the node on the path whose parent is the root */
+  rpl_ns_node_t *first_hop;
+  uint8_t path_len;
+  uint8_t cmpr;
+  /* path_len addresses, each stripped of its first cmpr bytes */
+  uint8_t addresses[RPL_NS_SRH_CACHE_HOPS * 8];
+} rpl_ns_srh_t;
+
+const rpl_ns_srh_t *rpl_ns_srh_lookup(rpl_ns_node_t *dest);
+void rpl_ns_srh_store(rpl_ns_node_t *dest, rpl_ns_node_t *first_hop,
+                      uint8_t path_len, uint8_t cmpr,
+                      const uint8_t *addresses);
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
 int rpl_ns_num_nodes(void);
 void rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t *parent);
 rpl_ns_node_t *rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t *parent, uint32_t lifetime);
@@ -46,6 +46,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-ds6-route.h"
 #include "net/rpl/rpl-ns.h"
+#include "net/rpl/rpl-trace.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
 /*---------------------------------------------------------------------------*/
@@ -318,6 +319,9 @@ struct rpl_stats {
   uint16_t loop_errors;
   uint16_t loop_warnings;
   uint16_t root_repairs;
+  uint16_t dao_sent;
+  uint16_t dao_fwd_drops;
+  uint32_t dao_bytes;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -333,6 +337,12 @@ extern rpl_stats_t rpl_stats;
 #else
 #define RPL_STAT(code)
 #endif /* RPL_CONF_STATS */
+
+#if RPL_WITH_TRACE
+#define RPL_TRACE(event, addr, rank, arg) rpl_trace_event(event, addr, rank, arg)
+#else
+#define RPL_TRACE(event, addr, rank, arg)
+#endif /* RPL_WITH_TRACE */
 /*---------------------------------------------------------------------------*/
 /* Instances */
 extern rpl_instance_t instance_table[];
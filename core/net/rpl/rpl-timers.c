@@ -221,6 +221,9 @@ rpl_reset_dio_timer(rpl_instance_t *instance)
     instance->dio_counter = 0;
     instance->dio_intcurrent = instance->dio_intmin;
     new_dio_interval(instance);
+    RPL_TRACE(RPL_TRACE_TRICKLE_RESET, NULL,
+              instance->current_dag != NULL ? instance->current_dag->rank :
+              INFINITE_RANK, 0);
   }
 #if RPL_CONF_STATS
   rpl_stats.resets++;
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         RPL event trace.
+ */
+
+#include "contiki.h"
+#include "net/rpl/rpl-trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if RPL_WITH_TRACE
+
+static struct rpl_trace_entry ring[RPL_TRACE_SIZE];
+static uint16_t head;       /* Slot of the next entry */
+static uint16_t filled;     /* Entries in use */
+static uint16_t next_seqno;
+static uint16_t counts[RPL_TRACE_EVENT_NUM];
+
+static const char *const names[RPL_TRACE_EVENT_NUM] = {
+  "dis-in", "dis-out", "dio-in", "dio-out", "dao-in", "dao-out",
+  "dao-ack-out", "join", "parent", "rank", "dao-ack", "dao-nack",
+  "local-repair", "global-repair", "trickle-reset"
+};
+/*---------------------------------------------------------------------------*/
+void
+rpl_trace_event(uint8_t event, const uip_ipaddr_t *addr, rpl_rank_t rank,
+                uint8_t arg)
+{
+  struct rpl_trace_entry *e;
+
+  if(event >= RPL_TRACE_EVENT_NUM) {
+    return;
+  }
+  counts[event]++;
+  if(event < RPL_TRACE_FIRST_RECORDED) {
+    return;
+  }
+
+  e = &ring[head];
+  head = (head + 1) % RPL_TRACE_SIZE;
+  if(filled < RPL_TRACE_SIZE) {
+    filled++;
+  }
+  e->time = clock_time();
+  e->seqno = next_seqno++;
+  e->rank = rank;
+  e->event = event;
+  e->arg = arg;
+  if(addr != NULL) {
+    e->addr[0] = addr->u8[14];
+    e->addr[1] = addr->u8[15];
+  } else {
+    e->addr[0] = e->addr[1] = 0;
+  }
+
+#if RPL_TRACE_PRINT
+  printf("RPL trace %u %lu %s %02x%02x %u %u\n", e->seqno,
+         (unsigned long)e->time, names[event], e->addr[0], e->addr[1],
+         e->rank, e->arg);
+#endif /* RPL_TRACE_PRINT */
+}
+/*---------------------------------------------------------------------------*/
+const struct rpl_trace_entry *
+rpl_trace_get(uint16_t seqno)
+{
+  uint16_t age;
+
+  /* Sequence numbers wrap, so work with the distance from the newest */
+  age = next_seqno - seqno;
+  if(age == 0 || age > filled) {
+    return NULL;
+  }
+  return &ring[(head + RPL_TRACE_SIZE - age) % RPL_TRACE_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rpl_trace_first(void)
+{
+  return next_seqno - filled;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rpl_trace_next(void)
+{
+  return next_seqno;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rpl_trace_count(uint8_t event)
+{
+  return event < RPL_TRACE_EVENT_NUM ? counts[event] : 0;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+rpl_trace_event_name(uint8_t event)
+{
+  return event < RPL_TRACE_EVENT_NUM ? names[event] : "unknown";
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_trace_reset(void)
+{
+  head = 0;
+  filled = 0;
+  next_seqno = 0;
+  memset(counts, 0, sizeof(counts));
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_TRACE */
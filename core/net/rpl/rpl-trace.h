@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         RPL event trace: a ring of timestamped control-plane events,
+ *         and counters of all RPL messages sent and received.
+ *
+ *         The ring keeps the last RPL_TRACE_SIZE events. Each event
+ *         gets a sequence number, so that a reader can tell how many
+ *         events were overwritten since it last looked.
+ */
+
+#ifndef RPL_TRACE_H
+#define RPL_TRACE_H
+
+#include "net/rpl/rpl.h"
+#include "net/ip/uip.h"
+#include "sys/clock.h"
+
+enum {
+  /* Only counted */
+  RPL_TRACE_DIS_IN,
+  RPL_TRACE_DIS_OUT,
+  RPL_TRACE_DIO_IN,
+  RPL_TRACE_DIO_OUT,
+  RPL_TRACE_DAO_IN,
+  RPL_TRACE_DAO_OUT,
+  RPL_TRACE_DAO_ACK_OUT,
+  /* Counted and recorded in the ring */
+  RPL_TRACE_JOIN,           /* Joined or created a DAG; addr is the
+                               DAG ID, arg the DAG version */
+  RPL_TRACE_PARENT,         /* Preferred parent changed; addr is the
+                               new parent and rank its rank, or both
+                               are unset if there is no parent */
+  RPL_TRACE_RANK,           /* Our rank changed */
+  RPL_TRACE_DAO_ACK,        /* DAO ACK received for our own DAO; arg is
+                               the status */
+  RPL_TRACE_DAO_NACK,       /* DAO NACK received for our own DAO */
+  RPL_TRACE_LOCAL_REPAIR,
+  RPL_TRACE_GLOBAL_REPAIR,  /* arg is the new DAG version */
+  RPL_TRACE_TRICKLE_RESET,  /* DIO timer back at the minimum interval */
+  RPL_TRACE_EVENT_NUM
+};
+
+#define RPL_TRACE_FIRST_RECORDED RPL_TRACE_JOIN
+
+struct rpl_trace_entry {
+  clock_time_t time;
+  uint16_t seqno;
+  rpl_rank_t rank;          /* Our rank after the event, unless noted */
+  uint8_t event;
+  uint8_t arg;
+  uint8_t addr[2];          /* Last two bytes of the related address */
+};
+
+/* Records an event. Events before RPL_TRACE_FIRST_RECORDED are only
+   counted. addr may be NULL. */
+void rpl_trace_event(uint8_t event, const uip_ipaddr_t *addr,
+                     rpl_rank_t rank, uint8_t arg);
+
+/* Returns the entry with sequence number seqno, or NULL if it has not
+   been recorded yet or has already been overwritten. */
+const struct rpl_trace_entry *rpl_trace_get(uint16_t seqno);
+
+/* Returns the sequence number of the oldest entry in the ring */
+uint16_t rpl_trace_first(void);
+
+/* Returns the sequence number the next event will get */
+uint16_t rpl_trace_next(void);
+
+/* Returns how many times an event has happened */
+uint16_t rpl_trace_count(uint8_t event);
+
+const char *rpl_trace_event_name(uint8_t event);
+
+/* Clears the ring and the counters */
+void rpl_trace_reset(void);
+
+#endif /* RPL_TRACE_H */
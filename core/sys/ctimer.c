@@ -46,10 +46,21 @@
 #include "contiki.h"
 #include "lib/list.h"
 
+/* Pending callback timers, sorted by expiration time. Timers with the
+   same expiration time are kept in the order they were set. */
 LIST(ctimer_list);
+/* Expired callback timers whose callbacks have not been called yet. */
+LIST(expired_list);
+
+/* Expires with the first callback timer on ctimer_list. */
+static struct etimer timer;
 
 static char initialized;
 
+#if CTIMER_STATS
+struct ctimer_stats ctimer_stats;
+#endif /* CTIMER_STATS */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -58,31 +69,130 @@ static char initialized;
 #define PRINTF(...)
 #endif
 
-/*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
-PROCESS_THREAD(ctimer_process, ev, data)
+/*---------------------------------------------------------------------------*/
+/* The number of clock ticks left until c expires, zero if it has. */
+static clock_time_t
+remaining(struct ctimer *c, clock_time_t now)
+{
+  clock_time_t elapsed;
+
+  elapsed = now - c->etimer.timer.start;
+  if(elapsed >= c->etimer.timer.interval) {
+    return 0;
+  }
+  return c->etimer.timer.interval - elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_timer(void)
 {
   struct ctimer *c;
-  PROCESS_BEGIN();
 
-  for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-    etimer_set(&c->etimer, c->etimer.timer.interval);
+  if(!initialized) {
+    return;
+  }
+  c = list_head(ctimer_list);
+  PROCESS_CONTEXT_BEGIN(&ctimer_process);
+  if(c == NULL) {
+    etimer_stop(&timer);
+  } else {
+    etimer_set(&timer, remaining(c, clock_time()));
+  }
+  PROCESS_CONTEXT_END(&ctimer_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert(struct ctimer *c)
+{
+  struct ctimer *prev, *t;
+  clock_time_t now, left;
+
+  list_remove(ctimer_list, c);
+  list_remove(expired_list, c);
+
+  now = clock_time();
+  left = remaining(c, now);
+  prev = NULL;
+  for(t = list_head(ctimer_list);
+      t != NULL && remaining(t, now) <= left;
+      t = t->next) {
+    prev = t;
+  }
+  list_insert(ctimer_list, prev, c);
+  c->etimer.p = &ctimer_process;
+
+  /* The event timer only needs to be moved if c is the new first
+     timer. A timer that is stopped leaves it as it is, which at
+     worst causes a pass with nothing to do. */
+  if(prev == NULL) {
+    update_timer();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+call_expired(void)
+{
+  struct ctimer *c;
+  struct process *p;
+  clock_time_t now;
+#if CTIMER_STATS
+  clock_time_t late;
+#endif /* CTIMER_STATS */
+
+  now = clock_time();
+  while((c = list_head(ctimer_list)) != NULL && remaining(c, now) == 0) {
+    list_remove(ctimer_list, c);
+    list_add(expired_list, c);
+  }
+  if(list_head(expired_list) == NULL) {
+    return;
+  }
+#if CTIMER_STATS
+  ctimer_stats.passes++;
+#endif /* CTIMER_STATS */
+
+  /* Call the callbacks of one process after the other, in the order
+     their timers expired. A callback may set or stop any timer,
+     including those on the expired list, so the list is searched
+     from the start after each callback. */
+  while((c = list_head(expired_list)) != NULL) {
+    p = c->p;
+#if CTIMER_STATS
+    ctimer_stats.contexts++;
+#endif /* CTIMER_STATS */
+    PROCESS_CONTEXT_BEGIN(p);
+    while(c != NULL) {
+      list_remove(expired_list, c);
+      c->etimer.p = PROCESS_NONE;
+#if CTIMER_STATS
+      late = clock_time() - c->etimer.timer.start - c->etimer.timer.interval;
+      ctimer_stats.callbacks++;
+      ctimer_stats.lateness_sum += late;
+      if(late > ctimer_stats.lateness_max) {
+        ctimer_stats.lateness_max = late;
+      }
+#endif /* CTIMER_STATS */
+      if(c->f != NULL) {
+        c->f(c->ptr);
+      }
+      for(c = list_head(expired_list); c != NULL && c->p != p; c = c->next);
+    }
+    PROCESS_CONTEXT_END(p);
   }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_process, ev, data)
+{
+  PROCESS_BEGIN();
+
   initialized = 1;
+  update_timer();
 
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
-    for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-      if(&c->etimer == data) {
-	list_remove(ctimer_list, c);
-	PROCESS_CONTEXT_BEGIN(c->p);
-	if(c->f != NULL) {
-	  c->f(c->ptr);
-	}
-	PROCESS_CONTEXT_END(c->p);
-	break;
-      }
-    }
+    call_expired();
+    update_timer();
   }
   PROCESS_END();
 }
@@ -92,6 +202,7 @@ ctimer_init(void)
 {
   initialized = 0;
   list_init(ctimer_list);
+  list_init(expired_list);
   process_start(&ctimer_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -110,66 +221,37 @@ ctimer_set_with_process(struct ctimer *c, clock_time_t t,
   c->p = p;
   c->f = f;
   c->ptr = ptr;
-  if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_set(&c->etimer, t);
-    PROCESS_CONTEXT_END(&ctimer_process);
-  } else {
-    c->etimer.timer.interval = t;
-  }
-
-  list_add(ctimer_list, c);
+  timer_set(&c->etimer.timer, t);
+  insert(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
-  if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_reset(&c->etimer);
-    PROCESS_CONTEXT_END(&ctimer_process);
-  }
-
-  list_add(ctimer_list, c);
+  timer_reset(&c->etimer.timer);
+  insert(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_restart(struct ctimer *c)
 {
-  if(initialized) {
-    PROCESS_CONTEXT_BEGIN(&ctimer_process);
-    etimer_restart(&c->etimer);
-    PROCESS_CONTEXT_END(&ctimer_process);
-  }
-
-  list_add(ctimer_list, c);
+  timer_restart(&c->etimer.timer);
+  insert(c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_stop(struct ctimer *c)
 {
-  if(initialized) {
-    etimer_stop(&c->etimer);
-  } else {
-    c->etimer.next = NULL;
-    c->etimer.p = PROCESS_NONE;
-  }
+  c->etimer.next = NULL;
+  c->etimer.p = PROCESS_NONE;
   list_remove(ctimer_list, c);
+  list_remove(expired_list, c);
 }
 /*---------------------------------------------------------------------------*/
 int
 ctimer_expired(struct ctimer *c)
 {
-  struct ctimer *t;
-  if(initialized) {
-    return etimer_expired(&c->etimer);
-  }
-  for(t = list_head(ctimer_list); t != NULL; t = t->next) {
-    if(t == c) {
-      return 0;
-    }
-  }
-  return 1;
+  return c->etimer.p == PROCESS_NONE;
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
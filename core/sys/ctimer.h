@@ -49,6 +49,12 @@
  * The ctimer module provides a timer mechanism that calls a specified
  * C function when a ctimer expires.
  *
+ * Pending callback timers are kept in a list sorted by expiration
+ * time, and a single event timer is set to expire with the first of
+ * them. When it does, the callbacks of all callback timers that have
+ * expired are called in one pass, grouped by the process they belong
+ * to.
+ *
  */
 
 #ifndef CTIMER_H_
@@ -56,14 +62,52 @@
 
 #include "sys/etimer.h"
 
+/**
+ * If non-zero, the number of callbacks and their lateness are
+ * recorded in ::ctimer_stats.
+ */
+#ifdef CTIMER_CONF_STATS
+#define CTIMER_STATS CTIMER_CONF_STATS
+#else /* CTIMER_CONF_STATS */
+#define CTIMER_STATS 0
+#endif /* CTIMER_CONF_STATS */
+
 struct ctimer {
   struct ctimer *next;
+  /* Only the timer of the etimer is used; it is not handed to the
+     etimer library. The p field is set while the ctimer is pending, so
+     that etimer_expired() can be used on it. */
   struct etimer etimer;
   struct process *p;
   void (*f)(void *);
   void *ptr;
 };
 
+/**
+ * \brief      Callback timer statistics
+ *
+ *             The lateness of a callback is the number of clock ticks
+ *             between the expiration time of its timer and the time
+ *             it was called.
+ */
+struct ctimer_stats {
+  /** Number of callbacks that have been called. */
+  unsigned long callbacks;
+  /** Number of passes in which expired callback timers were handled. */
+  unsigned long passes;
+  /** Number of switches to the context of a process for a group of
+      callbacks. */
+  unsigned long contexts;
+  /** Sum of the lateness of all callbacks. */
+  unsigned long lateness_sum;
+  /** The largest lateness seen. */
+  clock_time_t lateness_max;
+};
+
+#if CTIMER_STATS
+extern struct ctimer_stats ctimer_stats;
+#endif /* CTIMER_STATS */
+
 /**
  * \brief      Reset a callback timer with the same interval as was
  *             previously set.
@@ -49,10 +49,349 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
-static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
+
+#if ETIMER_WHEEL
+/*
+ * Hierarchical timing wheel.
+ *
+ * Level 0 has one slot per clock tick for the next
+ * 2^ETIMER_WHEEL_BITS ticks, level 1 has one slot per
+ * 2^ETIMER_WHEEL_BITS ticks, and so on. A timer is put on the lowest
+ * level that can hold its distance from wheel_time and is moved
+ * ("cascaded") to a lower level when wheel_time enters the range of
+ * its slot. Every timer is thus moved at most WHEEL_LEVELS times, and
+ * all timers in a level 0 slot expire at the same tick.
+ *
+ * Each etimer records the index of the slot it is on, so that it can
+ * be found again without scanning the whole wheel. Timers that are
+ * already due when they are added, or whose event could not be
+ * posted, are kept in an extra slot, WHEEL_DUE, that is serviced
+ * first on every poll.
+ */
+#if ETIMER_WHEEL_BITS < 3 || ETIMER_WHEEL_BITS > 8
+#error ETIMER_CONF_WHEEL_BITS must be between 3 and 8
+#endif
+
+#define WHEEL_SLOTS  (1 << ETIMER_WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS ((sizeof(clock_time_t) * 8 + ETIMER_WHEEL_BITS - 1) / \
+                      ETIMER_WHEEL_BITS)
+#define WHEEL_DUE    (WHEEL_LEVELS * WHEEL_SLOTS)
+
+#define SLOT_INDEX(t, level) \
+  ((int)(((t) >> ((level) * ETIMER_WHEEL_BITS)) & WHEEL_MASK))
+
+static struct etimer *wheel[WHEEL_DUE + 1];
+static uint8_t occupied[WHEEL_LEVELS][WHEEL_SLOTS / 8];
+
+/* The first clock tick that has not been processed yet. */
+static clock_time_t wheel_time;
+static unsigned int npending;
+/*---------------------------------------------------------------------------*/
+static void
+mark_slot(uint16_t slot)
+{
+  if(slot < WHEEL_DUE) {
+    if(wheel[slot] != NULL) {
+      occupied[slot / WHEEL_SLOTS][(slot & WHEEL_MASK) >> 3] |=
+        1 << (slot & 7);
+    } else {
+      occupied[slot / WHEEL_SLOTS][(slot & WHEEL_MASK) >> 3] &=
+        ~(1 << (slot & 7));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the first non-empty slot in [from, to) on a level, or -1. */
+static int
+first_occupied(int level, int from, int to)
+{
+  int i;
+
+  for(i = from; i < to; i++) {
+    if((i & 7) == 0 && occupied[level][i >> 3] == 0) {
+      i += 7;
+    } else if(occupied[level][i >> 3] & (1 << (i & 7))) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+take_slot(uint16_t slot)
+{
+  struct etimer *t;
+
+  t = wheel[slot];
+  wheel[slot] = NULL;
+  mark_slot(slot);
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_slot(uint16_t slot, struct etimer *t)
+{
+  t->slot = slot;
+  t->next = wheel[slot];
+  wheel[slot] = t;
+  mark_slot(slot);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Puts a timer that expires at or after wheel_time on the slot that
+ * matches its distance from wheel_time.
+ */
+static void
+place(struct etimer *t)
+{
+  clock_time_t expiration;
+  clock_time_t d;
+  int level;
+
+  expiration = t->timer.start + t->timer.interval;
+  d = expiration - wheel_time;
+  for(level = 0; level < WHEEL_LEVELS - 1 && (d >> ETIMER_WHEEL_BITS) != 0;
+      level++) {
+    d >>= ETIMER_WHEEL_BITS;
+  }
+  put_slot(level * WHEEL_SLOTS + SLOT_INDEX(expiration, level), t);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Unlinks a timer from the slot it claims to be on. The slot index of
+ * a timer that was never set may contain anything, so it is range
+ * checked and the slot is searched for the timer before it is
+ * trusted.
+ */
+static int
+unlink_timer(struct etimer *et)
+{
+  struct etimer **tp;
+
+  if(et->slot > WHEEL_DUE) {
+    return 0;
+  }
+  for(tp = &wheel[et->slot]; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == et) {
+      *tp = et->next;
+      mark_slot(et->slot);
+      et->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  struct etimer *t;
+  clock_time_t best;
+  clock_time_t d;
+  int found;
+  int level;
+  int idx;
+  int s;
+
+  if(npending == 0) {
+    next_expiration = 0;
+    return;
+  }
+
+  if(wheel[WHEEL_DUE] != NULL) {
+    /* Already expired, make sure that we are polled again. */
+    t = wheel[WHEEL_DUE];
+    next_expiration = t->timer.start + t->timer.interval;
+    return;
+  }
+
+  /* Level 0 slots up to the end of the current block hold the
+     earliest timers on the wheel, if there are any. */
+  idx = SLOT_INDEX(wheel_time, 0);
+  s = first_occupied(0, idx, WHEEL_SLOTS);
+  if(s >= 0) {
+    next_expiration = wheel_time + (s - idx);
+    return;
+  }
+
+  /* Otherwise the first non-empty slot of each level, in wheel order,
+     holds the earliest timer of that level. */
+  found = 0;
+  best = 0;
+  s = first_occupied(0, 0, idx);
+  if(s >= 0) {
+    best = WHEEL_SLOTS - idx + s;
+    found = 1;
+  }
+  for(level = 1; level < WHEEL_LEVELS; level++) {
+    idx = SLOT_INDEX(wheel_time, level);
+    s = first_occupied(level, idx + 1, WHEEL_SLOTS);
+    if(s < 0) {
+      s = first_occupied(level, 0, idx + 1);
+    }
+    if(s >= 0) {
+      for(t = wheel[level * WHEEL_SLOTS + s]; t != NULL; t = t->next) {
+        d = t->timer.start + t->timer.interval - wheel_time;
+        if(!found || d < best) {
+          best = d;
+          found = 1;
+        }
+      }
+    }
+  }
+  next_expiration = wheel_time + best;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *et)
+{
+  clock_time_t expiration;
+
+  if(npending == 0) {
+    /* Nothing is on the wheel, so it can be moved to the present. */
+    wheel_time = clock_time();
+  }
+  ++npending;
+
+  expiration = et->timer.start + et->timer.interval;
+  if(timer_expired(&et->timer)) {
+    put_slot(WHEEL_DUE, et);
+    next_expiration = expiration;
+  } else {
+    place(et);
+    if(npending == 1 ||
+       (wheel[WHEEL_DUE] == NULL &&
+        (clock_time_t)(expiration - wheel_time) <
+        (clock_time_t)(next_expiration - wheel_time))) {
+      next_expiration = expiration;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+remove_timer(struct etimer *et)
+{
+  if(!unlink_timer(et)) {
+    return 0;
+  }
+  --npending;
+  if(et->slot == WHEEL_DUE ||
+     et->timer.start + et->timer.interval == next_expiration) {
+    update_time();
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+post_timer(struct etimer *t)
+{
+  if(process_post_prio(t->p, PROCESS_EVENT_TIMER, t,
+                       PROCESS_PRIO_HIGH) == PROCESS_ERR_OK) {
+    /* Reset the process ID of the event timer, to signal that the
+       etimer has expired. This is later checked in the
+       etimer_expired() function. */
+    t->p = PROCESS_NONE;
+    t->next = NULL;
+    --npending;
+  } else {
+    put_slot(WHEEL_DUE, t);
+    etimer_request_poll();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+cascade(void)
+{
+  struct etimer *t, *next;
+  int level;
+  int idx;
+
+  for(level = 1; level < WHEEL_LEVELS; level++) {
+    idx = SLOT_INDEX(wheel_time, level);
+    for(t = take_slot(level * WHEEL_SLOTS + idx); t != NULL; t = next) {
+      next = t->next;
+      place(t);
+    }
+    if(idx != 0) {
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_wheel(void)
+{
+  struct etimer *t, *next;
+  clock_time_t ticks;
+  clock_time_t step;
+  int idx;
+  int s;
+
+  for(t = take_slot(WHEEL_DUE); t != NULL; t = next) {
+    next = t->next;
+    post_timer(t);
+  }
+
+  ticks = clock_time() + 1 - wheel_time;
+  while(ticks > 0 && npending > 0) {
+    idx = SLOT_INDEX(wheel_time, 0);
+    if(idx == 0) {
+      cascade();
+    }
+
+    for(t = take_slot(idx); t != NULL; t = next) {
+      next = t->next;
+      if((clock_time_t)(wheel_time - t->timer.start) >= t->timer.interval) {
+        post_timer(t);
+      } else {
+        place(t);
+      }
+    }
+
+    /* Skip ahead to the next non-empty slot, but stop at the end of
+       the block so that the next level is cascaded in time. */
+    s = first_occupied(0, idx + 1, WHEEL_SLOTS);
+    step = (s < 0 ? WHEEL_SLOTS : s) - idx;
+    if(step > ticks) {
+      step = ticks;
+    }
+    wheel_time += step;
+    ticks -= step;
+  }
+  if(npending == 0) {
+    wheel_time += ticks;
+  }
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct process *p)
+{
+  struct etimer **tp;
+  uint16_t slot;
+
+  for(slot = 0; slot <= WHEEL_DUE; slot++) {
+    for(tp = &wheel[slot]; *tp != NULL;) {
+      if((*tp)->p == p) {
+        *tp = (*tp)->next;
+        --npending;
+      } else {
+        tp = &(*tp)->next;
+      }
+    }
+    mark_slot(slot);
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_WHEEL */
+
+static struct etimer *timerlist;
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -77,18 +416,27 @@ update_time(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#endif /* ETIMER_WHEEL */
+
 PROCESS_THREAD(etimer_process, ev, data)
 {
+#if !ETIMER_WHEEL
   struct etimer *t, *u;
+#endif /* !ETIMER_WHEEL */
 	
   PROCESS_BEGIN();
 
+#if !ETIMER_WHEEL
   timerlist = NULL;
+#endif /* !ETIMER_WHEEL */
   
   while(1) {
     PROCESS_YIELD();
 
     if(ev == PROCESS_EVENT_EXITED) {
+#if ETIMER_WHEEL
+      remove_process_timers(data);
+#else /* ETIMER_WHEEL */
       struct process *p = data;
 
       while(timerlist != NULL && timerlist->p == p) {
@@ -104,18 +452,23 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+#endif /* ETIMER_WHEEL */
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
+#if ETIMER_WHEEL
+    run_wheel();
+#else /* ETIMER_WHEEL */
   again:
     
     u = NULL;
     
     for(t = timerlist; t != NULL; t = t->next) {
       if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+	if(process_post_prio(t->p, PROCESS_EVENT_TIMER, t,
+			     PROCESS_PRIO_HIGH) == PROCESS_ERR_OK) {
 	  
 	  /* Reset the process ID of the event timer, to signal that the
 	     etimer has expired. This is later checked in the
@@ -135,7 +488,7 @@ PROCESS_THREAD(etimer_process, ev, data)
       }
       u = t;
     }
-    
+#endif /* ETIMER_WHEEL */
   }
   
   PROCESS_END();
@@ -150,6 +503,15 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
+#if ETIMER_WHEEL
+  etimer_request_poll();
+
+  if(timer->p != PROCESS_NONE) {
+    remove_timer(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  insert_timer(timer);
+#else /* ETIMER_WHEEL */
   struct etimer *t;
 
   etimer_request_poll();
@@ -171,6 +533,7 @@ add_timer(struct etimer *timer)
   timerlist = timer;
 
   update_time();
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -205,6 +568,13 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_WHEEL
+  if(et->p != PROCESS_NONE && remove_timer(et)) {
+    et->timer.start += timediff;
+    insert_timer(et);
+    return;
+  }
+#endif /* ETIMER_WHEEL */
   et->timer.start += timediff;
   update_time();
 }
@@ -230,7 +600,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_WHEEL
+  return npending != 0;
+#else /* ETIMER_WHEEL */
   return timerlist != NULL;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -242,6 +616,9 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  remove_timer(et);
+#else /* ETIMER_WHEEL */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -262,6 +639,7 @@ etimer_stop(struct etimer *et)
       update_time();
     }
   }
+#endif /* ETIMER_WHEEL */
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
@@ -65,6 +65,35 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * \brief Select the hierarchical timing wheel backend.
+ *
+ * By default, all pending event timers are kept in a single unsorted
+ * list, which costs O(n) on every insert and every expiry. Platforms
+ * that run hundreds of event timers can instead set
+ * ETIMER_CONF_WHEEL to 1 to keep the timers in a hierarchical timing
+ * wheel, which makes inserting a timer and processing a clock tick
+ * (amortized) constant time at the cost of some extra RAM.
+ */
+#ifdef ETIMER_CONF_WHEEL
+#define ETIMER_WHEEL ETIMER_CONF_WHEEL
+#else /* ETIMER_CONF_WHEEL */
+#define ETIMER_WHEEL 0
+#endif /* ETIMER_CONF_WHEEL */
+
+/**
+ * \brief Number of bits of the clock handled by each level of the
+ *        timing wheel.
+ *
+ * Each level has 2^ETIMER_WHEEL_BITS slots, and enough levels are
+ * allocated to cover the whole clock_time_t range.
+ */
+#ifdef ETIMER_CONF_WHEEL_BITS
+#define ETIMER_WHEEL_BITS ETIMER_CONF_WHEEL_BITS
+#else /* ETIMER_CONF_WHEEL_BITS */
+#define ETIMER_WHEEL_BITS 6
+#endif /* ETIMER_CONF_WHEEL_BITS */
+
 /**
  * A timer.
  *
@@ -77,6 +106,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_WHEEL
+  uint16_t slot;
+#endif /* ETIMER_WHEEL */
 };
 
 /**
@@ -44,10 +44,23 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
 
+#if PROCESS_PROFILE
+#include "sys/rtimer.h"
+
+#ifdef PROCESS_CONF_PROFILE_CLOCK
+#define PROFILE_CLOCK() PROCESS_CONF_PROFILE_CLOCK()
+typedef PROCESS_CONF_PROFILE_CLOCK_T profile_clock_t;
+#else /* PROCESS_CONF_PROFILE_CLOCK */
+#define PROFILE_CLOCK() RTIMER_NOW()
+typedef rtimer_clock_t profile_clock_t;
+#endif /* PROCESS_CONF_PROFILE_CLOCK */
+#endif /* PROCESS_PROFILE */
+
 /*
  * Pointer to the currently running process structure.
  */
@@ -63,10 +76,43 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_PROFILE
+  profile_clock_t posted;
+#endif /* PROCESS_PROFILE */
+};
+
+/*
+ * Each priority class has its own event ring. Without a high-priority
+ * lane, both classes share the normal ring.
+ */
+struct event_queue {
+  struct event_data *events;
+  process_num_events_t size;
+  process_num_events_t nevents, fevent;
+#if PROCESS_CONF_STATS
+  process_num_events_t maxevents;
+  unsigned short drops;
+#endif /* PROCESS_CONF_STATS */
 };
 
-static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#if PROCESS_NUMEVENTS_HIGH > 0
+static struct event_data events_high[PROCESS_NUMEVENTS_HIGH];
+#define NQUEUES 2
+#else /* PROCESS_NUMEVENTS_HIGH > 0 */
+#define NQUEUES 1
+#endif /* PROCESS_NUMEVENTS_HIGH > 0 */
+
+/* Queues are served in array order, so the high lane comes first. */
+static struct event_queue queues[NQUEUES];
+#define QUEUE_NORMAL (&queues[NQUEUES - 1])
+#define QUEUE_HIGH   (&queues[0])
+
+/* Total number of events waiting in all queues. */
+static process_num_events_t nevents;
+
+/* Broadcast subscriptions of all processes. */
+static struct process_subscription *subscriptions;
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -74,9 +120,21 @@ process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
+#if PROCESS_PROFILE
+/* The time the event that is being delivered was posted, valid while
+   profile_queued is set. */
+static profile_clock_t profile_posted;
+static unsigned char profile_queued;
+/* The time spent in processes called from the running process. */
+static profile_clock_t profile_children;
+#endif /* PROCESS_PROFILE */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
+/* Set while the other processes receive PROCESS_EVENT_EXITED, until
+   the process is removed from the process list */
+#define PROCESS_STATE_EXITING     4
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
 
@@ -98,14 +156,9 @@ process_alloc_event(void)
 void
 process_start(struct process *p, process_data_t data)
 {
-  struct process *q;
-
   /* First make sure that we don't try to start a process that is
-     already running. */
-  for(q = process_list; q != p && q != NULL; q = q->next);
-
-  /* If we found the process on the process list, we bail out. */
-  if(q == p) {
+     already running, or still on the process list while it exits. */
+  if(p->state != PROCESS_STATE_NONE) {
     return;
   }
   /* Put on the procs list.*/
@@ -121,6 +174,54 @@ process_start(struct process *p, process_data_t data)
 }
 /*---------------------------------------------------------------------------*/
 static void
+remove_subscriptions(struct process *p)
+{
+  struct process_subscription **sp;
+
+  if(p->nsubscriptions == 0) {
+    return;
+  }
+  for(sp = &subscriptions; *sp != NULL;) {
+    if((*sp)->p == p) {
+      *sp = (*sp)->next;
+    } else {
+      sp = &(*sp)->next;
+    }
+  }
+  p->nsubscriptions = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_subscribe(struct process_subscription *s,
+                  struct process *p, process_event_t ev)
+{
+  struct process_subscription **sp;
+
+  process_unsubscribe(s);
+  s->p = p;
+  s->ev = ev;
+  s->next = NULL;
+  /* Subscribers are called in the order they subscribed */
+  for(sp = &subscriptions; *sp != NULL; sp = &(*sp)->next);
+  *sp = s;
+  p->nsubscriptions++;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+  struct process_subscription **sp;
+
+  for(sp = &subscriptions; *sp != NULL; sp = &(*sp)->next) {
+    if(*sp == s) {
+      *sp = s->next;
+      s->p->nsubscriptions--;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 exit_process(struct process *p, struct process *fromprocess)
 {
   register struct process *q;
@@ -130,31 +231,29 @@ exit_process(struct process *p, struct process *fromprocess)
 
   /* Make sure the process is in the process list before we try to
      exit it. */
-  for(q = process_list; q != p && q != NULL; q = q->next);
-  if(q == NULL) {
+  if(!process_is_running(p)) {
     return;
   }
 
-  if(process_is_running(p)) {
-    /* Process was running */
-    p->state = PROCESS_STATE_NONE;
+  /* Process was running */
+  p->state = PROCESS_STATE_EXITING;
+  remove_subscriptions(p);
 
-    /*
-     * Post a synchronous event to all processes to inform them that
-     * this process is about to exit. This will allow services to
-     * deallocate state associated with this process.
-     */
-    for(q = process_list; q != NULL; q = q->next) {
-      if(p != q) {
-	call_process(q, PROCESS_EVENT_EXITED, (process_data_t)p);
-      }
+  /*
+   * Post a synchronous event to all processes to inform them that
+   * this process is about to exit. This will allow services to
+   * deallocate state associated with this process.
+   */
+  for(q = process_list; q != NULL; q = q->next) {
+    if(p != q) {
+      call_process(q, PROCESS_EVENT_EXITED, (process_data_t)p);
     }
+  }
 
-    if(p->thread != NULL && p != fromprocess) {
-      /* Post the exit event to the process that is about to exit. */
-      process_current = p;
-      p->thread(&p->pt, PROCESS_EVENT_EXIT, NULL);
-    }
+  if(p->thread != NULL && p != fromprocess) {
+    /* Post the exit event to the process that is about to exit. */
+    process_current = p;
+    p->thread(&p->pt, PROCESS_EVENT_EXIT, NULL);
   }
 
   if(p == process_list) {
@@ -167,14 +266,40 @@ exit_process(struct process *p, struct process *fromprocess)
       }
     }
   }
+  p->state = PROCESS_STATE_NONE;
 
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+static void
+profile_wait(struct process *p, profile_clock_t now)
+{
+  profile_clock_t wait;
+  int b;
+
+  wait = (profile_clock_t)(now - profile_posted);
+  if(wait > p->profile.max_wait) {
+    p->profile.max_wait = wait;
+  }
+  for(b = 0; b < PROCESS_PROFILE_HIST_BUCKETS - 1; b++) {
+    wait >>= PROCESS_PROFILE_HIST_LOG2_STEP;
+    if(wait == 0) {
+      break;
+    }
+  }
+  p->profile.wait_hist[b]++;
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_PROFILE
+  profile_clock_t start, elapsed, self, children;
+  unsigned char queued;
+#endif /* PROCESS_PROFILE */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +312,30 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_PROFILE
+    start = PROFILE_CLOCK();
+    /* Only the receivers of a queued event have waited for it, not
+       the processes they call synchronously. */
+    queued = profile_queued;
+    profile_queued = 0;
+    if(queued) {
+      profile_wait(p, start);
+    }
+    children = profile_children;
+    profile_children = 0;
+#endif /* PROCESS_PROFILE */
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_PROFILE
+    elapsed = (profile_clock_t)(PROFILE_CLOCK() - start);
+    /* Time spent in processes called synchronously is their own. */
+    self = (profile_clock_t)(elapsed - profile_children);
+    p->profile.calls++;
+    p->profile.time += self;
+    if(self > p->profile.max_time) {
+      p->profile.max_time = self;
+    }
+    profile_children = children + elapsed;
+#endif /* PROCESS_PROFILE */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -195,6 +343,9 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     } else {
       p->state = PROCESS_STATE_RUNNING;
     }
+#if PROCESS_PROFILE
+    profile_queued = queued;
+#endif /* PROCESS_PROFILE */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -207,9 +358,29 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  QUEUE_NORMAL->events = events;
+  QUEUE_NORMAL->size = PROCESS_CONF_NUMEVENTS;
+#if PROCESS_NUMEVENTS_HIGH > 0
+  QUEUE_HIGH->events = events_high;
+  QUEUE_HIGH->size = PROCESS_NUMEVENTS_HIGH;
+#endif /* PROCESS_NUMEVENTS_HIGH > 0 */
+#if PROCESS_PROFILE
+  profile_queued = 0;
+  profile_children = 0;
+#endif /* PROCESS_PROFILE */
+  for(i = 0; i < NQUEUES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+#if PROCESS_CONF_STATS
+    queues[i].maxevents = 0;
+    queues[i].drops = 0;
+#endif /* PROCESS_CONF_STATS */
+  }
+  nevents = 0;
+  subscriptions = NULL;
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -225,6 +396,13 @@ static void
 do_poll(void)
 {
   struct process *p;
+#if PROCESS_PROFILE
+  unsigned char queued = profile_queued;
+
+  /* Polls can be run in the middle of a broadcast, but do not come
+     from the event queue. */
+  profile_queued = 0;
+#endif /* PROCESS_PROFILE */
 
   poll_requested = 0;
   /* Call the processes that needs to be polled. */
@@ -235,6 +413,9 @@ do_poll(void)
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
+#if PROCESS_PROFILE
+  profile_queued = queued;
+#endif /* PROCESS_PROFILE */
 }
 /*---------------------------------------------------------------------------*/
 /*
@@ -249,30 +430,44 @@ do_event(void)
   process_data_t data;
   struct process *receiver;
   struct process *p;
+  struct process_subscription *s, *next;
+  struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
    * through the list of processes to see if the event should be
    * delivered to any of them. If so, we call the event handler
    * function for the process. We only process one event at a time and
-   * call the poll handlers inbetween.
+   * call the poll handlers inbetween. Events in the high-priority
+   * lane are delivered before any event in the normal queue.
    */
 
   if(nevents > 0) {
-    
+
+    for(q = queues; q->nevents == 0; q++);
+
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
+#if PROCESS_PROFILE
+    profile_posted = q->events[q->fevent].posted;
+    profile_queued = 1;
+#endif /* PROCESS_PROFILE */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % q->size;
+    --q->nevents;
     --nevents;
 
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
+    /* If this is a broadcast event, we walk the process list and
+       deliver it to the processes that have not subscribed to specific
+       broadcast events, in list order. The subscribers of the event
+       are then called from the subscription list, in the order they
+       subscribed. The other subscribers are skipped without being
+       called. */
     if(receiver == PROCESS_BROADCAST) {
       for(p = process_list; p != NULL; p = p->next) {
 
@@ -281,7 +476,18 @@ do_event(void)
 	if(poll_requested) {
 	  do_poll();
 	}
-	call_process(p, ev, data);
+	if(p->nsubscriptions == 0) {
+	  call_process(p, ev, data);
+	}
+      }
+      for(s = subscriptions; s != NULL; s = next) {
+	next = s->next;
+	if(s->ev == ev) {
+	  if(poll_requested) {
+	    do_poll();
+	  }
+	  call_process(s->p, ev, data);
+	}
       }
     } else {
       /* This is not a broadcast event, so we deliver it to the
@@ -295,6 +501,9 @@ do_event(void)
       /* Make sure that the process actually is running. */
       call_process(receiver, ev, data);
     }
+#if PROCESS_PROFILE
+    profile_queued = 0;
+#endif /* PROCESS_PROFILE */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -318,10 +527,46 @@ process_nevents(void)
   return nevents + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
+void
+process_queue_stats(unsigned char prio, struct process_queue_stats *stats)
+{
+  struct event_queue *q;
+
+  q = prio == PROCESS_PRIO_HIGH ? QUEUE_HIGH : QUEUE_NORMAL;
+  stats->depth = q->nevents;
+#if PROCESS_CONF_STATS
+  stats->max_depth = q->maxevents;
+  stats->drops = q->drops;
+#else /* PROCESS_CONF_STATS */
+  stats->max_depth = 0;
+  stats->drops = 0;
+#endif /* PROCESS_CONF_STATS */
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+void
+process_profile_reset(void)
+{
+  struct process *p;
+
+  for(p = process_list; p != NULL; p = p->next) {
+    memset(&p->profile, 0, sizeof(p->profile));
+  }
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data, PROCESS_PRIO_NORMAL);
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+                  unsigned char prio)
 {
   process_num_events_t snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +577,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  q = prio == PROCESS_PRIO_HIGH ? QUEUE_HIGH : QUEUE_NORMAL;
+  if(q->nevents == q->size) {
+    /* A full high-priority lane overflows into the normal queue. */
+    if(q != QUEUE_NORMAL && QUEUE_NORMAL->nevents < QUEUE_NORMAL->size) {
+      q = QUEUE_NORMAL;
+    } else {
+#if PROCESS_CONF_STATS
+      q->drops++;
+#endif /* PROCESS_CONF_STATS */
+      q = NULL;
+    }
+  }
+
+  if(q == NULL) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,13 +601,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+#if PROCESS_PROFILE
+  q->events[snum].posted = PROFILE_CLOCK();
+#endif /* PROCESS_PROFILE */
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
+  if(q->nevents > q->maxevents) {
+    q->maxevents = q->nevents;
+  }
   if(nevents > process_maxevents) {
     process_maxevents = nevents;
   }
@@ -382,7 +647,8 @@ process_poll(struct process *p)
 int
 process_is_running(struct process *p)
 {
-  return p->state != PROCESS_STATE_NONE;
+  return p->state == PROCESS_STATE_RUNNING ||
+    p->state == PROCESS_STATE_CALLED;
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
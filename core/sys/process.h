@@ -88,6 +88,79 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * Size of the high-priority event lane. Events posted with
+ * process_post_prio() and PROCESS_PRIO_HIGH are kept in a separate
+ * queue of this size, which is always emptied before the normal
+ * queue. If zero, there is no separate lane and high-priority events
+ * share the normal queue.
+ */
+#ifdef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_NUMEVENTS_HIGH PROCESS_CONF_NUMEVENTS_HIGH
+#else /* PROCESS_CONF_NUMEVENTS_HIGH */
+#define PROCESS_NUMEVENTS_HIGH 0
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/**
+ * \name Event priority classes
+ * @{
+ */
+/** Ordinary events, delivered in the order they were posted. */
+#define PROCESS_PRIO_NORMAL   0
+/**
+ * Latency-sensitive events such as timers and the polls of the
+ * TCP/IP stack. Network input does not go through the event queue:
+ * drivers hand packets over synchronously with tcpip_input(), or
+ * queue them and poll tcpip_process, and polls are served before any
+ * queued event.
+ */
+#define PROCESS_PRIO_HIGH     1
+#define PROCESS_PRIO_CLASSES  2
+/** @} */
+
+/**
+ * If non-zero, the kernel profiles every process: it counts the
+ * number of times the process is called, measures the time spent in
+ * it and records how long the events delivered to it have been
+ * waiting in the event queue, see struct process_profile. When zero,
+ * the profiler does not add any code or data.
+ *
+ * Time is measured with PROCESS_CONF_PROFILE_CLOCK(), a counter of
+ * type PROCESS_CONF_PROFILE_CLOCK_T running at
+ * PROCESS_CONF_PROFILE_SECOND ticks per second. The default is the
+ * rtimer clock.
+ */
+#ifdef PROCESS_CONF_PROFILE
+#define PROCESS_PROFILE PROCESS_CONF_PROFILE
+#else /* PROCESS_CONF_PROFILE */
+#define PROCESS_PROFILE 0
+#endif /* PROCESS_CONF_PROFILE */
+
+#ifdef PROCESS_CONF_PROFILE_SECOND
+#define PROCESS_PROFILE_SECOND PROCESS_CONF_PROFILE_SECOND
+#else /* PROCESS_CONF_PROFILE_SECOND */
+#define PROCESS_PROFILE_SECOND RTIMER_SECOND
+#endif /* PROCESS_CONF_PROFILE_SECOND */
+
+/**
+ * Number of buckets in the queue wait histogram of a process. Bucket
+ * 0 counts events that waited less than
+ * 2^PROCESS_PROFILE_HIST_LOG2_STEP ticks, and every following bucket
+ * covers a range 2^PROCESS_PROFILE_HIST_LOG2_STEP times wider. The
+ * last bucket counts all longer waits.
+ */
+#ifdef PROCESS_CONF_PROFILE_HIST_BUCKETS
+#define PROCESS_PROFILE_HIST_BUCKETS PROCESS_CONF_PROFILE_HIST_BUCKETS
+#else /* PROCESS_CONF_PROFILE_HIST_BUCKETS */
+#define PROCESS_PROFILE_HIST_BUCKETS 8
+#endif /* PROCESS_CONF_PROFILE_HIST_BUCKETS */
+
+#ifdef PROCESS_CONF_PROFILE_HIST_LOG2_STEP
+#define PROCESS_PROFILE_HIST_LOG2_STEP PROCESS_CONF_PROFILE_HIST_LOG2_STEP
+#else /* PROCESS_CONF_PROFILE_HIST_LOG2_STEP */
+#define PROCESS_PROFILE_HIST_LOG2_STEP 2
+#endif /* PROCESS_CONF_PROFILE_HIST_LOG2_STEP */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -312,6 +385,25 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
 
 /** @} */
 
+/**
+ * Profile of a process, kept when PROCESS_CONF_PROFILE is set. Times
+ * are in PROCESS_PROFILE_SECOND ticks. The run time of a process does
+ * not include the time spent in processes that it calls
+ * synchronously.
+ */
+struct process_profile {
+  /** Number of times the process has been called. */
+  unsigned long calls;
+  /** Total time spent in the process. */
+  unsigned long time;
+  /** The longest time spent in a single call. */
+  unsigned long max_time;
+  /** The longest time an event waited in the queue for the process. */
+  unsigned long max_wait;
+  /** Histogram of the time events waited in the queue. */
+  unsigned long wait_hist[PROCESS_PROFILE_HIST_BUCKETS];
+};
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -322,7 +414,32 @@ struct process {
 #endif
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
-  unsigned char state, needspoll;
+  unsigned char state, needspoll, nsubscriptions;
+#if PROCESS_PROFILE
+  struct process_profile profile;
+#endif /* PROCESS_PROFILE */
+};
+
+/**
+ * A broadcast event subscription, see process_subscribe().
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
+};
+
+/**
+ * Event queue statistics for one priority class, see
+ * process_queue_stats().
+ */
+struct process_queue_stats {
+  /** Number of events currently waiting in the queue. */
+  process_num_events_t depth;
+  /** The largest number of events that have been waiting. */
+  process_num_events_t max_depth;
+  /** Number of events that could not be posted. */
+  unsigned short drops;
 };
 
 /**
@@ -364,6 +481,31 @@ CCIF void process_start(struct process *p, process_data_t data);
  */
 CCIF int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Post an asynchronous event with a priority class.
+ *
+ * This function works as process_post(), but lets the caller choose
+ * the priority class of the event. Events of class PROCESS_PRIO_HIGH
+ * are delivered before any waiting PROCESS_PRIO_NORMAL event. If the
+ * high-priority lane is full, the event is put in the normal queue.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \param prio PROCESS_PRIO_NORMAL or PROCESS_PRIO_HIGH.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue was full and the event could
+ * not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev,
+                           process_data_t data, unsigned char prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -519,6 +661,67 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+/**
+ * Get the event queue statistics of a priority class.
+ *
+ * The maximum depth and the drop counter are only maintained when
+ * PROCESS_CONF_STATS is set.
+ *
+ * \param prio PROCESS_PRIO_NORMAL or PROCESS_PRIO_HIGH.
+ * \param stats Filled in with the statistics of the class.
+ */
+void process_queue_stats(unsigned char prio, struct process_queue_stats *stats);
+
+#if PROCESS_PROFILE
+/**
+ * Clear the profiles of all running processes.
+ */
+void process_profile_reset(void);
+#endif /* PROCESS_PROFILE */
+
+/** @} */
+
+/**
+ * \name Broadcast subscriptions
+ *
+ * By default a process receives every event posted to
+ * PROCESS_BROADCAST. Once a process has subscribed to a broadcast
+ * event, it instead only receives the broadcast events it has
+ * subscribed to, and the kernel does not call it for any other
+ * broadcast. Events posted directly to the process, as well as
+ * PROCESS_EVENT_EXITED, are not affected.
+ *
+ * A broadcast is first delivered to the processes without
+ * subscriptions, in the order of the process list, and then to the
+ * subscribers of the event, in the order they subscribed. The process
+ * list is still walked for every broadcast, the subscribers are only
+ * skipped instead of being called.
+ *
+ * @{
+ */
+
+/**
+ * Subscribe a process to a broadcast event.
+ *
+ * \param s A subscription structure, which must stay allocated
+ * until the subscription is removed or the process exits.
+ * \param p The subscribing process.
+ * \param ev The broadcast event.
+ */
+CCIF void process_subscribe(struct process_subscription *s,
+                            struct process *p, process_event_t ev);
+
+/**
+ * Remove a broadcast event subscription.
+ *
+ * When the last subscription of a process is removed, the process
+ * again receives all broadcast events. The subscriptions of a
+ * process are removed automatically when it exits.
+ *
+ * \param s The subscription structure.
+ */
+CCIF void process_unsubscribe(struct process_subscription *s);
+
 /** @} */
 
 CCIF extern struct process *process_list;
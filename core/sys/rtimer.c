@@ -54,7 +54,20 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_MULTIPLE
+/* Pending tasks, sorted by deadline. */
+static struct rtimer *rtimer_queue;
+/* Set while rtimer_run_next() executes tasks. It programs the
+   architecture timer itself when it is done. */
+static volatile char running;
+#else /* RTIMER_MULTIPLE */
 static struct rtimer *next_rtimer;
+#endif /* RTIMER_MULTIPLE */
+
+#if RTIMER_STATS
+struct rtimer_stats rtimer_stats;
+#endif /* RTIMER_STATS */
+
 static const rtimer_clock_t max_rtimer_bit = 1 << ((sizeof(rtimer_clock_t) * 8) - 1);
 static const rtimer_clock_t max_rtimer_value = -1;
 
@@ -65,6 +78,167 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+static void
+run_task(struct rtimer *t)
+{
+#if RTIMER_STATS
+  rtimer_clock_t now, late;
+
+  now = RTIMER_NOW();
+  late = RTIMER_CLOCK_LT(now, t->time) ? 0 : now - t->time;
+  rtimer_stats.runs++;
+  rtimer_stats.lateness_sum += late;
+  if(late > rtimer_stats.lateness_max) {
+    rtimer_stats.lateness_max = late;
+  }
+#endif /* RTIMER_STATS */
+  t->func(t, t->ptr);
+}
+/*---------------------------------------------------------------------------*/
+#if RTIMER_MULTIPLE
+/*
+ * Remove a task from the queue. Must be called with interrupts
+ * disabled. Returns non-zero if the task was in the queue.
+ */
+static int
+unlink_task(struct rtimer *rtimer)
+{
+  struct rtimer **tp;
+
+  for(tp = &rtimer_queue; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == rtimer) {
+      *tp = rtimer->next;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer **tp;
+  int s;
+
+  PRINTF("rtimer_set time %d\n", time);
+
+  s = RTIMER_ARCH_INTERRUPTS_DISABLE();
+
+  unlink_task(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+
+  /* Tasks with the same deadline run in the order they were set. */
+  for(tp = &rtimer_queue;
+      *tp != NULL && !RTIMER_CLOCK_LT(time, (*tp)->time);
+      tp = &(*tp)->next);
+  rtimer->next = *tp;
+  *tp = rtimer;
+
+  if(rtimer_queue == rtimer && !running) {
+    rtimer_arch_schedule(time);
+  }
+
+  RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_cancel(struct rtimer *rtimer)
+{
+  int s, found;
+
+  s = RTIMER_ARCH_INTERRUPTS_DISABLE();
+  found = unlink_task(rtimer);
+  /* If the first task was removed, the architecture timer is left
+     programmed for it. rtimer_run_next() then finds that the next
+     task is not yet due and reprograms the timer. */
+  RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+  rtimer_clock_t now;
+  int s;
+#if RTIMER_STATS
+  int first = 1;
+#endif /* RTIMER_STATS */
+
+  s = RTIMER_ARCH_INTERRUPTS_DISABLE();
+  if(running) {
+    RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+    return;
+  }
+  running = 1;
+
+  while((t = rtimer_queue) != NULL) {
+    now = RTIMER_NOW();
+    if(RTIMER_CLOCK_LT(now + RTIMER_GUARD_TIME, t->time)) {
+      /* Not due yet. This also happens when we were woken up for a
+         task that has since been cancelled. */
+      break;
+    }
+    if(RTIMER_CLOCK_LT(now, t->time)) {
+      /* Too close to be scheduled reliably, but not due yet. Do not
+         spin here with interrupts disabled; let the architecture
+         timer wake us up again once the guard time has passed. */
+      break;
+    }
+    rtimer_queue = t->next;
+    t->next = NULL;
+#if RTIMER_STATS
+    if(!first) {
+      rtimer_stats.overruns++;
+    }
+    first = 0;
+#endif /* RTIMER_STATS */
+    RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+    run_task(t);
+    s = RTIMER_ARCH_INTERRUPTS_DISABLE();
+  }
+
+  running = 0;
+  if(rtimer_queue != NULL) {
+    now = RTIMER_NOW();
+    if(RTIMER_CLOCK_LT(rtimer_queue->time, now + RTIMER_GUARD_TIME)) {
+      rtimer_arch_schedule(now + RTIMER_GUARD_TIME);
+    } else {
+      rtimer_arch_schedule(rtimer_queue->time);
+    }
+  }
+  RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_run_now(struct rtimer *rtimer)
+{
+  int s, found;
+
+  s = RTIMER_ARCH_INTERRUPTS_DISABLE();
+  found = unlink_task(rtimer);
+  if(found) {
+    rtimer->next = NULL;
+  }
+  /* As in rtimer_cancel(), a timer left programmed for this task
+     makes rtimer_run_next() reprogram it for the next one. */
+  RTIMER_ARCH_INTERRUPTS_RESTORE(s);
+
+  if(found) {
+    run_task(rtimer);
+  }
+  return found;
+}
+#else /* RTIMER_MULTIPLE */
+/*---------------------------------------------------------------------------*/
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -85,6 +259,16 @@ rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
   return RTIMER_OK;
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_cancel(struct rtimer *rtimer)
+{
+  if(next_rtimer != rtimer) {
+    return 0;
+  }
+  next_rtimer = NULL;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_run_next(void)
 {
@@ -94,8 +278,20 @@ rtimer_run_next(void)
     return;
   }
   next_rtimer = NULL;
-  t->func(t, t->ptr);
+  run_task(t);
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_run_now(struct rtimer *rtimer)
+{
+  if(next_rtimer != rtimer) {
+    return 0;
+  }
+  next_rtimer = NULL;
+  run_task(rtimer);
+  return 1;
 }
+#endif /* RTIMER_MULTIPLE */
 /*---------------------------------------------------------------------------*/
 rtimer_clock_t
 rtimer_delta(rtimer_clock_t a, rtimer_clock_t b)
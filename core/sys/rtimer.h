@@ -64,6 +64,49 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/*
+ * The task queue may be modified both from interrupt context and from
+ * the main loop. Architectures that run real-time tasks from an
+ * interrupt handler define RTIMER_ARCH_INTERRUPTS_DISABLE(), which
+ * disables interrupts and returns the previous interrupt state, and
+ * RTIMER_ARCH_INTERRUPTS_RESTORE(), which restores it. Architectures
+ * that run them from the main loop, such as Cooja, define them as
+ * no-ops.
+ */
+
+/**
+ * If non-zero, any number of real-time tasks can be pending at the
+ * same time. They are kept in a queue sorted by their deadline and
+ * the architecture timer is always programmed for the earliest
+ * one. If zero, only one task can be pending and rtimer_set() fails
+ * with RTIMER_ERR_ALREADY_SCHEDULED while it is.
+ *
+ * The queue needs the interrupt hooks above. It is on by default on
+ * the architectures whose rtimer-arch.h defines them, and cannot be
+ * turned on elsewhere.
+ */
+#ifdef RTIMER_CONF_MULTIPLE
+#define RTIMER_MULTIPLE RTIMER_CONF_MULTIPLE
+#elif defined(RTIMER_ARCH_INTERRUPTS_DISABLE)
+#define RTIMER_MULTIPLE 1
+#else /* RTIMER_CONF_MULTIPLE */
+#define RTIMER_MULTIPLE 0
+#endif /* RTIMER_CONF_MULTIPLE */
+
+#if RTIMER_MULTIPLE && !defined(RTIMER_ARCH_INTERRUPTS_DISABLE)
+#error RTIMER_CONF_MULTIPLE needs RTIMER_ARCH_INTERRUPTS_DISABLE() and RTIMER_ARCH_INTERRUPTS_RESTORE() in rtimer-arch.h
+#endif
+
+/**
+ * If non-zero, the lateness of every real-time task is recorded in
+ * ::rtimer_stats.
+ */
+#ifdef RTIMER_CONF_STATS
+#define RTIMER_STATS RTIMER_CONF_STATS
+#else /* RTIMER_CONF_STATS */
+#define RTIMER_STATS 0
+#endif /* RTIMER_CONF_STATS */
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -87,8 +130,33 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+#if RTIMER_MULTIPLE
+  struct rtimer *next;
+#endif /* RTIMER_MULTIPLE */
 };
 
+/**
+ * \brief      Lateness statistics of real-time tasks
+ *
+ *             The lateness of a task is the number of rtimer ticks
+ *             between its scheduled time and the time its callback
+ *             was called.
+ */
+struct rtimer_stats {
+  /** Number of tasks that have been executed. */
+  unsigned long runs;
+  /** Sum of the lateness of all executed tasks. */
+  unsigned long lateness_sum;
+  /** The largest lateness seen. */
+  rtimer_clock_t lateness_max;
+  /** Number of tasks that were due while another task ran. */
+  unsigned long overruns;
+};
+
+#if RTIMER_STATS
+extern struct rtimer_stats rtimer_stats;
+#endif /* RTIMER_STATS */
+
 enum {
   RTIMER_OK,
   RTIMER_ERR_FULL,
@@ -107,21 +175,50 @@ enum {
  *             (false) if the task could not be scheduled.
  *
  *             This function schedules a real-time task at a specified
- *             time in the future.
+ *             time in the future. If the task is already pending, it
+ *             is rescheduled. It may be called from interrupt context.
  *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
+/**
+ * \brief      Cancel a pending real-time task.
+ * \param task The task to cancel.
+ * \return     Non-zero if the task was pending, zero otherwise.
+ *
+ *             This function removes a task that has been scheduled
+ *             with rtimer_set() before it runs. It may be called
+ *             from interrupt context.
+ */
+int rtimer_cancel(struct rtimer *task);
+
 /**
  * \brief      Execute the next real-time task and schedule the next task, if any
  *
  *             This function is called by the architecture dependent
  *             code to execute and schedule the next real-time task.
+ *             Any further tasks that are due by then are executed as
+ *             well, before the architecture timer is programmed for
+ *             the earliest remaining task.
  *
  */
 void rtimer_run_next(void);
 
+/**
+ * \brief      Execute a pending real-time task immediately
+ * \param task A pointer to the task that is to be executed.
+ * \return     Non-zero if the task was pending and has been executed,
+ *             zero otherwise.
+ *
+ *             This function removes the task from the set of pending
+ *             tasks and runs it right away, regardless of its
+ *             deadline. Other pending tasks are not affected. It is
+ *             meant for drivers that learn about an event earlier
+ *             than anticipated, e.g., from a radio interrupt.
+ */
+int rtimer_run_now(struct rtimer *task);
+
 /**
  * \return     Difference between a and b.
  * \param a    Smaller than b unless b wrapped around zero
@@ -68,4 +68,9 @@
 #endif
 
 void rtimer_arch_sleep(rtimer_clock_t howlong);
+
+/* Protects the rtimer task queue against the compare interrupt. */
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   splhigh()
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  splx(s)
+
 #endif /* RTIMER_ARCH_H_ */
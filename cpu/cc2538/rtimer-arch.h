@@ -62,6 +62,7 @@
 
 #include "contiki.h"
 #include "dev/gptimer.h"
+#include "cpu.h"
 
 #define RTIMER_ARCH_SECOND 32768
 
@@ -88,6 +89,11 @@ rtimer_clock_t rtimer_arch_now(void);
  */
 rtimer_clock_t rtimer_arch_next_trigger(void);
 
+/* Protects the rtimer task queue against the sleep timer interrupt.
+   cpu_cpsid() returns the previous PRIMASK value. */
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   cpu_cpsid()
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  do { if(!(s)) { cpu_cpsie(); } } while(0)
+
 #endif /* RTIMER_ARCH_H_ */
 
 /**
@@ -64,4 +64,8 @@
 
 rtimer_clock_t rtimer_arch_now(void);
 
+/* Protects the rtimer task queue against the timer interrupt. */
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   splhigh()
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  splx(s)
+
 #endif /* RTIMER_ARCH_H_ */
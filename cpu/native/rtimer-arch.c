@@ -54,6 +54,44 @@
 #define PRINTF(...)
 #endif
 
+#if NATIVE_CONF_EPOLL
+static rtimer_clock_t next_time;
+static volatile int scheduled;
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_init(void)
+{
+  scheduled = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  PRINTF("rtimer_arch_schedule time %u\n", t);
+
+  next_time = t;
+  scheduled = 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_arch_next(rtimer_clock_t *t)
+{
+  if(scheduled) {
+    *t = next_time;
+  }
+  return scheduled;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_run_due(void)
+{
+  if(scheduled && !RTIMER_CLOCK_LT(RTIMER_NOW(), next_time)) {
+    scheduled = 0;
+    rtimer_run_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#else /* NATIVE_CONF_EPOLL */
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -90,3 +128,33 @@ rtimer_arch_schedule(rtimer_clock_t t)
 #endif /* !_WIN32 */
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_interrupts_disable(void)
+{
+#ifndef _WIN32
+  sigset_t set, old;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  sigprocmask(SIG_BLOCK, &set, &old);
+  return sigismember(&old, SIGALRM);
+#else /* !_WIN32 */
+  return 0;
+#endif /* !_WIN32 */
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_interrupts_restore(int s)
+{
+#ifndef _WIN32
+  sigset_t set;
+
+  if(!s) {
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &set, NULL);
+  }
+#endif /* !_WIN32 */
+}
+/*---------------------------------------------------------------------------*/
+#endif /* NATIVE_CONF_EPOLL */
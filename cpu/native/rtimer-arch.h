@@ -46,4 +46,20 @@
 
 #define rtimer_arch_now() clock_time()
 
+#if NATIVE_CONF_EPOLL
+/* With the epoll main loop, real-time tasks are not run from SIGALRM
+   but by the main loop, which sleeps until the scheduled time. */
+int rtimer_arch_next(rtimer_clock_t *t);
+void rtimer_arch_run_due(void);
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   0
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  ((void)(s))
+#else /* NATIVE_CONF_EPOLL */
+/* Real-time tasks run from the SIGALRM handler, which is blocked
+   while the rtimer task queue is modified. */
+int rtimer_arch_interrupts_disable(void);
+void rtimer_arch_interrupts_restore(int s);
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   rtimer_arch_interrupts_disable()
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  rtimer_arch_interrupts_restore(s)
+#endif /* NATIVE_CONF_EPOLL */
+
 #endif /* RTIMER_ARCH_H_ */
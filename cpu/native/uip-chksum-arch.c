@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         uip_chksum_add() with SSE2 or AVX2 for the native platform
+ */
+
+#include "net/ip/uip-chksum.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif /* __AVX2__ */
+
+/* Each iteration adds at most two 16-bit words to each 32-bit lane,
+   so the lanes cannot overflow for packets up to 64 kbytes. The
+   words are loaded in little endian byte order, which gives the byte
+   swapped sum (RFC 1071, section 2). */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_arch_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc = 0;
+  uint32_t lanes[8];
+  uint16_t word;
+  uint32_t s;
+  int i;
+
+#if defined(__AVX2__)
+  if(len >= 32) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a = zero;
+    __m256i v;
+
+    while(len >= 32) {
+      v = _mm256_loadu_si256((const __m256i *)data);
+      a = _mm256_add_epi32(a, _mm256_unpacklo_epi16(v, zero));
+      a = _mm256_add_epi32(a, _mm256_unpackhi_epi16(v, zero));
+      data += 32;
+      len -= 32;
+    }
+    _mm256_storeu_si256((__m256i *)lanes, a);
+    for(i = 0; i < 8; i++) {
+      acc += lanes[i];
+    }
+  }
+#endif /* __AVX2__ */
+
+  if(len >= 16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i v;
+
+    while(len >= 16) {
+      v = _mm_loadu_si128((const __m128i *)data);
+      a = _mm_add_epi32(a, _mm_unpacklo_epi16(v, zero));
+      a = _mm_add_epi32(a, _mm_unpackhi_epi16(v, zero));
+      data += 16;
+      len -= 16;
+    }
+    _mm_storeu_si128((__m128i *)lanes, a);
+    for(i = 0; i < 4; i++) {
+      acc += lanes[i];
+    }
+  }
+
+  while(len >= 2) {
+    memcpy(&word, data, sizeof(word));
+    acc += word;
+    data += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    acc += data[0];
+  }
+
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Swap back to host byte order and add the sum so far. */
+  s = (uint16_t)(((acc & 0xff) << 8) | ((acc >> 8) & 0xff));
+  s += sum;
+  s = (s & 0xffff) + (s >> 16);
+
+  return (uint16_t)s;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* __SSE2__ */
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of the Internet checksum for packet sizes
+ *         from an IPv6 header to the IPv6 minimum MTU.
+ *
+ *         uip_chksum_add() is compared with the byte-pair loop that
+ *         uIP used before, and an incremental update after an address
+ *         change (as when ip64 rewrites the pseudo header) is
+ *         compared with recomputing the checksum over the packet.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-chksum.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BYTES (1UL << 26)
+#define MAXLEN 1280
+
+static uint8_t buf[MAXLEN + 1];
+static volatile uint16_t sink;
+
+static const unsigned sizes[] = { 40, 64, 256, 1280 };
+/*---------------------------------------------------------------------------*/
+PROCESS(chksum_bench_process, "chksum benchmark");
+AUTOSTART_PROCESSES(&chksum_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+/* The loop that uip.c and uip6.c used before uip-chksum.c. */
+static uint16_t
+bytewise_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_sum(unsigned size)
+{
+  unsigned long i, n, t, bytewise_us, word_us;
+  unsigned long wrong = 0;
+  unsigned offset;
+
+  n = BYTES / size;
+
+  t = cpu_usec();
+  for(i = 0; i < n; i++) {
+    sink = bytewise_chksum(0, buf + (i & 1), size);
+  }
+  bytewise_us = cpu_usec() - t;
+
+  t = cpu_usec();
+  for(i = 0; i < n; i++) {
+    sink = uip_chksum_add(0, buf + (i & 1), size);
+  }
+  word_us = cpu_usec() - t;
+
+  for(offset = 0; offset < 2; offset++) {
+    for(i = 1; i <= size; i++) {
+      if(uip_chksum_add(0, buf + offset, i) !=
+         bytewise_chksum(0, buf + offset, i)) {
+        wrong++;
+      }
+    }
+  }
+
+  printf("%6u %14.1f %14.1f %6lu\n", size,
+         (double)bytewise_us * 1000 / n, (double)word_us * 1000 / n, wrong);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+packet_chksum(void)
+{
+  uint16_t sum;
+
+  sum = uip_chksum_add(0, buf, MAXLEN);
+  return ~sum == 0 ? 0xffff : ~sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_update(void)
+{
+  unsigned long i, n, t, full_us, update_us;
+  unsigned long wrong = 0;
+  uint16_t chksum, old_sum;
+  uint8_t *addr;
+  unsigned j;
+
+  n = BYTES / MAXLEN;
+  /* A source address somewhere in the packet. */
+  addr = buf + 8;
+
+  t = cpu_usec();
+  for(i = 0; i < n; i++) {
+    addr[15] = i;
+    sink = packet_chksum();
+  }
+  full_us = cpu_usec() - t;
+
+  chksum = uip_htons(packet_chksum());
+  t = cpu_usec();
+  for(i = 0; i < n; i++) {
+    old_sum = uip_chksum_add(0, addr, 16);
+    addr[15] = i;
+    chksum = uip_chksum_update(chksum, old_sum, uip_chksum_add(0, addr, 16));
+  }
+  update_us = cpu_usec() - t;
+  if(uip_ntohs(chksum) != packet_chksum()) {
+    wrong++;
+  }
+
+  for(i = 0; i < 1000; i++) {
+    old_sum = uip_chksum_add(0, addr, 16);
+    for(j = 0; j < 16; j++) {
+      addr[j] = random_rand();
+    }
+    chksum = uip_chksum_update(chksum, old_sum, uip_chksum_add(0, addr, 16));
+    if(uip_ntohs(chksum) != packet_chksum()) {
+      wrong++;
+    }
+  }
+
+  printf("%6u %14.1f %14.1f %6lu\n", MAXLEN,
+         (double)full_us * 1000 / n, (double)update_us * 1000 / n, wrong);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_bench_process, ev, data)
+{
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(buf); i++) {
+    buf[i] = random_rand();
+  }
+
+  printf("chksum benchmark, uip_chksum_add: %s\n",
+#ifdef UIP_CHKSUM_CONF_ARCH
+         "architecture specific"
+#else /* UIP_CHKSUM_CONF_ARCH */
+         "generic"
+#endif /* UIP_CHKSUM_CONF_ARCH */
+         );
+  printf(" bytes bytewise(ns/op) uip_chksum(ns/op) errors\n");
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run_sum(sizes[i]);
+  }
+
+  printf("\naddress change, recompute vs incremental update\n");
+  printf(" bytes recompute(ns/op) update(ns/op) errors\n");
+  run_update();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Measures the cost of demultiplexing incoming UDP datagrams
+ *         and TCP segments to their connection in uip_process(), as
+ *         a function of the number of open connections.
+ *
+ *         The connection tables hold 512 UDP and 512 TCP connections,
+ *         of which 8, 64 and then all 512 are in use. UDP datagrams
+ *         are sent to random bound ports (hit) and to a port nobody
+ *         listens to (miss). Some ports are shared by a connection
+ *         bound to a remote address and port and by a wildcard one,
+ *         and datagrams come both from that remote peer and from
+ *         another host. TCP segments are ACKs for random established
+ *         connections (hit) and RSTs for no connection (miss).
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PACKETS  (1UL << 16)
+#define BATCH    64
+#define PKT_SIZE (UIP_IPTCPH_LEN + 4)
+
+#define UDP_BASE_PORT 20000
+#define TCP_PEER_PORT 80
+#define PEER_PORT     5683
+
+#define TCP_RST 0x04
+#define TCP_ACK 0x10
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define UIP_TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static uip_ipaddr_t peer, other;
+static unsigned nudp, ntcp;
+static struct uip_conn *tcp_conns[UIP_CONNS];
+
+static uint8_t packets[BATCH][PKT_SIZE];
+static uint16_t lens[BATCH];
+static const void *expected[BATCH];
+
+static const unsigned sizes[] = { 8, 64, 512 };
+/*---------------------------------------------------------------------------*/
+PROCESS(conn_demux_bench_process, "conn-demux benchmark");
+AUTOSTART_PROCESSES(&conn_demux_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ip_header(const uip_ipaddr_t *src, uint8_t proto, uint16_t len)
+{
+  memset(uip_buf, 0, UIP_LLH_LEN + len);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (len - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = proto;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, src);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_len = len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+save_packet(int i)
+{
+  memcpy(packets[i], &uip_buf[UIP_LLH_LEN], uip_len);
+  lens[i] = uip_len;
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_packet(int i, const uip_ipaddr_t *src, uint16_t srcport, uint16_t port)
+{
+  ip_header(src, UIP_PROTO_UDP, UIP_IPUDPH_LEN + 4);
+  UIP_UDP_BUF->srcport = UIP_HTONS(srcport);
+  UIP_UDP_BUF->destport = UIP_HTONS(port);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + 4);
+  UIP_UDP_BUF->udpchksum = ~uip_udpchksum();
+  save_packet(i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_packet(int i, uint16_t srcport, uint16_t port, uint8_t flags)
+{
+  ip_header(&peer, UIP_PROTO_TCP, UIP_IPTCPH_LEN);
+  UIP_TCP_BUF->srcport = UIP_HTONS(srcport);
+  UIP_TCP_BUF->destport = port;
+  UIP_TCP_BUF->tcpoffset = 5 << 4;
+  UIP_TCP_BUF->flags = flags;
+  UIP_TCP_BUF->wnd[0] = 1;
+  UIP_TCP_BUF->tcpchksum = ~uip_tcpchksum();
+  save_packet(i);
+}
+/*---------------------------------------------------------------------------*/
+/* The connection that a scan of the whole table finds for the UDP
+   datagram in packets[i] */
+static const void *
+udp_conn_for(int i)
+{
+  const struct uip_ip_hdr *ip = (struct uip_ip_hdr *)packets[i];
+  const struct uip_udp_hdr *udp =
+    (struct uip_udp_hdr *)&packets[i][UIP_IPH_LEN];
+  struct uip_udp_conn *c;
+
+  for(c = &uip_udp_conns[0]; c < &uip_udp_conns[UIP_UDP_CONNS]; c++) {
+    if(c->lport != 0 && c->lport == udp->destport &&
+       (c->rport == 0 || c->rport == udp->srcport) &&
+       (uip_is_addr_unspecified(&c->ripaddr) ||
+        uip_ipaddr_cmp(&c->ripaddr, &ip->srcipaddr))) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_connections(unsigned size)
+{
+  struct uip_udp_conn *c;
+  struct uip_conn *t;
+
+  /* Each group of eight UDP connections ends with a port shared by a
+     connection bound to the peer and by a wildcard connection. */
+  for(; nudp < size; nudp++) {
+    c = uip_udp_new(NULL, 0);
+    if(nudp % 8 == 7) {
+      uip_udp_bind(c, UIP_HTONS(UDP_BASE_PORT + nudp - 1));
+    } else {
+      uip_udp_bind(c, UIP_HTONS(UDP_BASE_PORT + nudp));
+    }
+    if(nudp % 8 == 6) {
+      uip_ipaddr_copy(&c->ripaddr, &peer);
+      c->rport = UIP_HTONS(PEER_PORT);
+    }
+  }
+
+  for(; ntcp < size; ntcp++) {
+    t = uip_connect(&peer, UIP_HTONS(TCP_PEER_PORT));
+    /* Established, with nothing in flight */
+    t->tcpstateflags = UIP_ESTABLISHED;
+    t->len = 0;
+    memset(t->snd_nxt, 0, sizeof(t->snd_nxt));
+    memset(t->rcv_nxt, 0, sizeof(t->rcv_nxt));
+    tcp_conns[ntcp] = t;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+input_batch(unsigned long *wrong, int check)
+{
+  unsigned long t;
+  int i;
+
+  t = cpu_usec();
+  for(i = 0; i < BATCH; i++) {
+    memcpy(&uip_buf[UIP_LLH_LEN], packets[i], lens[i]);
+    uip_len = lens[i];
+    uip_input();
+    if(check == UIP_PROTO_UDP && (void *)uip_udp_conn != expected[i]) {
+      (*wrong)++;
+    } else if(check == UIP_PROTO_TCP && (void *)uip_conn != expected[i]) {
+      (*wrong)++;
+    }
+  }
+  t = cpu_usec() - t;
+  uip_clear_buf();
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(unsigned size)
+{
+  unsigned long op, udp_hit, udp_miss, tcp_hit, tcp_miss;
+  unsigned long wrong = 0;
+  unsigned slot;
+  int i;
+
+  add_connections(size);
+
+  udp_hit = udp_miss = tcp_hit = tcp_miss = 0;
+  for(op = 0; op < PACKETS; op += BATCH) {
+    for(i = 0; i < BATCH; i++) {
+      slot = random_rand() % size;
+      if(slot % 8 == 7) {
+        slot--;
+      }
+      if(i & 1) {
+        udp_packet(i, &peer, PEER_PORT, UDP_BASE_PORT + slot);
+      } else {
+        udp_packet(i, &other, PEER_PORT + 1, UDP_BASE_PORT + slot);
+      }
+      expected[i] = udp_conn_for(i);
+    }
+    udp_hit += input_batch(&wrong, UIP_PROTO_UDP);
+
+    for(i = 0; i < BATCH; i++) {
+      udp_packet(i, &other, PEER_PORT, UDP_BASE_PORT - 1);
+    }
+    udp_miss += input_batch(&wrong, 0);
+
+    for(i = 0; i < BATCH; i++) {
+      slot = random_rand() % size;
+      tcp_packet(i, TCP_PEER_PORT, tcp_conns[slot]->lport, TCP_ACK);
+      expected[i] = tcp_conns[slot];
+    }
+    tcp_hit += input_batch(&wrong, UIP_PROTO_TCP);
+
+    for(i = 0; i < BATCH; i++) {
+      slot = random_rand() % size;
+      tcp_packet(i, TCP_PEER_PORT + 1, tcp_conns[slot]->lport, TCP_RST);
+    }
+    tcp_miss += input_batch(&wrong, 0);
+  }
+
+  printf("%5u %12.1f %13.1f %12.1f %13.1f %6lu\n", size,
+         (double)udp_hit * 1000 / PACKETS, (double)udp_miss * 1000 / PACKETS,
+         (double)tcp_hit * 1000 / PACKETS, (double)tcp_miss * 1000 / PACKETS,
+         wrong);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(conn_demux_bench_process, ev, data)
+{
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  uip_ip6addr(&peer, 0xfe80, 0, 0, 0, 0x0212, 0x4b00, 0, 1);
+  uip_ip6addr(&other, 0xfe80, 0, 0, 0, 0x0212, 0x4b00, 0, 2);
+
+  printf("conn-demux benchmark, lookup: %s\n",
+         UIP_CONN_HASH ? "port index" : "linear search");
+  printf("conns  udp hit(ns) udp miss(ns)  tcp hit(ns) tcp miss(ns) errors\n");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+
+/**
+ * \file
+ *         Checks how CSMA queues packets for its neighbors.
+ *
+ *         Packets are handed to CSMA faster than it sends them, and the
+ *         radio driver records the frames it is asked to send. The
+ *         frames queued for a neighbor must be sent in bursts of at
+ *         most CSMA_BURST_MAX_FRAMES frames, with the frame pending
+ *         bit set on all but the last one of each burst. With
+ *         priority classes, data packets must leave room in the queue
+ *         of each neighbor, and in the queue as a whole, for control
+ *         packets, which must be sent right after the packet that was
+ *         on its way when they were queued.
+ */
+
+#include "contiki.h"
+#include "net/mac/csma.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "dev/radio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAMES   64
+#define PAYLOAD_LEN  40
+#define CONTROL_TAG  0x80
+/* Marks the packets of the benchmark, as opposed to those of the
+   network stack */
+#define MAGIC        0xa5
+
+/* The frame pending bit of the first byte of the frame control field */
+#define FCF_FRAME_PENDING 0x10
+
+/* The frames sent by the radio driver, identified by the neighbor and
+   the tag at the end of their payload, after the magic byte */
+static struct {
+  uint8_t neighbor;
+  uint8_t tag;
+  uint8_t pending;
+} frames[MAX_FRAMES];
+static int frame_count;
+
+static int queued, done;
+static int control_dropped;
+
+static uint8_t frame[PACKETBUF_SIZE];
+static unsigned short frame_len;
+
+PROCESS(csma_queue_bench_process, "CSMA queue benchmark");
+AUTOSTART_PROCESSES(&csma_queue_bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+radio_init(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  frame_len = payload_len < sizeof(frame) ? payload_len : sizeof(frame);
+  memcpy(frame, payload, frame_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  if(frame_count < MAX_FRAMES && frame_len >= 3 &&
+     frame[frame_len - 3] == MAGIC) {
+    frames[frame_count].neighbor = frame[frame_len - 2];
+    frames[frame_count].tag = frame[frame_len - 1];
+    frames[frame_count].pending = (frame[0] & FCF_FRAME_PENDING) != 0;
+    frame_count++;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  prepare(payload, payload_len);
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_true(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_false(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver csma_bench_radio_driver = {
+  radio_init,
+  prepare,
+  transmit,
+  radio_send,
+  radio_read,
+  radio_true,
+  radio_false,
+  radio_false,
+  radio_true,
+  radio_true,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  done++;
+}
+/*---------------------------------------------------------------------------*/
+/* Hands a packet for the given neighbor to CSMA. Returns 0 if CSMA
+   did not queue it. */
+static int
+queue_packet(uint8_t neighbor, uint8_t tag)
+{
+  linkaddr_t addr;
+  uint8_t *payload;
+  int before;
+
+  packetbuf_clear();
+  payload = packetbuf_dataptr();
+  memset(payload, 0, PAYLOAD_LEN);
+  payload[PAYLOAD_LEN - 3] = MAGIC;
+  payload[PAYLOAD_LEN - 2] = neighbor;
+  payload[PAYLOAD_LEN - 1] = tag;
+  packetbuf_set_datalen(PAYLOAD_LEN);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = 2;
+  addr.u8[LINKADDR_SIZE - 1] = neighbor;
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+#if CSMA_WITH_PRIORITIES
+  packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY, tag & CONTROL_TAG ?
+                     PACKETBUF_ATTR_PRIORITY_CONTROL :
+                     PACKETBUF_ATTR_PRIORITY_DATA);
+#endif /* CSMA_WITH_PRIORITIES */
+
+  /* A packet that is not queued is reported at once */
+  before = done;
+  NETSTACK_MAC.send(packet_sent, NULL);
+  queued++;
+  if(done != before) {
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The position of the control packet among the frames sent to its
+   neighbor, 0 if it was not sent */
+static int
+control_position(void)
+{
+  int i, position;
+  uint8_t neighbor;
+
+  for(i = 0; i < frame_count; i++) {
+    if(frames[i].tag & CONTROL_TAG) {
+      break;
+    }
+  }
+  if(i == frame_count) {
+    return 0;
+  }
+  neighbor = frames[i].neighbor;
+  position = 0;
+  for(; i >= 0; i--) {
+    if(frames[i].neighbor == neighbor) {
+      position++;
+    }
+  }
+  return position;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_case(void)
+{
+  frame_count = 0;
+  queued = done = 0;
+  control_dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_case(const char *name, int data_queued, int data)
+{
+  printf("%-18s %5d/%-5d %-8s %8d\n", name, data_queued, data,
+         control_dropped ? "no" : "yes", control_position());
+}
+/*---------------------------------------------------------------------------*/
+/* Prints the number of frames in each burst, a burst ending with the
+   first frame without the frame pending bit */
+static void
+print_bursts(int packets)
+{
+  int i, length;
+
+  printf("%7d  ", packets);
+  length = 0;
+  for(i = 0; i < frame_count; i++) {
+    length++;
+    if(!frames[i].pending) {
+      printf(" %d", length);
+      length = 0;
+    }
+  }
+  if(length > 0) {
+    printf(" %d+", length);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_queue_bench_process, ev, data)
+{
+  static struct etimer et;
+  static int data_queued;
+  static int packets;
+  int i, n;
+
+  PROCESS_BEGIN();
+
+  printf("csma-queue benchmark, priority classes: %s\n",
+         CSMA_WITH_PRIORITIES ? "on" : "off");
+
+  /* Packets queued at once for one neighbor, and the bursts they are
+     sent in */
+  printf("packets   bursts\n");
+  for(packets = 1; packets <= 8; packets++) {
+    start_case();
+    for(i = 0; i < packets; i++) {
+      queue_packet(1, i);
+    }
+    while(done < queued) {
+      etimer_set(&et, CLOCK_SECOND / 8);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    }
+    print_bursts(packets);
+  }
+
+  printf("%-18s %11s %-8s %8s\n",
+         "case", "data queued", "control", "position");
+
+  /* A burst of data packets for one neighbor, then a control packet */
+  start_case();
+  data_queued = 0;
+  for(i = 0; i < 12; i++) {
+    data_queued += queue_packet(1, i);
+  }
+  control_dropped = !queue_packet(1, CONTROL_TAG);
+  while(done < queued) {
+    etimer_set(&et, CLOCK_SECOND / 8);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  print_case("neighbor queue", data_queued, 12);
+
+  /* Data packets for three neighbors, then a control packet for a
+     fourth one */
+  start_case();
+  data_queued = 0;
+  for(n = 1; n <= 3; n++) {
+    for(i = 0; i < 8; i++) {
+      data_queued += queue_packet(n, i);
+    }
+  }
+  control_dropped = !queue_packet(4, CONTROL_TAG);
+  while(done < queued) {
+    etimer_set(&et, CLOCK_SECOND / 8);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  print_case("whole queue", data_queued, 24);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
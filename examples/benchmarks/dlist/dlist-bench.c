@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compares the list and dlist libraries on the operations
+ *         that the route table performs for every forwarded packet.
+ *
+ *         A table of 500 routes is kept in least recently used
+ *         order. For every simulated packet a random route is moved
+ *         to the front of the table, and every eighth packet the
+ *         least recently used route is evicted and replaced by a new
+ *         one, as uip_ds6_route_add() does when the table is full.
+ *         Evictions are timed in batches, a batch after every eighth
+ *         batch of packets.
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/dlist.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUTES  500
+#define PACKETS (1UL << 18)
+#define BATCH   64
+
+struct route {
+  struct route *next;
+  struct route *prev;
+  struct dlist *list;
+  unsigned char payload[40];
+};
+
+static struct route routes[ROUTES];
+
+LIST(slist);
+DLIST(dlist);
+/*---------------------------------------------------------------------------*/
+PROCESS(dlist_bench_process, "dlist benchmark");
+AUTOSTART_PROCESSES(&dlist_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+pick(unsigned int *slots)
+{
+  unsigned int i;
+
+  for(i = 0; i < BATCH; i++) {
+    slots[i] = random_rand() % ROUTES;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_list(void)
+{
+  unsigned int i;
+  unsigned int slots[BATCH];
+  unsigned long p, mtf_us, evict_us, t;
+  struct route *r;
+
+  list_init(slist);
+  for(i = 0; i < ROUTES; i++) {
+    list_push(slist, &routes[i]);
+  }
+
+  mtf_us = evict_us = 0;
+  for(p = 0; p < PACKETS; p += BATCH) {
+    pick(slots);
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      r = &routes[slots[i]];
+      if(r != list_head(slist)) {
+        list_remove(slist, r);
+        list_push(slist, r);
+      }
+    }
+    mtf_us += cpu_usec() - t;
+    if((p / BATCH) % 8 != 0) {
+      continue;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      r = list_tail(slist);
+      list_remove(slist, r);
+      list_push(slist, r);
+    }
+    evict_us += cpu_usec() - t;
+  }
+
+  printf("list  %15.1f %11.1f %7d\n",
+         (double)mtf_us * 1000 / PACKETS,
+         (double)evict_us * 8000 / PACKETS, list_length(slist));
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_dlist(void)
+{
+  unsigned int i;
+  unsigned int slots[BATCH];
+  unsigned long p, mtf_us, evict_us, t;
+  struct route *r;
+
+  dlist_init(dlist);
+  for(i = 0; i < ROUTES; i++) {
+    dlist_push(dlist, &routes[i]);
+  }
+
+  mtf_us = evict_us = 0;
+  for(p = 0; p < PACKETS; p += BATCH) {
+    pick(slots);
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      r = &routes[slots[i]];
+      if(r != dlist_head(dlist)) {
+        dlist_push(dlist, r);
+      }
+    }
+    mtf_us += cpu_usec() - t;
+    if((p / BATCH) % 8 != 0) {
+      continue;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      r = dlist_tail(dlist);
+      dlist_remove(dlist, r);
+      dlist_push(dlist, r);
+    }
+    evict_us += cpu_usec() - t;
+  }
+
+  printf("dlist %15.1f %11.1f %7d\n",
+         (double)mtf_us * 1000 / PACKETS,
+         (double)evict_us * 8000 / PACKETS, dlist_length(dlist));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dlist_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("dlist benchmark, %u routes\n", ROUTES);
+  printf("       to-front(ns/op) evict(ns/op)  length\n");
+
+  run_list();
+  /* The list library leaves the prev pointers alone; clear them
+     before the elements are put on a doubly linked list. */
+  memset(routes, 0, sizeof(routes));
+  run_dlist();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
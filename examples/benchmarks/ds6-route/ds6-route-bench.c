@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of uip_ds6_route_add() and
+ *         uip_ds6_route_lookup() as a function of the number of
+ *         routes.
+ *
+ *         The route table is grown to 100, 500, 1000 and 5000
+ *         routes through 16 next hops: two prefix routes, the rest
+ *         host routes as on a storing mode RPL root. At each size, random destinations
+ *         are looked up as for forwarded packets, both destinations
+ *         that have a host route and destinations that do not and
+ *         would take the default route.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NEXTHOPS 16
+#define PREFIXES 2
+#define LOOKUPS  (1UL << 16)
+#define BATCH    64
+
+static uip_ipaddr_t nexthops[NEXTHOPS];
+static unsigned nroutes;
+
+static const unsigned sizes[] = { 100, 500, 1000, 5000 };
+/*---------------------------------------------------------------------------*/
+PROCESS(ds6_route_bench_process, "ds6-route benchmark");
+AUTOSTART_PROCESSES(&ds6_route_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, unsigned i)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0212, 0x4b00, i >> 16, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_nexthops(void)
+{
+  uip_lladdr_t lladdr;
+  unsigned i;
+
+  for(i = 0; i < NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[0] = 0x02;
+    lladdr.addr[sizeof(lladdr) - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0x0012, 0x4b00, 0x1000, i + 1);
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_prefixes(void)
+{
+  uip_ipaddr_t prefix;
+
+  uip_ip6addr(&prefix, 0xfd00, 0, 0, 1, 0, 0, 0, 0);
+  uip_ds6_route_add(&prefix, 64, &nexthops[0]);
+  uip_ip6addr(&prefix, 0xfd00, 0, 0, 0x100, 0, 0, 0, 0);
+  uip_ds6_route_add(&prefix, 56, &nexthops[1]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(unsigned size)
+{
+  uip_ipaddr_t addrs[BATCH];
+  uip_ds6_route_t *found[BATCH];
+  unsigned i, added, slots[BATCH];
+  unsigned long op, add_us, hit_us, miss_us, t;
+  unsigned long wrong = 0;
+
+  added = size - nroutes;
+  t = cpu_usec();
+  for(; nroutes < size; nroutes++) {
+    host_addr(&addrs[0], nroutes);
+    if(uip_ds6_route_add(&addrs[0], 128,
+                         &nexthops[nroutes % NEXTHOPS]) == NULL) {
+      wrong++;
+    }
+  }
+  add_us = cpu_usec() - t;
+
+  hit_us = miss_us = 0;
+  for(op = 0; op < LOOKUPS; op += BATCH) {
+    for(i = 0; i < BATCH; i++) {
+      slots[i] = PREFIXES + random_rand() % (size - PREFIXES);
+      host_addr(&addrs[i], slots[i]);
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      found[i] = uip_ds6_route_lookup(&addrs[i]);
+    }
+    hit_us += cpu_usec() - t;
+    for(i = 0; i < BATCH; i++) {
+      if(found[i] == NULL || found[i]->length != 128 ||
+         !uip_ipaddr_cmp(uip_ds6_route_nexthop(found[i]),
+                         &nexthops[slots[i] % NEXTHOPS])) {
+        wrong++;
+      }
+    }
+
+    for(i = 0; i < BATCH; i++) {
+      addrs[i].u16[1] = UIP_HTONS(0x0db8);
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      if(uip_ds6_route_lookup(&addrs[i]) != NULL) {
+        wrong++;
+      }
+    }
+    miss_us += cpu_usec() - t;
+  }
+
+  printf("%6u %12.1f %14.1f %15.1f %6lu\n", size,
+         (double)add_us * 1000 / added,
+         (double)hit_us * 1000 / LOOKUPS, (double)miss_us * 1000 / LOOKUPS,
+         wrong);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_route_bench_process, ev, data)
+{
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  add_nexthops();
+  add_prefixes();
+  nroutes = uip_ds6_route_num_routes();
+
+  printf("ds6-route benchmark, lookup: %s\n",
+         UIP_DS6_ROUTE_HASH_SIZE ? "hash index" : "linear search");
+  printf("routes  add(ns/op) hit(ns/op) miss(ns/op) errors\n");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
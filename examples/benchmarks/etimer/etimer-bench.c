@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of event timer processing as a function of
+ *         the number of pending event timers.
+ *
+ *         For each timer count, the benchmark first measures the cost
+ *         of re-arming every pending timer, and then keeps all timers
+ *         running periodically for a while and reports the CPU time
+ *         used per clock tick. The CPU time includes the idle cost of
+ *         the native main loop, which is given by the run with zero
+ *         timers.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAX_TIMERS   1024
+#define RUN_TIME     (2 * CLOCK_SECOND)
+#define REARM_ROUNDS 100
+
+static const unsigned int sizes[] = { 0, 16, 64, 256, MAX_TIMERS };
+
+static struct etimer timers[MAX_TIMERS];
+static struct etimer run_timer;
+/*---------------------------------------------------------------------------*/
+PROCESS(etimer_bench_process, "Event timer benchmark");
+AUTOSTART_PROCESSES(&etimer_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+random_interval(void)
+{
+  return 1 + random_rand() % CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_bench_process, ev, data)
+{
+  static unsigned long events;
+  static unsigned long start_cpu;
+  static unsigned long rearm_ns;
+  static clock_time_t start_ticks;
+  static clock_time_t ticks;
+  static unsigned int n;
+  static unsigned int s;
+  unsigned int i;
+  unsigned int r;
+
+  PROCESS_BEGIN();
+
+  printf("etimer benchmark, backend: %s\n",
+         ETIMER_WHEEL ? "timing wheel" : "list");
+  printf("timers re-arm(ns/op) events ticks cpu/tick(us)\n");
+
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    n = sizes[s];
+
+    rearm_ns = 0;
+    if(n > 0) {
+      start_cpu = cpu_usec();
+      for(r = 0; r < REARM_ROUNDS; r++) {
+        for(i = 0; i < n; i++) {
+          etimer_set(&timers[i], random_interval());
+        }
+      }
+      rearm_ns = (cpu_usec() - start_cpu) * 1000 / (REARM_ROUNDS * n);
+    }
+
+    events = 0;
+    etimer_set(&run_timer, RUN_TIME);
+    start_ticks = clock_time();
+    start_cpu = cpu_usec();
+    while(1) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      if(data == &run_timer) {
+        break;
+      }
+      events++;
+      etimer_restart(data);
+    }
+    ticks = clock_time() - start_ticks;
+
+    printf("%6u %14lu %6lu %5lu %13.2f\n", n, rearm_ns, events,
+           (unsigned long)ticks,
+           (double)(cpu_usec() - start_cpu) / (ticks ? ticks : 1));
+
+    for(i = 0; i < n; i++) {
+      etimer_stop(&timers[i]);
+    }
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks block splitting, coalescing and reallocation in
+ *         heapmem, and measures the cost of heapmem_alloc() and
+ *         heapmem_free() on a fragmented heap.
+ */
+
+#include "contiki.h"
+#include "lib/heapmem.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OPS      (1UL << 20)
+#define BATCH    64
+#define NBLOCKS  32
+#define MAX_SIZE 96
+
+#define ARENA_BYTES \
+  ((HEAPMEM_ARENA_SIZE / HEAPMEM_ALIGNMENT) * HEAPMEM_ALIGNMENT)
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static int failures;
+static void *blocks[NBLOCKS];
+/*---------------------------------------------------------------------------*/
+PROCESS(heapmem_bench_process, "heapmem benchmark");
+AUTOSTART_PROCESSES(&heapmem_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+check(int cond, const char *what, int line)
+{
+  if(!cond) {
+    printf("FAIL line %d: %s\n", line, what);
+    failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+get_stats(struct heapmem_stats *s)
+{
+  heapmem_stats(s);
+  CHECK(s->allocated + s->overhead + s->available == ARENA_BYTES);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(unsigned char *p, size_t len, unsigned char v)
+{
+  memset(p, v, len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+filled(const unsigned char *p, size_t len, unsigned char v)
+{
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    if(p[i] != v) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_split_coalesce(void)
+{
+  struct heapmem_stats s;
+  void *a, *b, *c;
+
+  get_stats(&s);
+  CHECK(s.chunks == 0);
+  CHECK(s.free_chunks == 1);
+
+  /* Each allocation splits the single free block. */
+  a = heapmem_alloc(32);
+  b = heapmem_alloc(32);
+  c = heapmem_alloc(32);
+  CHECK(a != NULL && b != NULL && c != NULL);
+  CHECK((char *)a < (char *)b && (char *)b < (char *)c);
+  get_stats(&s);
+  CHECK(s.chunks == 3);
+  CHECK(s.free_chunks == 1);
+
+  /* Freeing the middle block leaves a hole... */
+  CHECK(heapmem_free(b));
+  get_stats(&s);
+  CHECK(s.free_chunks == 2);
+
+  /* ...that is merged with its neighbors as they are freed. */
+  CHECK(heapmem_free(a));
+  get_stats(&s);
+  CHECK(s.free_chunks == 2);
+  CHECK(heapmem_free(c));
+  get_stats(&s);
+  CHECK(s.chunks == 0);
+  CHECK(s.free_chunks == 1);
+  CHECK(s.allocated == 0);
+
+  /* Pointers outside the heap are rejected. */
+  CHECK(!heapmem_free(&s));
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_realloc(void)
+{
+  struct heapmem_stats s;
+  unsigned char *a, *b, *p;
+
+  a = heapmem_alloc(32);
+  fill(a, 32, 0x11);
+
+  /* The block is followed by free space, so it grows in place. */
+  p = heapmem_realloc(a, 128);
+  CHECK(p == a);
+  CHECK(filled(p, 32, 0x11));
+  get_stats(&s);
+  CHECK(s.chunks == 1);
+  CHECK(s.free_chunks == 1);
+
+  /* Shrinking stays in place and gives the tail back. */
+  p = heapmem_realloc(a, 16);
+  CHECK(p == a);
+  CHECK(filled(p, 16, 0x11));
+  get_stats(&s);
+  CHECK(s.free_chunks == 1);
+
+  /* With an allocated block right after it, growing moves it. */
+  b = heapmem_alloc(32);
+  CHECK(b != NULL && b > a);
+  fill(b, 32, 0x22);
+  p = heapmem_realloc(a, 256);
+  CHECK(p != NULL && p != a);
+  CHECK(filled(p, 16, 0x11));
+  CHECK(filled(b, 32, 0x22));
+  get_stats(&s);
+  CHECK(s.chunks == 2);
+  CHECK(s.free_chunks == 2);
+
+  /* A failed reallocation leaves the block intact. */
+  CHECK(heapmem_realloc(p, HEAPMEM_ARENA_SIZE) == NULL);
+  CHECK(filled(p, 16, 0x11));
+
+  CHECK(heapmem_free(p));
+  CHECK(heapmem_free(b));
+  get_stats(&s);
+  CHECK(s.chunks == 0);
+  CHECK(s.free_chunks == 1);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(void)
+{
+  struct heapmem_stats s;
+  unsigned int slots[BATCH];
+  unsigned long op, alloc_us, free_us, t;
+  unsigned int i;
+
+  for(i = 0; i < NBLOCKS; i++) {
+    blocks[i] = heapmem_alloc(1 + random_rand() % MAX_SIZE);
+  }
+
+  alloc_us = free_us = 0;
+  for(op = 0; op < OPS; op += BATCH) {
+    for(i = 0; i < BATCH; i++) {
+      slots[i] = random_rand() % NBLOCKS;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      heapmem_free(blocks[slots[i]]);
+      blocks[slots[i]] = NULL;
+    }
+    free_us += cpu_usec() - t;
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      if(blocks[slots[i]] == NULL) {
+        blocks[slots[i]] = heapmem_alloc(1 + random_rand() % MAX_SIZE);
+      }
+    }
+    alloc_us += cpu_usec() - t;
+    get_stats(&s);
+  }
+
+  printf("alloc(ns/op) free(ns/op) chunks free_chunks largest_free/available\n");
+  printf("%12.1f %11.1f %6u %11u %9u/%u\n",
+         (double)alloc_us * 1000 / OPS, (double)free_us * 1000 / OPS,
+         s.chunks, s.free_chunks,
+         (unsigned)s.largest_free, (unsigned)s.available);
+
+  for(i = 0; i < NBLOCKS; i++) {
+    heapmem_free(blocks[i]);
+  }
+  get_stats(&s);
+  CHECK(s.chunks == 0);
+  CHECK(s.free_chunks == 1);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(heapmem_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("heapmem benchmark, arena %u bytes\n", (unsigned)ARENA_BYTES);
+
+  test_split_coalesce();
+  test_realloc();
+  printf("split/coalesce/realloc checks: %s\n", failures ? "FAILED" : "ok");
+
+  run();
+
+  exit(failures ? 1 : 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
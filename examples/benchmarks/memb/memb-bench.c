@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of memb_alloc() and memb_free() as a
+ *         function of the pool size.
+ *
+ *         Each pool is kept three quarters full while random blocks
+ *         are freed and allocated again, which is the typical pattern
+ *         for queue buffers and routing entries.
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OPS   (1UL << 20)
+#define BATCH 64
+
+struct block {
+  void *next;
+  unsigned char payload[28];
+};
+
+MEMB(pool16, struct block, 16);
+MEMB(pool64, struct block, 64);
+MEMB(pool256, struct block, 256);
+MEMB(pool1024, struct block, 1024);
+
+static struct memb *pools[] = { &pool16, &pool64, &pool256, &pool1024 };
+
+static void *blocks[1024];
+/*---------------------------------------------------------------------------*/
+PROCESS(memb_bench_process, "memb benchmark");
+AUTOSTART_PROCESSES(&memb_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(struct memb *m)
+{
+  unsigned int nused, i, j;
+  unsigned int slots[BATCH];
+  unsigned long op, alloc_us, free_us, t;
+
+  memb_init(m);
+  nused = m->num * 3 / 4;
+  for(i = 0; i < nused; i++) {
+    blocks[i] = memb_alloc(m);
+  }
+  /* Shuffle the free list so that free blocks end up spread over the
+     whole pool. */
+  for(i = 0; i < nused; i++) {
+    j = random_rand() % nused;
+    memb_free(m, blocks[j]);
+    blocks[j] = memb_alloc(m);
+  }
+
+  alloc_us = free_us = 0;
+  for(op = 0; op < OPS; op += BATCH) {
+    for(i = 0; i < BATCH; i++) {
+      slots[i] = random_rand() % nused;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      memb_free(m, blocks[slots[i]]);
+      blocks[slots[i]] = NULL;
+    }
+    free_us += cpu_usec() - t;
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      if(blocks[slots[i]] == NULL) {
+        blocks[slots[i]] = memb_alloc(m);
+      }
+    }
+    alloc_us += cpu_usec() - t;
+  }
+
+  printf("%5u %14.1f %13.1f %8d\n", m->num,
+         (double)alloc_us * 1000 / OPS, (double)free_us * 1000 / OPS,
+         memb_numfree(m));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_bench_process, ev, data)
+{
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  printf("memb benchmark, implementation: %s\n",
+         MEMB_FREELIST ? "free list" : "linear search");
+  printf(" pool alloc(ns/op) free(ns/op)  numfree\n");
+
+  for(i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    run(pools[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of neighbor table lookups as a function of
+ *         the number of neighbors.
+ *
+ *         The table is grown to 16, 64, 256 and 1024 neighbors. At
+ *         each size, random neighbors are looked up the way the MAC
+ *         and network layers do for every frame, both for addresses
+ *         that are in the table and for addresses that are not. The
+ *         table is then kept full while new neighbors are added,
+ *         which evicts the oldest one each time.
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOOKUPS  (1UL << 18)
+#define REPLACES 4096
+#define BATCH    64
+
+struct neighbor {
+  uint16_t rank;
+  uint8_t payload[14];
+};
+
+NBR_TABLE(struct neighbor, neighbors);
+
+static linkaddr_t addrs[NBR_TABLE_MAX_NEIGHBORS];
+static unsigned naddrs;
+static uint32_t next_addr;
+
+static const unsigned sizes[] = { 16, 64, 256, 1024 };
+/*---------------------------------------------------------------------------*/
+/* Replaces the RPL neighbor policy, which only evicts neighbors to make
+   room for RPL parents and children. */
+const linkaddr_t *
+nbr_table_bench_find_removable(nbr_table_reason_t reason, void *data)
+{
+  return nbr_table_get_lladdr(neighbors, nbr_table_head(neighbors));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(nbr_table_bench_process, "nbr-table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+/* Make a new address that shares its first half with every other
+   neighbor, as EUI-64 addresses from one vendor do. */
+static void
+make_addr(linkaddr_t *addr)
+{
+  uint32_t v;
+
+  next_addr += 1 + random_rand() % 251;
+  v = next_addr;
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x00;
+  addr->u8[1] = 0x12;
+  addr->u8[2] = 0x4b;
+  addr->u8[LINKADDR_SIZE - 4] = v >> 24;
+  addr->u8[LINKADDR_SIZE - 3] = v >> 16;
+  addr->u8[LINKADDR_SIZE - 2] = v >> 8;
+  addr->u8[LINKADDR_SIZE - 1] = v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(unsigned size)
+{
+  linkaddr_t missing[BATCH];
+  unsigned i, slots[BATCH];
+  unsigned long op, hit_us, miss_us, replace_us, t;
+  unsigned long found = 0, wrong = 0;
+  struct neighbor *n;
+
+  while(naddrs < size) {
+    make_addr(&addrs[naddrs]);
+    n = nbr_table_add_lladdr(neighbors, &addrs[naddrs],
+                             NBR_TABLE_REASON_UNDEFINED, NULL);
+    n->rank = naddrs++;
+  }
+
+  hit_us = miss_us = 0;
+  for(op = 0; op < LOOKUPS; op += BATCH) {
+    for(i = 0; i < BATCH; i++) {
+      slots[i] = random_rand() % size;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      n = nbr_table_get_from_lladdr(neighbors, &addrs[slots[i]]);
+      if(n == NULL || n->rank != slots[i]) {
+        wrong++;
+      }
+    }
+    hit_us += cpu_usec() - t;
+
+    for(i = 0; i < BATCH; i++) {
+      memcpy(&missing[i], &addrs[slots[i]], sizeof(linkaddr_t));
+      missing[i].u8[3] = 0xff;
+    }
+    t = cpu_usec();
+    for(i = 0; i < BATCH; i++) {
+      if(nbr_table_get_from_lladdr(neighbors, &missing[i]) != NULL) {
+        found++;
+      }
+    }
+    miss_us += cpu_usec() - t;
+  }
+
+  /* Only full tables evict. Evicted neighbors are not looked up
+     again, so addrs[] is left as is. */
+  replace_us = 0;
+  if(size == NBR_TABLE_MAX_NEIGHBORS) {
+    linkaddr_t addr;
+    t = cpu_usec();
+    for(i = 0; i < REPLACES; i++) {
+      make_addr(&addr);
+      if(nbr_table_add_lladdr(neighbors, &addr,
+                              NBR_TABLE_REASON_UNDEFINED, NULL) == NULL) {
+        wrong++;
+      }
+    }
+    replace_us = cpu_usec() - t;
+  }
+
+  printf("%5u %14.1f %15.1f", size,
+         (double)hit_us * 1000 / LOOKUPS, (double)miss_us * 1000 / LOOKUPS);
+  if(replace_us != 0) {
+    printf(" %18.1f", (double)replace_us * 1000 / REPLACES);
+  } else {
+    printf(" %18s", "-");
+  }
+  printf(" %6lu\n", wrong + found);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_bench_process, ev, data)
+{
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  nbr_table_register(neighbors, NULL);
+
+  printf("nbr-table benchmark, lookup: %s\n",
+         NBR_TABLE_HASH ? "hash index" : "linear search");
+  printf(" nbrs hit(ns/op) miss(ns/op) add+evict(ns/op) errors\n");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
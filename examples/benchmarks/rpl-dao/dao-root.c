@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         RPL root for the DAO benchmark.
+ *
+ *         Prints the number of downward routes whenever it changes.
+ *         On "repair" from the serial line, it drops all routes and
+ *         starts a global repair, so that every node has to announce
+ *         itself again. On "stats" it prints the number of DAOs and
+ *         DAO bytes it has sent.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#include "dev/serial-line.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(dao_root_process, "DAO benchmark root");
+AUTOSTART_PROCESSES(&dao_root_process);
+/*---------------------------------------------------------------------------*/
+static void
+create_rpl_dag(void)
+{
+  uip_ipaddr_t ipaddr;
+  rpl_dag_t *dag;
+
+  uip_ip6addr(&ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  if(dag != NULL) {
+    rpl_set_prefix(dag, &ipaddr, 64);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dao_root_process, ev, data)
+{
+  static struct etimer et;
+  static int routes;
+
+  PROCESS_BEGIN();
+
+  create_rpl_dag();
+
+  routes = 0;
+  etimer_set(&et, CLOCK_SECOND / 4);
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == PROCESS_EVENT_TIMER && data == &et) {
+      if(uip_ds6_route_num_routes() != routes) {
+        routes = uip_ds6_route_num_routes();
+        printf("routes %d\n", routes);
+      }
+      etimer_reset(&et);
+    } else if(ev == serial_line_event_message && data != NULL) {
+      if(strcmp(data, "repair") == 0) {
+        while(uip_ds6_route_head() != NULL) {
+          uip_ds6_route_rm(uip_ds6_route_head());
+        }
+        rpl_repair_root(RPL_DEFAULT_INSTANCE);
+        routes = 0;
+        printf("repair\n");
+      } else if(strcmp(data, "stats") == 0) {
+        printf("stats %u %lu\n", rpl_stats.dao_sent,
+               (unsigned long)rpl_stats.dao_bytes);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
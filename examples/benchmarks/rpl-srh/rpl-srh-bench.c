@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of source routing at a RPL non-storing
+ *         root as a function of the DODAG size.
+ *
+ *         DODAGs of 100, 500 and 1000 nodes are built as binary trees
+ *         below the root, from DAOs received in random order. At each
+ *         size the benchmark measures the cost of a DAO that refreshes
+ *         a known link, and of rpl_update_header() for packets sent
+ *         from the root to random nodes, as for forwarded downward
+ *         traffic. The latter is measured on a stable DODAG and with
+ *         one node switching parent every 16 packets.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_NODES 1000
+#define FANOUT    2
+#define PACKETS   (1UL << 16)
+#define CHURN     16
+#define LIFETIME  3600
+#define UDP_LEN   16
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_RH_BUF ((struct uip_routing_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+static rpl_dag_t *dag;
+static uip_ipaddr_t root_addr;
+/* parent[i] is the parent of node i, 0 being the root */
+static uint16_t parent[MAX_NODES + 1];
+static uint16_t order[MAX_NODES];
+static unsigned nnodes;
+static unsigned long errors;
+
+static const unsigned sizes[] = { 100, 500, 1000 };
+/*---------------------------------------------------------------------------*/
+PROCESS(rpl_srh_bench_process, "RPL source routing benchmark");
+AUTOSTART_PROCESSES(&rpl_srh_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_usec(void)
+{
+  return (unsigned long)((double)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_addr(uip_ipaddr_t *addr, unsigned i)
+{
+  if(i == 0) {
+    uip_ipaddr_copy(addr, &root_addr);
+  } else {
+    uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0212, 0x4b00, 0, i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dao(unsigned i)
+{
+  uip_ipaddr_t child, par;
+
+  node_addr(&child, i);
+  node_addr(&par, parent[i]);
+  if(rpl_ns_update_node(dag, &child, &par, LIFETIME) == NULL) {
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+depth(unsigned i)
+{
+  unsigned d;
+
+  for(d = 0; i != 0; i = parent[i]) {
+    d++;
+  }
+  return d;
+}
+/*---------------------------------------------------------------------------*/
+static void
+move_random_node(void)
+{
+  unsigned i, p;
+
+  /* Give a node below the first level a new parent at the same depth
+     as its current one, which cannot be below the node itself */
+  i = FANOUT + 1 + random_rand() % (nnodes - FANOUT);
+  do {
+    p = 1 + random_rand() % nnodes;
+  } while(p == i || depth(p) != depth(parent[i]));
+  parent[i] = p;
+  dao(i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(unsigned dest)
+{
+  unsigned first_hop, hops;
+  uip_ipaddr_t addr;
+
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN + UDP_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UDP_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &root_addr);
+  node_addr(&UIP_IP_BUF->destipaddr, dest);
+  uip_len = UIP_IPH_LEN + UDP_LEN;
+  uip_ext_len = 0;
+
+  if(!rpl_update_header()) {
+    errors++;
+    return;
+  }
+
+  /* The packet must go to the first hop with one address per further hop */
+  hops = 0;
+  for(first_hop = dest; parent[first_hop] != 0; first_hop = parent[first_hop]) {
+    hops++;
+  }
+  node_addr(&addr, first_hop);
+  if(!uip_ipaddr_cmp(&addr, &UIP_IP_BUF->destipaddr)) {
+    errors++;
+  } else if(hops > 0 && (UIP_IP_BUF->proto != UIP_PROTO_ROUTING ||
+                         UIP_RH_BUF->seg_left != hops)) {
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(unsigned size)
+{
+  unsigned i, j, tmp, added;
+  unsigned long op, t, add_us, dao_us, srh_us, churn_us;
+
+  /* New nodes announce themselves in random order */
+  added = size - nnodes;
+  for(i = 0; i < added; i++) {
+    order[i] = nnodes + 1 + i;
+    parent[nnodes + 1 + i] = (nnodes + i) / FANOUT;
+  }
+  for(i = added - 1; i > 0; i--) {
+    j = random_rand() % (i + 1);
+    tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+  t = cpu_usec();
+  for(i = 0; i < added; i++) {
+    dao(order[i]);
+  }
+  add_us = cpu_usec() - t;
+  nnodes = size;
+
+  t = cpu_usec();
+  for(i = 1; i <= nnodes; i++) {
+    dao(i);
+  }
+  dao_us = cpu_usec() - t;
+
+  t = cpu_usec();
+  for(op = 0; op < PACKETS; op++) {
+    send_packet(1 + random_rand() % nnodes);
+  }
+  srh_us = cpu_usec() - t;
+
+  t = cpu_usec();
+  for(op = 0; op < PACKETS; op++) {
+    if(op % CHURN == 0) {
+      move_random_node();
+    }
+    send_packet(1 + random_rand() % nnodes);
+  }
+  churn_us = cpu_usec() - t;
+
+  printf("%5u %8.1f %8.1f %9.1f %10.1f %6lu\n", size,
+         (double)add_us * 1000 / added, (double)dao_us * 1000 / nnodes,
+         (double)srh_us * 1000 / PACKETS, (double)churn_us * 1000 / PACKETS,
+         errors);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rpl_srh_bench_process, ev, data)
+{
+  uip_ipaddr_t prefix;
+  unsigned int i;
+
+  PROCESS_BEGIN();
+
+  uip_ip6addr(&prefix, 0xfd00, 0, 0, 0, 0, 0, 0, 0);
+  uip_ip6addr(&root_addr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  uip_ds6_addr_add(&root_addr, 0, ADDR_MANUAL);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &root_addr);
+  if(dag == NULL || !rpl_set_prefix(dag, &prefix, 64)) {
+    printf("rpl-srh benchmark: could not create the DODAG\n");
+    exit(1);
+  }
+
+  printf("rpl-srh benchmark, node lookup: %s, source route cache: %u\n",
+         RPL_NS_HASH_SIZE ? "hash index" : "linear search",
+         RPL_NS_SRH_CACHE_SIZE);
+  printf("nodes  new(ns)  dao(ns)  srh(ns)  churn(ns) errors\n");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+
+/**
+ * \file
+ *         Checks and measures the reassembly and the forwarding of
+ *         fragmented 6LoWPAN datagrams.
+ *
+ *         The MAC driver records the fragments sent for a datagram,
+ *         which are then fed back to the node as received frames, in
+ *         different orders. Datagrams addressed to the node must be
+ *         reassembled intact, whatever the order and duplicates of
+ *         their fragments. Datagrams to be forwarded must reach the
+ *         next hop as fragments that it reassembles intact, with the
+ *         hop limit decremented. For the latter, the benchmark also
+ *         counts the frames received before the first one is sent on.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/rime/rime.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS     200
+#define MAX_FRAMES 64
+#define MIN_LEN    48
+#define MAX_LEN    UIP_CONF_BUFFER_SIZE
+
+/* The offset byte of a FRAGN header */
+#define FRAGN_OFFSET 4
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+enum order {
+  IN_ORDER,
+  SHUFFLED,
+  DUPLICATES,
+  OVERLAP,
+  REVERSED,
+  FIRST_LAST
+};
+
+static const char *order_names[] = {
+  "in order", "shuffled", "duplicates", "overlap",
+  "reversed", "first last"
+};
+
+/* The frames sent by the node */
+struct capture {
+  uint8_t frame[MAX_FRAMES][PACKETBUF_SIZE];
+  uint16_t len[MAX_FRAMES];
+  linkaddr_t receiver[MAX_FRAMES];
+  int count;
+  /* The number of frames delivered to the node before the first one
+     was sent */
+  int first_after;
+};
+
+static struct capture sent, forwarded;
+static struct capture *capture;
+static int delivered;
+
+/* The datagram expected from sicslowpan, when checking */
+static uint8_t expected[MAX_LEN];
+static uint16_t expected_len;
+static int checking;
+static int intact, corrupt;
+
+static uip_ipaddr_t source_addr, local_addr, remote_addr, next_hop_addr;
+static uip_lladdr_t next_hop_lladdr;
+
+PROCESS(sicslowpan_frag_bench_process, "6LoWPAN fragmentation benchmark");
+AUTOSTART_PROCESSES(&sicslowpan_frag_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(mac_callback_t sent_callback, void *ptr)
+{
+  if(capture != NULL && capture->count < MAX_FRAMES) {
+    if(capture->count == 0) {
+      capture->first_after = delivered;
+    }
+    capture->len[capture->count] =
+      packetbuf_copyto(capture->frame[capture->count]);
+    linkaddr_copy(&capture->receiver[capture->count],
+                  packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    capture->count++;
+  }
+  /* Reuse packetbuf, as a MAC would for the next frame in its queue */
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0xa5, 100);
+  packetbuf_set_datalen(100);
+  mac_call_sent_callback(sent_callback, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+packet_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver frag_mac_driver = {
+  "frag-bench",
+  init,
+  send_packet,
+  packet_input,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* Called by sicslowpan with each datagram passed up to uIP */
+static void
+datagram_input(void)
+{
+  if(!checking) {
+    return;
+  }
+  if(uip_len == expected_len &&
+     memcmp(UIP_IP_BUF, expected, expected_len) == 0) {
+    intact++;
+  } else {
+    corrupt++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+frame_output(int mac_status)
+{
+}
+/*---------------------------------------------------------------------------*/
+RIME_SNIFFER(datagram_sniffer, datagram_input, frame_output);
+/*---------------------------------------------------------------------------*/
+/* Sends a random UDP datagram to the given address and records its
+   fragments */
+static void
+send_datagram(const uip_ipaddr_t *dest)
+{
+  struct uip_ip_hdr *ip = UIP_IP_BUF;
+  uip_lladdr_t lladdr;
+  uint16_t len;
+  int i;
+
+  len = MIN_LEN + random_rand() % (MAX_LEN - MIN_LEN + 1);
+  memset(ip, 0, UIP_IPUDPH_LEN);
+  ip->vtc = 0x60;
+  ip->len[0] = (len - UIP_IPH_LEN) >> 8;
+  ip->len[1] = (len - UIP_IPH_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 64;
+  uip_ipaddr_copy(&ip->srcipaddr, &source_addr);
+  uip_ipaddr_copy(&ip->destipaddr, dest);
+  for(i = UIP_IPH_LEN; i < len; i++) {
+    ((uint8_t *)ip)[i] = random_rand();
+  }
+  /* The UDP length */
+  ((uint8_t *)ip)[UIP_IPH_LEN + 4] = (len - UIP_IPH_LEN) >> 8;
+  ((uint8_t *)ip)[UIP_IPH_LEN + 5] = (len - UIP_IPH_LEN) & 0xff;
+  memcpy(expected, ip, len);
+  expected_len = len;
+  uip_len = len;
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[0] = 2;
+  lladdr.addr[7] = 1;
+  sent.count = 0;
+  capture = &sent;
+  tcpip_output(&lladdr);
+  capture = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver_frame(struct capture *c, int i, uint8_t sender_id)
+{
+  linkaddr_t sender;
+
+  packetbuf_clear();
+  packetbuf_copyfrom(c->frame[i], c->len[i]);
+  memset(&sender, 0, sizeof(sender));
+  sender.u8[0] = 2;
+  sender.u8[LINKADDR_SIZE - 1] = sender_id;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &c->receiver[i]);
+  delivered++;
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+/* Feeds the recorded frames back to the node, in the given order */
+static void
+deliver(struct capture *c, enum order order, uint8_t sender_id)
+{
+  static int sequence[2 * MAX_FRAMES];
+  int n, i, j, t;
+
+  n = 0;
+  switch(order) {
+  case IN_ORDER:
+    for(i = 0; i < c->count; i++) {
+      sequence[n++] = i;
+    }
+    break;
+  case OVERLAP:
+    if(c->count <= 2) {
+      for(i = 0; i < c->count; i++) {
+        sequence[n++] = i;
+      }
+      break;
+    }
+    /* The first two fragments, then a copy of the second one, one unit
+       further, which overlaps it. The datagram is dropped, the rest of
+       it is not sent. */
+    memcpy(c->frame[MAX_FRAMES - 1], c->frame[1], c->len[1]);
+    c->len[MAX_FRAMES - 1] = c->len[1];
+    linkaddr_copy(&c->receiver[MAX_FRAMES - 1], &c->receiver[1]);
+    c->frame[MAX_FRAMES - 1][FRAGN_OFFSET]++;
+    sequence[n++] = 0;
+    sequence[n++] = 1;
+    sequence[n++] = MAX_FRAMES - 1;
+    break;
+  case SHUFFLED:
+  case DUPLICATES:
+    for(i = 0; i < c->count; i++) {
+      sequence[n++] = i;
+    }
+    for(i = n - 1; i > 0; i--) {
+      j = random_rand() % (i + 1);
+      t = sequence[i];
+      sequence[i] = sequence[j];
+      sequence[j] = t;
+    }
+    if(order == DUPLICATES) {
+      /* Repeat a third of the fragments before the last one */
+      t = sequence[--n];
+      for(i = 0; i < c->count; i++) {
+        if(i != t && random_rand() % 3 == 0) {
+          sequence[n++] = i;
+        }
+      }
+      sequence[n++] = t;
+    }
+    break;
+  case REVERSED:
+    sequence[n++] = 0;
+    for(i = c->count - 1; i > 0; i--) {
+      sequence[n++] = i;
+    }
+    break;
+  case FIRST_LAST:
+    for(i = 1; i < c->count; i++) {
+      sequence[n++] = i;
+    }
+    sequence[n++] = 0;
+    break;
+  }
+
+  delivered = 0;
+  for(i = 0; i < n; i++) {
+    deliver_frame(c, sequence[i], sender_id);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reassemble(enum order order)
+{
+  struct sicslowpan_stats before = sicslowpan_stats;
+  int round;
+
+  intact = corrupt = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    send_datagram(&local_addr);
+    checking = 1;
+    deliver(&sent, order, 1);
+    checking = 0;
+  }
+  printf("%-12s %5d/%d %7d %10u %8u\n", order_names[order],
+         intact, ROUNDS, corrupt,
+         sicslowpan_stats.reass_duplicates - before.reass_duplicates,
+         sicslowpan_stats.reass_overlaps - before.reass_overlaps);
+}
+/*---------------------------------------------------------------------------*/
+static void
+forward(enum order order)
+{
+  unsigned long first_after = 0;
+  int round, i, wrong_hop = 0;
+
+  intact = corrupt = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    send_datagram(&remote_addr);
+    forwarded.count = 0;
+    capture = &forwarded;
+    deliver(&sent, order, 1);
+    capture = NULL;
+    if(forwarded.count == 0) {
+      continue;
+    }
+    first_after += forwarded.first_after;
+    for(i = 0; i < forwarded.count; i++) {
+      if(memcmp(&forwarded.receiver[i], &next_hop_lladdr,
+                sizeof(linkaddr_t)) != 0) {
+        wrong_hop++;
+      }
+    }
+
+    /* Reassemble the forwarded fragments as the next hop would */
+    uip_ds6_addr_add(&remote_addr, 0, ADDR_MANUAL);
+    expected[7]--;
+    checking = 1;
+    deliver(&forwarded, IN_ORDER, 2);
+    checking = 0;
+    uip_ds6_addr_rm(uip_ds6_addr_lookup(&remote_addr));
+  }
+  printf("%-12s %5d/%d %7d %9d %12.2f\n", order_names[order],
+         intact, ROUNDS, corrupt, wrong_hop,
+         (double)first_after / ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sicslowpan_frag_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  rime_sniffer_add(&datagram_sniffer);
+
+  uip_ip6addr(&source_addr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&local_addr, 0xfd00, 0, 0, 0, 0, 0, 0, 2);
+  uip_ip6addr(&remote_addr, 0xfd00, 0, 0, 0, 0, 0, 0, 3);
+  uip_ip6addr(&next_hop_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 3);
+  memset(&next_hop_lladdr, 0, sizeof(next_hop_lladdr));
+  next_hop_lladdr.addr[0] = 2;
+  next_hop_lladdr.addr[sizeof(next_hop_lladdr) - 1] = 3;
+  uip_ds6_addr_add(&local_addr, 0, ADDR_MANUAL);
+  uip_ds6_nbr_add(&next_hop_addr, &next_hop_lladdr, 1, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  uip_ds6_route_add(&remote_addr, 128, &next_hop_addr);
+
+  printf("sicslowpan-frag benchmark, fragment forwarding: %s\n",
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+         SICSLOWPAN_CONF_FRAG_FORWARDING ? "on" : "off"
+#else
+         "off"
+#endif
+         );
+
+  printf("reassembly   intact corrupt duplicates overlaps\n");
+  reassemble(IN_ORDER);
+  reassemble(SHUFFLED);
+  reassemble(DUPLICATES);
+  reassemble(OVERLAP);
+
+  printf("forwarding   intact corrupt wrong-hop first-after\n");
+  forward(IN_ORDER);
+  forward(REVERSED);
+  forward(FIRST_LAST);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
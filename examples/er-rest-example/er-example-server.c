@@ -42,6 +42,7 @@
 #include "contiki.h"
 #include "contiki-net.h"
 #include "rest-engine.h"
+#include "net/rpl/rpl-trace.h"
 
 #if PLATFORM_HAS_BUTTON
 #include "dev/button-sensor.h"
@@ -72,6 +73,9 @@ extern resource_t
   res_event,
   res_sub,
   res_b1_sep_b2;
+#if RPL_WITH_TRACE
+extern resource_t res_rpl_trace;
+#endif
 #if PLATFORM_HAS_LEDS
 extern resource_t res_leds, res_toggle;
 #endif
@@ -139,6 +143,9 @@ PROCESS_THREAD(er_example_server, ev, data)
 /*  rest_activate_resource(&res_event, "sensors/button"); */
 /*  rest_activate_resource(&res_sub, "test/sub"); */
 /*  rest_activate_resource(&res_b1_sep_b2, "test/b1sepb2"); */
+#if RPL_WITH_TRACE
+  rest_activate_resource(&res_rpl_trace, "debug/rpl-trace");
+#endif
 #if PLATFORM_HAS_LEDS
 /*  rest_activate_resource(&res_leds, "actuators/leds"); */
   rest_activate_resource(&res_toggle, "actuators/toggle");
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      RPL event trace resource
+ *
+ *      GET returns the first and next sequence numbers of the trace,
+ *      followed by as many events as fit, one per line, starting from
+ *      the oldest one or from ?since=<seqno>. Events are written as
+ *      "seqno time event addr rank arg". GET with ?counts=1 returns the
+ *      message and event counters instead, in rpl-trace.h order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rest-engine.h"
+#include "net/rpl/rpl-trace.h"
+
+#if RPL_WITH_TRACE
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+RESOURCE(res_rpl_trace,
+         "title=\"RPL event trace: ?since=seqno, ?counts=1\";rt=\"Text\"",
+         res_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  const struct rpl_trace_entry *e;
+  const char *since = NULL;
+  const char *counts = NULL;
+  char line[48];
+  uint16_t seqno;
+  int length;
+  int n;
+  int i;
+
+  if(preferred_size > REST_MAX_CHUNK_SIZE) {
+    preferred_size = REST_MAX_CHUNK_SIZE;
+  }
+  length = 0;
+
+  if(REST.get_query_variable(request, "counts", &counts)) {
+    for(i = 0; i < RPL_TRACE_EVENT_NUM; i++) {
+      n = snprintf(line, sizeof(line), i == 0 ? "%u" : " %u",
+                   rpl_trace_count(i));
+      if(length + n > preferred_size) {
+        break;
+      }
+      memcpy(buffer + length, line, n);
+      length += n;
+    }
+  } else {
+    seqno = rpl_trace_first();
+    if(REST.get_query_variable(request, "since", &since)) {
+      seqno = (uint16_t)atoi(since);
+      /* Start from the oldest event if the requested ones are gone */
+      if((uint16_t)(rpl_trace_next() - seqno) >
+         (uint16_t)(rpl_trace_next() - rpl_trace_first())) {
+        seqno = rpl_trace_first();
+      }
+    }
+    n = snprintf(line, sizeof(line), "%u %u\n",
+                 rpl_trace_first(), rpl_trace_next());
+    if(n <= preferred_size) {
+      memcpy(buffer, line, n);
+      length = n;
+    }
+    for(; seqno != rpl_trace_next(); seqno++) {
+      e = rpl_trace_get(seqno);
+      if(e == NULL) {
+        continue;
+      }
+      n = snprintf(line, sizeof(line), "%u %lu %s %02x%02x %u %u\n",
+                   e->seqno, (unsigned long)e->time,
+                   rpl_trace_event_name(e->event), e->addr[0], e->addr[1],
+                   e->rank, e->arg);
+      if(length + n > preferred_size) {
+        break;
+      }
+      memcpy(buffer + length, line, n);
+      length += n;
+    }
+  }
+
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, length);
+}
+#endif /* RPL_WITH_TRACE */
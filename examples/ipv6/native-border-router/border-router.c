@@ -258,6 +258,12 @@ border_router_print_stat()
 {
   printf("bytes received over SLIP: %ld\n", slip_received);
   printf("bytes sent over SLIP: %ld\n", slip_sent);
+#if TCPIP_INPUT_QUEUE
+  printf("tun packets queued: %lu, dropped: %lu, max queue depth: %u\n",
+         (unsigned long)tcpip_input_stats.packets,
+         (unsigned long)tcpip_input_stats.dropped,
+         tcpip_input_stats.max_depth);
+#endif /* TCPIP_INPUT_QUEUE */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -39,6 +39,9 @@
 #undef UIP_CONF_BUFFER_SIZE
 #define UIP_CONF_BUFFER_SIZE    1280
 
+/* Queue bursts of packets from the tun device */
+#define TCPIP_CONF_INPUT_QUEUE     8
+
 #undef UIP_CONF_RECEIVE_WINDOW
 #define UIP_CONF_RECEIVE_WINDOW  60
 
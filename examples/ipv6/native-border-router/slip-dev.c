@@ -283,10 +283,19 @@ serial_input(FILE *inslip)
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
 static struct timer send_delay_timer;
+/* Wakes the main loop up when the send delay has passed */
+static struct ctimer send_delay_wakeup;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
 static void
+send_delay_expired(void *ptr)
+{
+  /* Nothing to do here: set_fd() is asked again after every event and
+     will now let the next packet be written. */
+}
+/*---------------------------------------------------------------------------*/
+static void
 slip_send(int fd, unsigned char c)
 {
   if(slip_end >= sizeof(slip_buf)) {
@@ -346,6 +355,7 @@ slip_flushbuf(int fd)
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
           timer_set(&send_delay_timer, send_delay);
+          ctimer_set(&send_delay_wakeup, send_delay, send_delay_expired, NULL);
         }
       }
     }
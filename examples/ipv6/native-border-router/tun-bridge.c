@@ -209,6 +209,11 @@ tun_init()
   tunfd = tun_alloc(slip_config_tundev);
   if(tunfd == -1) err(1, "main: open");
 
+#if TCPIP_INPUT_QUEUE
+  /* Read until the device is empty or the input queue is full */
+  fcntl(tunfd, F_SETFL, fcntl(tunfd, F_GETFL) | O_NONBLOCK);
+#endif /* TCPIP_INPUT_QUEUE */
+
   select_set_callback(tunfd, &tun_select_callback);
 
   fprintf(stderr, "opened %s device ``/dev/%s''\n",
@@ -237,7 +242,8 @@ int
 tun_input(unsigned char *data, int maxlen)
 {
   int size;
-  if((size = read(tunfd, data, maxlen)) == -1)
+  if((size = read(tunfd, data, maxlen)) == -1 &&
+     errno != EAGAIN && errno != EWOULDBLOCK)
     err(1, "tun_input: read");
   return size;
 }
@@ -294,10 +300,32 @@ handle_fd(fd_set *rset, fd_set *wset)
     int size;
 
     if(FD_ISSET(tunfd, rset)) {
+#if TCPIP_INPUT_QUEUE
+      uint8_t *buf;
+      int n;
+
+      /* Queue a burst of packets for tcpip_process, or a single one
+         when packets are delayed */
+      for(n = 0; n < TCPIP_INPUT_QUEUE; n++) {
+        buf = tcpip_input_reserve();
+        if(buf == NULL) {
+          break;
+        }
+        size = tun_input(&buf[UIP_LLH_LEN], UIP_BUFSIZE - UIP_LLH_LEN);
+        if(size <= 0) {
+          break;
+        }
+        tcpip_input_commit(size);
+        if(slip_config_basedelay) {
+          break;
+        }
+      }
+#else /* TCPIP_INPUT_QUEUE */
       size = tun_input(&uip_buf[UIP_LLH_LEN], sizeof(uip_buf));
       /* printf("TUN data incoming read:%d\n", size); */
       uip_len = size;
       tcpip_input();
+#endif /* TCPIP_INPUT_QUEUE */
 
       if(slip_config_basedelay) {
         struct timeval tv;
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Measures the throughput of a bulk transfer over a tcp_socket
+ *         across a multi-hop RPL network, with and without a send
+ *         window of several segments.
+ *
+ *         Node 1 is the RPL root and runs the sink, which listens on
+ *         SERVER_PORT and checks every byte it receives. Node
+ *         SOURCE_ID connects to the root once it has joined the DAG,
+ *         sends TOTAL_BYTES and reports the time it took until the
+ *         last byte was acknowledged. All other nodes only route.
+ *         Nodes are told apart by the last byte of their link-layer
+ *         address, which is the node ID in Cooja.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+
+#include <stdio.h>
+
+#define SERVER_PORT 8080
+
+#ifndef SOURCE_ID
+#define SOURCE_ID 4
+#endif /* SOURCE_ID */
+
+#ifndef TOTAL_BYTES
+#define TOTAL_BYTES 16384UL
+#endif /* TOTAL_BYTES */
+
+static struct tcp_socket socket;
+
+#define INPUTBUFSIZE UIP_TCP_MSS
+static uint8_t inputbuf[INPUTBUFSIZE];
+
+#define OUTPUTBUFSIZE (16 * UIP_TCP_MSS)
+static uint8_t outputbuf[OUTPUTBUFSIZE];
+
+static unsigned long bytes;
+static unsigned long errors;
+static clock_time_t start;
+
+#define NODE_ID linkaddr_node_addr.u8[LINKADDR_SIZE - 1]
+
+PROCESS(tcp_throughput_process, "TCP throughput process");
+AUTOSTART_PROCESSES(&tcp_throughput_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(unsigned long offset)
+{
+  return (offset * 7 + (offset >> 8)) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *s, void *ptr,
+      const uint8_t *inputptr, int inputdatalen)
+{
+  int i;
+
+  for(i = 0; i < inputdatalen; i++) {
+    if(inputptr[i] != pattern(bytes + i)) {
+      errors++;
+    }
+  }
+  bytes += inputdatalen;
+  if(bytes == TOTAL_BYTES) {
+    printf("tcp-throughput: received %lu bytes, %lu errors\n",
+           bytes, errors);
+  }
+  return 0; /* all data consumed */
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(void)
+{
+  uint8_t buf[32];
+  int len, i;
+
+  while(bytes < TOTAL_BYTES && tcp_socket_max_sendlen(&socket) > 0) {
+    len = MIN(sizeof(buf), TOTAL_BYTES - bytes);
+    for(i = 0; i < len; i++) {
+      buf[i] = pattern(bytes + i);
+    }
+    bytes += tcp_socket_send(&socket, buf, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr,
+      tcp_socket_event_t ev)
+{
+  unsigned long ms;
+
+  if(NODE_ID != SOURCE_ID) {
+    if(ev == TCP_SOCKET_CONNECTED) {
+      bytes = errors = 0;
+    }
+    return;
+  }
+
+  if(ev == TCP_SOCKET_CONNECTED) {
+    start = clock_time();
+    fill();
+  } else if(ev == TCP_SOCKET_DATA_SENT) {
+    fill();
+    if(bytes == TOTAL_BYTES &&
+       tcp_socket_max_sendlen(&socket) == OUTPUTBUFSIZE) {
+      ms = (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND;
+      printf("tcp-throughput: sent %lu bytes in %lu ms, %lu bytes/s, window %u\n",
+             bytes, ms, ms > 0 ? bytes * 1000 / ms : 0, SEND_WINDOW);
+      tcp_socket_close(&socket);
+    }
+  } else {
+    printf("tcp-throughput: event %d\n", ev);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_root(void)
+{
+  uip_ipaddr_t ipaddr;
+  rpl_dag_t *dag;
+
+  uip_ip6addr(&ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_MANUAL);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  uip_ip6addr(&ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+  rpl_set_prefix(dag, &ipaddr, 64);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_throughput_process, ev, data)
+{
+  static struct etimer et;
+  rpl_dag_t *dag;
+
+  PROCESS_BEGIN();
+
+  tcp_socket_register(&socket, NULL,
+                      inputbuf, sizeof(inputbuf),
+                      outputbuf, sizeof(outputbuf),
+                      input, event);
+
+  if(NODE_ID == 1) {
+    set_root();
+    tcp_socket_listen(&socket, SERVER_PORT);
+    printf("tcp-throughput: sink listening on %d\n", SERVER_PORT);
+  } else if(NODE_ID == SOURCE_ID) {
+    /* Wait for the route to the root to settle before connecting. */
+    do {
+      etimer_set(&et, 10 * CLOCK_SECOND);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      dag = rpl_get_any_dag();
+    } while(dag == NULL);
+
+    printf("tcp-throughput: connecting to the root\n");
+    tcp_socket_connect(&socket, &dag->dag_id, SERVER_PORT);
+  }
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
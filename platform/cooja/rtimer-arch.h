@@ -43,4 +43,9 @@ int rtimer_arch_check(void);
 int rtimer_arch_pending(void);
 rtimer_clock_t rtimer_arch_next(void);
 
+/* Real-time tasks are run by rtimer_arch_check() from the main loop of
+   the mote, never from interrupt context */
+#define RTIMER_ARCH_INTERRUPTS_DISABLE()   0
+#define RTIMER_ARCH_INTERRUPTS_RESTORE(s)  ((void)(s))
+
 #endif /* RTIMER_ARCH_H_ */
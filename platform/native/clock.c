@@ -62,6 +62,16 @@ clock_seconds(void)
   return tv.tv_sec;
 }
 /*---------------------------------------------------------------------------*/
+unsigned long
+native_clock_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
 void
 clock_delay(unsigned int d)
 {
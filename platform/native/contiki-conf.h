@@ -124,6 +124,11 @@ typedef unsigned short uip_stats_t;
 #ifndef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES   30
 #endif /* UIP_CONF_MAX_ROUTES */
+/* Cache a compiled source route for every node known to a RPL
+   non-storing root */
+#ifndef RPL_NS_CONF_SRH_CACHE_SIZE
+#define RPL_NS_CONF_SRH_CACHE_SIZE RPL_NS_LINK_NUM
+#endif /* RPL_NS_CONF_SRH_CACHE_SIZE */
 
 #define UIP_CONF_ND6_SEND_RA		0
 #define UIP_CONF_ND6_REACHABLE_TIME     600000
@@ -144,6 +149,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_RECEIVE_WINDOW  48
 #define UIP_CONF_TCP_MSS         48
 #define UIP_CONF_UDP_CONNS       12
+#ifndef UIP_CONF_CONN_HASH
+#define UIP_CONF_CONN_HASH       1
+#endif /* UIP_CONF_CONN_HASH */
 #define UIP_CONF_FWCACHE_SIZE    30
 #define UIP_CONF_BROADCAST       1
 #define UIP_ARCH_IPCHKSUM        1
@@ -270,4 +278,52 @@ int strcasecmp(const char*, const char*);
 #include PROJECT_CONF_H
 #endif /* PROJECT_CONF_H */
 
+/* Give timers and the IP stack a separate high-priority event lane,
+   so that they are not held up behind bursts of ordinary events. */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 16
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/* NATIVE_CONF_EPOLL selects the epoll/timerfd based main loop, which
+   sleeps until the next etimer or rtimer deadline or file descriptor
+   event instead of waking up every millisecond. Real-time tasks are
+   then run from the main loop instead of from SIGALRM. */
+#ifndef NATIVE_CONF_EPOLL
+#ifdef __linux__
+#define NATIVE_CONF_EPOLL 1
+#else /* __linux__ */
+#define NATIVE_CONF_EPOLL 0
+#endif /* __linux__ */
+#endif /* NATIVE_CONF_EPOLL */
+
+/* If non-zero, the epoll main loop prints wakeup and timer dispatch
+   latency statistics to stderr every NATIVE_CONF_LOOP_STATS seconds. */
+#ifndef NATIVE_CONF_LOOP_STATS
+#define NATIVE_CONF_LOOP_STATS 0
+#endif /* NATIVE_CONF_LOOP_STATS */
+
+/* Profile processes (PROCESS_CONF_PROFILE) with a microsecond clock
+   instead of the millisecond rtimer clock. */
+#ifndef PROCESS_CONF_PROFILE_CLOCK
+unsigned long native_clock_usec(void);
+#define PROCESS_CONF_PROFILE_CLOCK()  native_clock_usec()
+#define PROCESS_CONF_PROFILE_CLOCK_T  unsigned long
+#define PROCESS_CONF_PROFILE_SECOND   1000000UL
+#endif /* PROCESS_CONF_PROFILE_CLOCK */
+
+/* The file that the process profile is written to at exit and on
+   SIGUSR1 when PROCESS_CONF_PROFILE is set. */
+#ifndef NATIVE_CONF_PROFILE_FILE
+#define NATIVE_CONF_PROFILE_FILE "contiki-profile.bin"
+#endif /* NATIVE_CONF_PROFILE_FILE */
+
+/* Compute Internet checksums with SSE2, or AVX2 when the compiler
+   targets it. */
+#ifndef NATIVE_CONF_CHKSUM_SIMD
+#define NATIVE_CONF_CHKSUM_SIMD 1
+#endif /* NATIVE_CONF_CHKSUM_SIMD */
+#if NATIVE_CONF_CHKSUM_SIMD && defined(__SSE2__) && !defined(UIP_CHKSUM_CONF_ARCH)
+#define UIP_CHKSUM_CONF_ARCH uip_chksum_arch_add
+#endif
+
 #endif /* CONTIKI_CONF_H_ */
@@ -43,10 +43,22 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/time.h>
 #include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+
+#include "contiki-conf.h"
+
+#if NATIVE_CONF_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#endif /* NATIVE_CONF_EPOLL */
 
 #ifdef __CYGWIN__
 #include "net/wpcap-drv.h"
@@ -81,6 +93,36 @@
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+#if NATIVE_CONF_EPOLL
+static int epoll_fd = -1;
+static int timer_fd = -1;
+
+/* The events each file descriptor is registered for in the epoll
+   interest set. Descriptors that epoll cannot watch, such as regular
+   files, are always ready and are flagged with FD_ALWAYS_READY. */
+#define FD_ALWAYS_READY 0x80000000
+static uint32_t fd_events[SELECT_MAX];
+
+#define CLOCK_LT(a, b) ((long)((a) - (b)) < 0)
+
+/* The time the timer descriptor is armed for, in microseconds of
+   CLOCK_MONOTONIC, or 0 if it is not armed, and the clock_time()
+   value it was computed from. */
+static uint64_t timer_deadline;
+static clock_time_t timer_target;
+
+#if NATIVE_CONF_LOOP_STATS
+static struct {
+  unsigned long wakeups;
+  unsigned long timer_wakeups;
+  unsigned long fd_wakeups;
+  uint64_t latency_sum;
+  uint64_t latency_max;
+  uint64_t start;
+} loop_stats;
+#endif /* NATIVE_CONF_LOOP_STATS */
+#endif /* NATIVE_CONF_EPOLL */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
@@ -101,6 +143,17 @@ select_set_callback(int fd, const struct select_callback *callback)
 
     select_callback[fd] = callback;
 
+#if NATIVE_CONF_EPOLL
+    /* The descriptor may have been closed and reopened since it was
+       registered, so let the main loop register it again. */
+    if(fd_events[fd] != 0) {
+      if(!(fd_events[fd] & FD_ALWAYS_READY)) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      }
+      fd_events[fd] = 0;
+    }
+#endif /* NATIVE_CONF_EPOLL */
+
     /* Update fd max */
     if(callback != NULL) {
       if(fd > select_max) {
@@ -140,6 +193,378 @@ const static struct select_callback stdin_fd = {
   stdin_set_fd, stdin_handle_fd
 };
 /*---------------------------------------------------------------------------*/
+#if NATIVE_CONF_EPOLL
+static uint64_t
+monotonic_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_init(void)
+{
+  struct epoll_event ev;
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(epoll_fd < 0 || timer_fd < 0) {
+    perror("epoll");
+    exit(1);
+  }
+
+  ev.events = EPOLLIN;
+  ev.data.fd = timer_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+
+#if NATIVE_CONF_LOOP_STATS
+  loop_stats.start = monotonic_usec();
+#endif /* NATIVE_CONF_LOOP_STATS */
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Brings the epoll interest set in line with what the select
+ * callbacks currently want. The kernel keeps the set between calls,
+ * so epoll_ctl() is only called for descriptors whose interest has
+ * changed. Returns non-zero if any descriptor is always ready.
+ */
+static int
+update_interest(void)
+{
+  struct epoll_event ev;
+  uint32_t events;
+  fd_set fdr;
+  fd_set fdw;
+  int always_ready;
+  int op;
+  int i;
+
+  always_ready = 0;
+  for(i = 0; i <= select_max; i++) {
+    events = 0;
+    if(select_callback[i] != NULL) {
+      FD_ZERO(&fdr);
+      FD_ZERO(&fdw);
+      if(select_callback[i]->set_fd(&fdr, &fdw)) {
+        if(FD_ISSET(i, &fdr)) {
+          events |= EPOLLIN;
+        }
+        if(FD_ISSET(i, &fdw)) {
+          events |= EPOLLOUT;
+        }
+      }
+    }
+
+    if(fd_events[i] & FD_ALWAYS_READY) {
+      fd_events[i] = events != 0 ? events | FD_ALWAYS_READY : 0;
+    } else if(events != fd_events[i]) {
+      if(events == 0) {
+        op = EPOLL_CTL_DEL;
+      } else if(fd_events[i] == 0) {
+        op = EPOLL_CTL_ADD;
+      } else {
+        op = EPOLL_CTL_MOD;
+      }
+      ev.events = events;
+      ev.data.fd = i;
+      /* A descriptor that was closed without being unregistered has
+         left the interest set, and needs to be added again if its
+         number has been reused. */
+      if(epoll_ctl(epoll_fd, op, i, &ev) < 0 &&
+         !(errno == ENOENT && op == EPOLL_CTL_MOD &&
+           epoll_ctl(epoll_fd, EPOLL_CTL_ADD, i, &ev) == 0)) {
+        if(errno == EPERM) {
+          /* Regular files cannot be polled, but are always ready, just
+             as select() would report them. */
+          events |= FD_ALWAYS_READY;
+        } else {
+          /* Not registered, for instance because it is closed (EBADF). */
+          events = 0;
+        }
+      }
+      fd_events[i] = events;
+    }
+
+    if(fd_events[i] & FD_ALWAYS_READY) {
+      always_ready = 1;
+    }
+  }
+  return always_ready;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Arms the timer descriptor for the next etimer or rtimer deadline.
+ * Returns zero if a deadline has already passed.
+ */
+static int
+arm_timer(void)
+{
+  struct itimerspec its;
+  struct timeval tv;
+  clock_time_t now;
+  clock_time_t next;
+  uint64_t delay;
+  uint64_t deadline;
+  int have_deadline;
+  rtimer_clock_t rt;
+  clock_time_t target;
+
+  have_deadline = 0;
+  delay = 0;
+  now = clock_time();
+
+  if(etimer_pending()) {
+    next = etimer_next_expiration_time();
+    if(!CLOCK_LT(now, next)) {
+      return 0;
+    }
+    delay = next - now;
+    have_deadline = 1;
+  }
+
+  if(rtimer_arch_next(&rt)) {
+    if(!RTIMER_CLOCK_LT(RTIMER_NOW(), rt)) {
+      return 0;
+    }
+    if(!have_deadline ||
+       (rtimer_clock_t)(rt - RTIMER_NOW()) < delay) {
+      delay = (rtimer_clock_t)(rt - RTIMER_NOW());
+    }
+    have_deadline = 1;
+  }
+
+  /* Most iterations end up with the same deadline as the previous
+     one, so only set the timer descriptor when it changes. */
+  target = now + delay;
+  if(have_deadline ? timer_deadline != 0 && target == timer_target :
+     timer_deadline == 0) {
+    return 1;
+  }
+
+  deadline = 0;
+  if(have_deadline) {
+    /* Both clocks count milliseconds of gettimeofday(); wake up at the
+       start of the millisecond in which the deadline falls. */
+    gettimeofday(&tv, NULL);
+    delay = delay * 1000 - tv.tv_usec % 1000;
+    deadline = monotonic_usec() + delay;
+  }
+
+  memset(&its, 0, sizeof(its));
+  if(have_deadline) {
+    its.it_value.tv_sec = deadline / 1000000;
+    its.it_value.tv_nsec = (deadline % 1000000) * 1000;
+  }
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+  timer_deadline = deadline;
+  timer_target = target;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_events(int pending)
+{
+  struct epoll_event events[SELECT_MAX + 1];
+  uint64_t expirations;
+#if NATIVE_CONF_LOOP_STATS
+  uint64_t now;
+#endif /* NATIVE_CONF_LOOP_STATS */
+  fd_set fdr;
+  fd_set fdw;
+  int timeout;
+  int n;
+  int i;
+  int fd;
+
+  timeout = -1;
+  if(update_interest() || pending || !arm_timer()) {
+    timeout = 0;
+  }
+
+  n = epoll_wait(epoll_fd, events, SELECT_MAX + 1, timeout);
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    n = 0;
+  }
+
+#if NATIVE_CONF_LOOP_STATS
+  now = monotonic_usec();
+  if(timeout != 0) {
+    loop_stats.wakeups++;
+  }
+#endif /* NATIVE_CONF_LOOP_STATS */
+
+  for(i = 0; i < n; i++) {
+    fd = events[i].data.fd;
+    if(fd == timer_fd) {
+      if(read(timer_fd, &expirations, sizeof(expirations)) > 0 &&
+         timer_deadline != 0) {
+#if NATIVE_CONF_LOOP_STATS
+        loop_stats.timer_wakeups++;
+        loop_stats.latency_sum += now - timer_deadline;
+        if(now - timer_deadline > loop_stats.latency_max) {
+          loop_stats.latency_max = now - timer_deadline;
+        }
+#endif /* NATIVE_CONF_LOOP_STATS */
+        timer_deadline = 0;
+      }
+      continue;
+    }
+
+#if NATIVE_CONF_LOOP_STATS
+    loop_stats.fd_wakeups++;
+#endif /* NATIVE_CONF_LOOP_STATS */
+    if(fd >= 0 && fd < SELECT_MAX && select_callback[fd] != NULL) {
+      FD_ZERO(&fdr);
+      FD_ZERO(&fdw);
+      if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        FD_SET(fd, &fdr);
+      }
+      if(events[i].events & EPOLLOUT) {
+        FD_SET(fd, &fdw);
+      }
+      select_callback[fd]->handle_fd(&fdr, &fdw);
+    }
+    if(fd >= 0 && fd < SELECT_MAX &&
+       (events[i].events & (EPOLLHUP | EPOLLERR))) {
+      /* Forget the descriptor, as it may be closed without being
+         unregistered. It is added again if it is still wanted. */
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      fd_events[fd] = 0;
+    }
+  }
+
+  for(fd = 0; fd <= select_max; fd++) {
+    if((fd_events[fd] & FD_ALWAYS_READY) && select_callback[fd] != NULL) {
+      FD_ZERO(&fdr);
+      FD_ZERO(&fdw);
+      if(fd_events[fd] & EPOLLIN) {
+        FD_SET(fd, &fdr);
+      }
+      if(fd_events[fd] & EPOLLOUT) {
+        FD_SET(fd, &fdw);
+      }
+      select_callback[fd]->handle_fd(&fdr, &fdw);
+    }
+  }
+
+  /* Only poll the event timers when one of them is due. */
+  if(etimer_pending() &&
+     !CLOCK_LT(clock_time(), etimer_next_expiration_time())) {
+    etimer_request_poll();
+  }
+  rtimer_arch_run_due();
+
+#if NATIVE_CONF_LOOP_STATS
+  if(now - loop_stats.start >= NATIVE_CONF_LOOP_STATS * 1000000ULL) {
+    fprintf(stderr, "loop: %lu wakeups/s (%lu timer, %lu fd), "
+            "timer dispatch latency avg %lu us max %lu us\n",
+            (unsigned long)(loop_stats.wakeups * 1000000ULL /
+                            (now - loop_stats.start)),
+            loop_stats.timer_wakeups, loop_stats.fd_wakeups,
+            (unsigned long)(loop_stats.timer_wakeups ?
+                            loop_stats.latency_sum / loop_stats.timer_wakeups :
+                            0),
+            (unsigned long)loop_stats.latency_max);
+    memset(&loop_stats, 0, sizeof(loop_stats));
+    loop_stats.start = now;
+  }
+#endif /* NATIVE_CONF_LOOP_STATS */
+}
+#endif /* NATIVE_CONF_EPOLL */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_PROFILE
+/*
+ * The process profile is written to NATIVE_CONF_PROFILE_FILE in host
+ * byte order. The file starts with a header:
+ *
+ *   char     magic[4]      "CPRF"
+ *   uint8_t  version       1
+ *   uint8_t  buckets       PROCESS_PROFILE_HIST_BUCKETS
+ *   uint8_t  log2_step     PROCESS_PROFILE_HIST_LOG2_STEP
+ *   uint8_t  reserved
+ *   uint32_t second        clock ticks per second
+ *   uint32_t count         number of process records
+ *
+ * followed by one record per running process:
+ *
+ *   char     name[24]      NUL padded, possibly truncated
+ *   uint64_t calls, time, max_time, max_wait
+ *   uint64_t wait_hist[buckets]
+ */
+struct profile_header {
+  char magic[4];
+  uint8_t version;
+  uint8_t buckets;
+  uint8_t log2_step;
+  uint8_t reserved;
+  uint32_t second;
+  uint32_t count;
+};
+
+struct profile_record {
+  char name[24];
+  uint64_t calls;
+  uint64_t time;
+  uint64_t max_time;
+  uint64_t max_wait;
+  uint64_t wait_hist[PROCESS_PROFILE_HIST_BUCKETS];
+};
+
+static volatile sig_atomic_t profile_dump_requested;
+/*---------------------------------------------------------------------------*/
+static void
+profile_dump(void)
+{
+  struct profile_header h;
+  struct profile_record r;
+  struct process *p;
+  FILE *f;
+  int i;
+
+  f = fopen(NATIVE_CONF_PROFILE_FILE, "wb");
+  if(f == NULL) {
+    perror(NATIVE_CONF_PROFILE_FILE);
+    return;
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, "CPRF", sizeof(h.magic));
+  h.version = 1;
+  h.buckets = PROCESS_PROFILE_HIST_BUCKETS;
+  h.log2_step = PROCESS_PROFILE_HIST_LOG2_STEP;
+  h.second = PROCESS_PROFILE_SECOND;
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    h.count++;
+  }
+  fwrite(&h, sizeof(h), 1, f);
+
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    memset(&r, 0, sizeof(r));
+    strncpy(r.name, PROCESS_NAME_STRING(p), sizeof(r.name));
+    r.calls = p->profile.calls;
+    r.time = p->profile.time;
+    r.max_time = p->profile.max_time;
+    r.max_wait = p->profile.max_wait;
+    for(i = 0; i < PROCESS_PROFILE_HIST_BUCKETS; i++) {
+      r.wait_hist[i] = p->profile.wait_hist[i];
+    }
+    fwrite(&r, sizeof(r), 1, f);
+  }
+  fclose(f);
+}
+/*---------------------------------------------------------------------------*/
+static void
+profile_signal(int sig)
+{
+  profile_dump_requested = 1;
+}
+#endif /* PROCESS_PROFILE */
+/*---------------------------------------------------------------------------*/
 static void
 set_rime_addr(void)
 {
@@ -201,6 +626,10 @@ main(int argc, char **argv)
 #endif
 #endif
 
+#if NATIVE_CONF_EPOLL
+  epoll_init();
+#endif /* NATIVE_CONF_EPOLL */
+
   process_init();
   process_start(&etimer_process, NULL);
   ctimer_init();
@@ -250,7 +679,22 @@ main(int argc, char **argv)
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
+
+#if PROCESS_PROFILE
+  signal(SIGUSR1, profile_signal);
+  atexit(profile_dump);
+#endif /* PROCESS_PROFILE */
+
   while(1) {
+#if PROCESS_PROFILE
+    if(profile_dump_requested) {
+      profile_dump_requested = 0;
+      profile_dump();
+    }
+#endif /* PROCESS_PROFILE */
+#if NATIVE_CONF_EPOLL
+    handle_events(process_run());
+#else /* NATIVE_CONF_EPOLL */
     fd_set fdr;
     fd_set fdw;
     int maxfd;
@@ -287,6 +731,7 @@ main(int argc, char **argv)
     }
 
     etimer_request_poll();
+#endif /* NATIVE_CONF_EPOLL */
 
 #if WITH_GUI
     if(console_resize()) {
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks the RFC 8138 6LoRH encoding of sicslowpan against byte
+ *         vectors written from the RFC. Each packet is compressed and
+ *         the 6LoRHs of the frame compared with the vector, then the
+ *         frame is decompressed again. The frame is also received
+ *         with an unknown critical 6LoRH, which must be dropped, and
+ *         with an unknown elective 6LoRH, which must be skipped.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/mac/mac.h"
+#include "net/rime/rime.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Addresses of the vectors: the root R and nodes A, B, C and D */
+#define ADDR_R 0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01
+#define ADDR_A 0xfd, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x12, 0x74, 0x02, 0, 0x02, 0x02, 0x02
+#define ADDR_B 0xfd, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x12, 0x74, 0x02, 0, 0x02, 0x03, 0x03
+#define ADDR_C 0xfd, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x12, 0x74, 0x02, 0, 0x02, 0x04, 0x04
+#define ADDR_D 0xfd, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x12, 0x74, 0x05, 0, 0x05, 0x05, 0x05
+
+/* A UDP header and 7 bytes of payload */
+#define UDP_LEN 15
+#define UDP 0xf0, 0xb1, 0xf0, 0xb2, 0, UDP_LEN, 0x12, 0x34, \
+    'R', 'F', 'C', '8', '1', '3', '8'
+
+/* From A to the root, with an RPL Option (RFC 6553) in a Hop-by-Hop
+   header: instance 0x1e, sender rank 0x0200 */
+static const uint8_t rpi_packet[] = {
+  0x60, 0, 0, 0, 0, 8 + UDP_LEN, UIP_PROTO_HBHO, 64, ADDR_A, ADDR_R,
+  UIP_PROTO_UDP, 0, 0x63, 4, 0x00, 0x1e, 0x02, 0x00,
+  UDP
+};
+/* RPI-6LoRH (RFC 8138, section 6.3): 100|O=0 R=0 F=0 I=0 K=1, type
+   5, the instance and the high byte of the rank */
+static const uint8_t rpi_lorh[] = {
+  0xf1,
+  0x81, 0x05, 0x1e, 0x02
+};
+
+/* From the root to C through A and B, with an RPL Option (down, rank
+   0x0100) and a Source Routing Header (RFC 6554) with CmprI = CmprE
+   = 14 */
+static const uint8_t srh_packet[] = {
+  0x60, 0, 0, 0, 0, 8 + 16 + UDP_LEN, UIP_PROTO_HBHO, 64, ADDR_R, ADDR_A,
+  UIP_PROTO_ROUTING, 0, 0x63, 4, 0x80, 0x1e, 0x01, 0x00,
+  UIP_PROTO_UDP, 1, 3, 2, 0xee, 0x40, 0, 0, 0x03, 0x03, 0x04, 0x04, 0, 0, 0, 0,
+  UDP
+};
+/* SRH-6LoRHs (RFC 8138, section 5.1): 100|size=0, type 3 with the 8
+   bytes of A that differ from the root, then 100|size=0, type 1 with
+   the 2 bytes of B that differ from A. C is the IPHC destination.
+   Then the RPI-6LoRH with O=1 K=1. */
+static const uint8_t srh_lorh[] = {
+  0xf1,
+  0x80, 0x03, 0x02, 0x12, 0x74, 0x02, 0x00, 0x02, 0x02, 0x02,
+  0x80, 0x01, 0x03, 0x03,
+  0x91, 0x05, 0x1e, 0x01
+};
+
+/* A packet from D to C, tunneled by the root with an RPL Option */
+static const uint8_t ip_in_ip_packet[] = {
+  0x60, 0, 0, 0, 0, 8 + 40 + UDP_LEN, UIP_PROTO_HBHO, 64, ADDR_R, ADDR_C,
+  UIP_PROTO_IPV6, 0, 0x63, 4, 0x80, 0x1e, 0x01, 0x00,
+  0x60, 0, 0, 0, 0, UDP_LEN, UIP_PROTO_UDP, 63, ADDR_D, ADDR_C,
+  UDP
+};
+/* The RPI-6LoRH, then the IP-in-IP 6LoRH (RFC 8138, section 7):
+   101|length=9, type 6, the outer hop limit and the 8 bytes of the
+   encapsulator that differ from D */
+static const uint8_t ip_in_ip_lorh[] = {
+  0xf1,
+  0x91, 0x05, 0x1e, 0x01,
+  0xa9, 0x06, 0x40, 0, 0, 0, 0, 0, 0, 0, 0x01
+};
+
+struct vector {
+  const char *name;
+  const uint8_t *packet;
+  uint16_t packet_len;
+  const uint8_t *lorh;
+  uint8_t lorh_len;
+};
+
+#define VECTOR(name) \
+  { #name, name##_packet, sizeof(name##_packet), name##_lorh, sizeof(name##_lorh) }
+
+static const struct vector vectors[] = {
+  VECTOR(rpi),
+  VECTOR(srh),
+  VECTOR(ip_in_ip)
+};
+
+/* An unknown critical 6LoRH (type 7) and an unknown elective one
+   (type 15, 2 bytes) */
+static const uint8_t unknown_critical[] = { 0x80, 0x07 };
+static const uint8_t unknown_elective[] = { 0xa2, 0x0f, 0xaa, 0xbb };
+
+static uint8_t frame[PACKETBUF_SIZE];
+static int frame_len;
+static uint8_t packet[UIP_BUFSIZE];
+static int packet_len;
+static int failures;
+
+PROCESS(lorh_test_process, "6LoRH test");
+AUTOSTART_PROCESSES(&lorh_test_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC driver that keeps the frame instead of sending it */
+static void
+send_packet(mac_callback_t sent, void *ptr)
+{
+  frame_len = packetbuf_copyto(frame);
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+static void
+packet_input(void)
+{
+}
+static int
+on(void)
+{
+  return 1;
+}
+static int
+off(int keep_radio_on)
+{
+  return 1;
+}
+static unsigned short
+channel_check_interval(void)
+{
+  return 0;
+}
+static void
+init(void)
+{
+}
+const struct mac_driver lorh_test_mac_driver = {
+  "6lorh-test", init, send_packet, packet_input, on, off,
+  channel_check_interval
+};
+/*---------------------------------------------------------------------------*/
+/* Keeps the decompressed packet, before uIP handles it */
+static void
+input_callback(void)
+{
+  memcpy(packet, &uip_buf[UIP_LLH_LEN], uip_len);
+  packet_len = uip_len;
+}
+static void
+output_callback(int status)
+{
+}
+RIME_SNIFFER(sniffer, input_callback, output_callback);
+/*---------------------------------------------------------------------------*/
+static void
+fail(const struct vector *v, const char *what)
+{
+  printf("%s: %s\n", v->name, what);
+  failures++;
+}
+/*---------------------------------------------------------------------------*/
+/* Receives a frame made of the vector's 6LoRHs, optionally another
+   6LoRH, and the rest of the compressed frame. Returns 1 if the
+   decompressed packet is the one of the vector. */
+static int
+receive(const struct vector *v, const uint8_t *extra, int extra_len)
+{
+  static uint8_t buf[PACKETBUF_SIZE];
+  linkaddr_t sender;
+
+  memcpy(buf, v->lorh, v->lorh_len);
+  memcpy(buf + v->lorh_len, extra, extra_len);
+  memcpy(buf + v->lorh_len + extra_len, frame + v->lorh_len,
+         frame_len - v->lorh_len);
+
+  memset(&sender, 0, sizeof(sender));
+  sender.u8[0] = 1;
+  packetbuf_clear();
+  packetbuf_copyfrom(buf, frame_len + extra_len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  packet_len = 0;
+  NETSTACK_NETWORK.input();
+  return packet_len == v->packet_len &&
+    memcmp(packet, v->packet, v->packet_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(const struct vector *v)
+{
+  uip_lladdr_t dest;
+
+  /* Compress */
+  memset(&dest, 0, sizeof(dest));
+  dest.addr[0] = 2;
+  memcpy(&uip_buf[UIP_LLH_LEN], v->packet, v->packet_len);
+  uip_len = v->packet_len;
+  frame_len = 0;
+  tcpip_output(&dest);
+  if(frame_len < v->lorh_len + 1 ||
+     memcmp(frame, v->lorh, v->lorh_len) != 0) {
+    fail(v, "wrong 6LoRHs");
+    return;
+  }
+  if((frame[v->lorh_len] & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+    fail(v, "no IPHC after the 6LoRHs");
+    return;
+  }
+
+  /* Decompress */
+  if(!receive(v, NULL, 0)) {
+    fail(v, "wrong packet after decompression");
+  }
+  receive(v, unknown_critical, sizeof(unknown_critical));
+  if(packet_len != 0) {
+    fail(v, "unknown critical 6LoRH not dropped");
+  }
+  if(!receive(v, unknown_elective, sizeof(unknown_elective))) {
+    fail(v, "unknown elective 6LoRH not skipped");
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(lorh_test_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  rime_sniffer_add(&sniffer);
+
+  /* Let the network stack start */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    check(&vectors[i]);
+  }
+
+  if(failures == 0) {
+    printf("TEST OK\n");
+  } else {
+    printf("TEST FAILED\n");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
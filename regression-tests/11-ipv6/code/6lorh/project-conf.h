@@ -0,0 +1,9 @@
+/* Frames are handed to the test instead of a radio */
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC lorh_test_mac_driver
+
+#undef SICSLOWPAN_CONF_6LORH
+#define SICSLOWPAN_CONF_6LORH 1
+
+#undef UIP_CONF_IPV6_RPL
+#define UIP_CONF_IPV6_RPL 0
@@ -0,0 +1,107 @@
+/*
+ * Convergence metrics from the RPL event trace.
+ *
+ * Build the motes with the trace printed on the serial line, by
+ * exporting RPL_TRACE=1 before starting Cooja (see code/Makefile).
+ * Then run this script in the simulation script editor, either on its
+ * own or by calling rpl_trace_input() from the main loop of the
+ * scenario's script and rpl_trace_report() at its end.
+ *
+ * An epoch starts when the root creates its DAG (boot or reboot) or
+ * starts a global repair. For each epoch the script reports when the
+ * last mote got a parent, when the last parent or rank change
+ * happened, i.e. when the DODAG converged, and how many times each
+ * event happened.
+ */
+
+var trace = {
+  epoch: 0,
+  root: -1,
+  start: 0,                 /* Epoch start, in microseconds */
+  parents: {},              /* Current parent of each mote */
+  joined: 0,                /* Time the last mote got a parent */
+  settled: 0,               /* Time of the last parent or rank change */
+  counts: {}
+};
+
+function rpl_trace_report() {
+  var e, s = "";
+  if(trace.epoch == 0) {
+    log.log("no RPL trace seen, build with RPL_TRACE=1\n");
+    return;
+  }
+  for(e in trace.counts) {
+    s += " " + e + "=" + trace.counts[e];
+  }
+  log.log("epoch " + trace.epoch + ": all motes had a parent after " +
+          ((trace.joined - trace.start) / 1000) + " ms, converged after " +
+          ((trace.settled - trace.start) / 1000) + " ms," + s + "\n");
+}
+
+function rpl_trace_new_epoch(t, why) {
+  if(trace.epoch > 0) {
+    rpl_trace_report();
+  }
+  trace.epoch++;
+  trace.start = t;
+  trace.joined = t;
+  trace.settled = t;
+  trace.counts = {};
+  log.log("epoch " + trace.epoch + " at " + (t / 1000) + " ms: " + why + "\n");
+}
+
+function rpl_trace_all_joined() {
+  var i, m;
+  for(i = 0; i < sim.getMotesCount(); i++) {
+    m = sim.getMote(i).getID();
+    if(m != trace.root && !trace.parents[m]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Feeds one line of mote output to the metrics. t is in microseconds. */
+function rpl_trace_input(id, t, line) {
+  /* RPL trace <seqno> <time> <event> <addr> <rank> <arg> */
+  var f = line.split(" ");
+  var event, addr;
+
+  if(f.length < 8 || f[0] != "RPL" || f[1] != "trace") {
+    return;
+  }
+  event = f[4];
+  addr = parseInt(f[5], 16);
+
+  /* The root creates its DAG with its own address as DAG ID. The trace
+     holds the last two address bytes, the low one is the node ID. */
+  if(event == "join" && (addr & 0xff) == (id & 0xff)) {
+    trace.root = id;
+    trace.parents = {};
+    rpl_trace_new_epoch(t, "root " + id + " created the DAG");
+  } else if(event == "global-repair" && id == trace.root) {
+    rpl_trace_new_epoch(t, "root " + id + " started a global repair");
+  }
+  if(trace.epoch == 0) {
+    return;
+  }
+
+  trace.counts[event] = (trace.counts[event] || 0) + 1;
+
+  if(event == "parent") {
+    trace.parents[id] = addr;
+    trace.settled = t;
+    if(addr != 0 && rpl_trace_all_joined()) {
+      trace.joined = t;
+    }
+  } else if(event == "rank" || event == "join") {
+    trace.settled = t;
+  }
+}
+
+/* Main loop, when run on its own */
+TIMEOUT(3600000, rpl_trace_report(); log.testOK());
+while(true) {
+  YIELD();
+  rpl_trace_input(id, time, msg);
+}
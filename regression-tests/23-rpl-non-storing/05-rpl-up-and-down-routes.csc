@@ -292,6 +292,8 @@ TIMEOUT(1000000, if(lostMsgs == 0) { log.testOK(); } );&#xD;
 lastMsg = -1;&#xD;
 packets = "_________";&#xD;
 hops = 0;&#xD;
+rplBytes = {};&#xD;
+lorhBytes = {};&#xD;
 &#xD;
 while(true) {&#xD;
     YIELD();&#xD;
@@ -328,6 +330,18 @@ while(true) {&#xD;
         packets = packets.substr(0, num).concat("*");&#xD;
         log.log("" + hops + " " + packets + "\n");&#xD;
         lastMsg = num;&#xD;
+    } else if(msg.startsWith("6LoRH")) {&#xD;
+        /* RPL header bytes sent, and the 6LoRH bytes they were compressed into */&#xD;
+        data = msg.split(" ");&#xD;
+        rplBytes[id] = parseInt(data[1]);&#xD;
+        lorhBytes[id] = parseInt(data[8]);&#xD;
+        totalRpl = 0;&#xD;
+        totalLorh = 0;&#xD;
+        for(i in rplBytes) {&#xD;
+            totalRpl += rplBytes[i];&#xD;
+            totalLorh += lorhBytes[i];&#xD;
+        }&#xD;
+        log.log("6LoRH saved " + (totalRpl - totalLorh) + " of " + totalRpl + " RPL header bytes\n");&#xD;
     }&#xD;
 }</script>
       <active>true</active>
@@ -31,6 +31,12 @@
 #undef RPL_CONF_MOP
 #define RPL_CONF_MOP RPL_MOP_NON_STORING
 
+/* Compress the RPL headers with 6LoRH, and count the bytes saved */
+#undef SICSLOWPAN_CONF_6LORH
+#define SICSLOWPAN_CONF_6LORH 1
+#undef SICSLOWPAN_CONF_STATS
+#define SICSLOWPAN_CONF_STATS 1
+
 /* Add a bit of extra probing in the non-storing case to compensate for reduced DAO traffic */
 #undef RPL_CONF_PROBING_INTERVAL
 #define RPL_CONF_PROBING_INTERVAL (60 * CLOCK_SECOND)
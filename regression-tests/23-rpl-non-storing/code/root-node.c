@@ -37,6 +37,7 @@
 #include "net/ip/uip-debug.h"
 
 #include "simple-udp.h"
+#include "net/ipv6/sicslowpan.h"
 
 #include "net/rpl/rpl.h"
 
@@ -49,6 +50,8 @@
 #define SEND_INTERVAL		(10 * CLOCK_SECOND)
 #define SEND_TIME		(random_rand() % (SEND_INTERVAL))
 
+#define STATS_INTERVAL		(60 * CLOCK_SECOND)
+
 static struct simple_udp_connection unicast_connection;
 
 /*---------------------------------------------------------------------------*/
@@ -117,6 +120,7 @@ create_rpl_dag(uip_ipaddr_t *ipaddr)
 PROCESS_THREAD(unicast_receiver_process, ev, data)
 {
   uip_ipaddr_t *ipaddr;
+  static struct etimer et;
 
   PROCESS_BEGIN();
 
@@ -127,8 +131,13 @@ PROCESS_THREAD(unicast_receiver_process, ev, data)
   simple_udp_register(&unicast_connection, UDP_PORT,
                       NULL, UDP_PORT, receiver);
 
+  etimer_set(&et, STATS_INTERVAL);
   while(1) {
-    PROCESS_WAIT_EVENT();
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+    printf("6LoRH: %lu bytes of RPL headers sent as %lu bytes\n",
+           (unsigned long)sicslowpan_stats.rpl_hdr_bytes,
+           (unsigned long)sicslowpan_stats.lorh_bytes);
   }
   PROCESS_END();
 }
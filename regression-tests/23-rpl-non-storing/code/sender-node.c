@@ -37,6 +37,7 @@
 #include "net/ip/uip-debug.h"
 
 #include "simple-udp.h"
+#include "net/ipv6/sicslowpan.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -122,6 +123,9 @@ PROCESS_THREAD(sender_node_process, ev, data)
       message_number++;
       simple_udp_sendto(&unicast_connection, buf, strlen(buf) + 1, &addr);
     }
+    printf("6LoRH: %lu bytes of RPL headers sent as %lu bytes\n",
+           (unsigned long)sicslowpan_stats.rpl_hdr_bytes,
+           (unsigned long)sicslowpan_stats.lorh_bytes);
   }
 
   PROCESS_END();